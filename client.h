@@ -301,6 +301,33 @@ client_notify_enter(struct wlr_surface *s, struct wlr_keyboard *kb)
 		wlr_seat_keyboard_notify_enter(seat, s, NULL, 0, NULL);
 }
 
+static inline int
+client_ping(Client *c)
+{
+	/* Returns 0 if the client cannot answer pings. A ping still
+	 * outstanding is not sent again. */
+#ifdef XWAYLAND
+	if (client_is_x11(c)) {
+		/* only sent if the window supports _NET_WM_PING */
+		wlr_xwayland_surface_ping(c->surface.xwayland);
+		return c->surface.xwayland->pinging;
+	}
+#endif
+	wlr_xdg_surface_ping(c->surface.xdg);
+	return 1;
+}
+
+static inline int
+client_ping_pending(Client *c)
+{
+	/* wlroots handles the pong itself and only clears the ping */
+#ifdef XWAYLAND
+	if (client_is_x11(c))
+		return c->surface.xwayland->pinging;
+#endif
+	return c->surface.xdg->client->ping_serial != 0;
+}
+
 static inline void
 client_restack_surface(Client *c)
 {
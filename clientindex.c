@@ -0,0 +1,334 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clientindex.h"
+#include "util.h"
+
+#define NTAGS 32
+#define MINBUCKETS 64
+
+/* hashed keys; each has its own set of chains */
+enum { KeyClient, KeyAppid, KeyTitle, KeyPid, KeyMon, KeyLast };
+/* an entry is on one chain per key plus one list per tag bit */
+#define NLINKS (KeyLast + NTAGS)
+
+typedef struct Entry Entry;
+
+typedef struct {
+  Entry *next;
+  Entry **pprev; /* NULL if not linked */
+} Link;
+
+struct Entry {
+  void *client;
+  char *appid, *title;
+  int pid;
+  uint32_t tags;
+  const void *mon;
+  uint64_t seq;
+  Link link[NLINKS];
+};
+
+struct ClientIndex {
+  Entry **chains[KeyLast]; /* nbuckets heads per key */
+  size_t nbuckets, count;
+  Entry *tags[NTAGS];
+  uint64_t seq;
+  Entry **scratch; /* matches of the current query, count long */
+  size_t scratchcap;
+};
+
+static void *erealloc(void *p, size_t size) {
+  if (!(p = realloc(p, size)))
+    die("realloc:");
+  return p;
+}
+
+static char *estrdup(const char *s) {
+  char *d;
+
+  if (!s)
+    return NULL;
+  if (!(d = strdup(s)))
+    die("strdup:");
+  return d;
+}
+
+static uint32_t hashstr(const char *s) {
+  uint32_t h = 2166136261u;
+
+  for (; *s; s++)
+    h = (h ^ (unsigned char)*s) * 16777619u;
+  return h;
+}
+
+static uint32_t hashint(uint64_t x) {
+  x ^= x >> 33;
+  x *= UINT64_C(0xff51afd7ed558ccd);
+  x ^= x >> 33;
+  return (uint32_t)x;
+}
+
+static void linkinsert(Entry **head, Entry *e, int li) {
+  Link *l = &e->link[li];
+
+  if ((l->next = *head))
+    (*head)->link[li].pprev = &l->next;
+  l->pprev = head;
+  *head = e;
+}
+
+static void linkremove(Entry *e, int li) {
+  Link *l = &e->link[li];
+
+  if (!l->pprev)
+    return;
+  if ((*l->pprev = l->next))
+    l->next->link[li].pprev = l->pprev;
+  l->next = NULL;
+  l->pprev = NULL;
+}
+
+/* chain head for key k of e, or NULL if e has no value for k */
+static Entry **chainof(ClientIndex *ix, int k, const Entry *e) {
+  uint32_t h;
+
+  switch (k) {
+  case KeyClient:
+    h = hashint((uintptr_t)e->client);
+    break;
+  case KeyAppid:
+    if (!e->appid)
+      return NULL;
+    h = hashstr(e->appid);
+    break;
+  case KeyTitle:
+    if (!e->title)
+      return NULL;
+    h = hashstr(e->title);
+    break;
+  case KeyPid:
+    if (e->pid <= 0)
+      return NULL;
+    h = hashint((uint64_t)e->pid);
+    break;
+  default:
+    if (!e->mon)
+      return NULL;
+    h = hashint((uintptr_t)e->mon);
+    break;
+  }
+  return &ix->chains[k][h & (ix->nbuckets - 1)];
+}
+
+static void linkkeys(ClientIndex *ix, Entry *e) {
+  Entry **head;
+  int k;
+
+  for (k = KeyAppid; k < KeyLast; k++)
+    if ((head = chainof(ix, k, e)))
+      linkinsert(head, e, k);
+}
+
+static void unlinkkeys(Entry *e) {
+  int k;
+
+  for (k = KeyAppid; k < KeyLast; k++)
+    linkremove(e, k);
+}
+
+static void rehash(ClientIndex *ix, size_t nbuckets) {
+  Entry **old = ix->chains[KeyClient], *e, *next;
+  size_t i, oldn = ix->nbuckets;
+  int k;
+
+  ix->nbuckets = nbuckets;
+  for (k = 0; k < KeyLast; k++) {
+    if (k != KeyClient)
+      free(ix->chains[k]);
+    ix->chains[k] = ecalloc(nbuckets, sizeof(Entry *));
+  }
+  for (i = 0; i < oldn; i++) {
+    for (e = old[i]; e; e = next) {
+      next = e->link[KeyClient].next;
+      for (k = 0; k < KeyLast; k++)
+        e->link[k].pprev = NULL;
+      linkinsert(chainof(ix, KeyClient, e), e, KeyClient);
+      linkkeys(ix, e);
+    }
+  }
+  free(old);
+}
+
+static Entry *lookup(ClientIndex *ix, void *client) {
+  Entry *e;
+
+  for (e = ix->chains[KeyClient][hashint((uintptr_t)client) &
+                                 (ix->nbuckets - 1)];
+       e; e = e->link[KeyClient].next)
+    if (e->client == client)
+      return e;
+  return NULL;
+}
+
+ClientIndex *clientindex_create(void) {
+  ClientIndex *ix = ecalloc(1, sizeof(*ix));
+  int k;
+
+  ix->nbuckets = MINBUCKETS;
+  for (k = 0; k < KeyLast; k++)
+    ix->chains[k] = ecalloc(ix->nbuckets, sizeof(Entry *));
+  return ix;
+}
+
+void clientindex_destroy(ClientIndex *ix) {
+  Entry *e, *next;
+  size_t i;
+  int k;
+
+  if (!ix)
+    return;
+  for (i = 0; i < ix->nbuckets; i++) {
+    for (e = ix->chains[KeyClient][i]; e; e = next) {
+      next = e->link[KeyClient].next;
+      free(e->appid);
+      free(e->title);
+      free(e);
+    }
+  }
+  for (k = 0; k < KeyLast; k++)
+    free(ix->chains[k]);
+  free(ix->scratch);
+  free(ix);
+}
+
+static void setstr(char **dst, const char *s) {
+  if (*dst && s && !strcmp(*dst, s))
+    return;
+  free(*dst);
+  *dst = estrdup(s);
+}
+
+void clientindex_update(ClientIndex *ix, void *client, const char *appid,
+                        const char *title, int pid, uint32_t tags,
+                        const void *monitor) {
+  Entry *e;
+  int t;
+
+  if (!(e = lookup(ix, client))) {
+    if (ix->count >= 2 * ix->nbuckets)
+      rehash(ix, 2 * ix->nbuckets);
+    e = ecalloc(1, sizeof(*e));
+    e->client = client;
+    e->seq = ix->seq++;
+    linkinsert(chainof(ix, KeyClient, e), e, KeyClient);
+    ix->count++;
+  } else if (e->pid == pid && e->tags == tags && e->mon == monitor &&
+             !e->appid == !appid && (!appid || !strcmp(e->appid, appid)) &&
+             !e->title == !title && (!title || !strcmp(e->title, title))) {
+    return;
+  }
+
+  unlinkkeys(e);
+  setstr(&e->appid, appid);
+  setstr(&e->title, title);
+  e->pid = pid;
+  e->mon = monitor;
+  linkkeys(ix, e);
+
+  for (t = 0; t < NTAGS; t++) {
+    if ((e->tags ^ tags) & (UINT32_C(1) << t)) {
+      if (tags & (UINT32_C(1) << t))
+        linkinsert(&ix->tags[t], e, KeyLast + t);
+      else
+        linkremove(e, KeyLast + t);
+    }
+  }
+  e->tags = tags;
+}
+
+void clientindex_remove(ClientIndex *ix, void *client) {
+  Entry *e;
+  int li;
+
+  if (!(e = lookup(ix, client)))
+    return;
+  for (li = 0; li < NLINKS; li++)
+    linkremove(e, li);
+  free(e->appid);
+  free(e->title);
+  free(e);
+  ix->count--;
+}
+
+size_t clientindex_count(const ClientIndex *ix) {
+  return ix->count;
+}
+
+static int matches(const Entry *e, const ClientQuery *q) {
+  return (q->pid <= 0 || e->pid == q->pid) &&
+         (!q->tags || (e->tags & q->tags)) &&
+         (!q->monitor || e->mon == q->monitor) &&
+         (!q->appid || (e->appid && !strcmp(e->appid, q->appid))) &&
+         (!q->title || (e->title && !strcmp(e->title, q->title)));
+}
+
+static int byseq(const void *a, const void *b) {
+  const Entry *x = *(const Entry *const *)a, *y = *(const Entry *const *)b;
+
+  return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+size_t clientindex_find(ClientIndex *ix, const ClientQuery *q, void **out,
+                        size_t max) {
+  Entry probe = {0}, **head = NULL, *e;
+  size_t n = 0, i;
+  uint32_t bits;
+  int k = -1, t;
+
+  if (ix->scratchcap < ix->count) {
+    ix->scratchcap = ix->count;
+    ix->scratch = erealloc(ix->scratch, ix->scratchcap * sizeof(Entry *));
+  }
+
+  /* Walk a single chain for the most selective key given */
+  probe.pid = q->pid;
+  probe.appid = (char *)q->appid;
+  probe.title = (char *)q->title;
+  probe.mon = q->monitor;
+  if (q->pid > 0)
+    k = KeyPid;
+  else if (q->appid)
+    k = KeyAppid;
+  else if (q->title)
+    k = KeyTitle;
+  else if (q->monitor)
+    k = KeyMon;
+
+  if (k >= 0) {
+    head = chainof(ix, k, &probe);
+    for (e = *head; e; e = e->link[k].next)
+      if (matches(e, q))
+        ix->scratch[n++] = e;
+  } else if (q->tags) {
+    /* A client on several of the wanted tags is on several lists; only
+     * take it from the list of its lowest wanted tag */
+    for (bits = q->tags; bits; bits &= bits - 1) {
+      t = __builtin_ctz(bits);
+      for (e = ix->tags[t]; e; e = e->link[KeyLast + t].next)
+        if (__builtin_ctz(e->tags & q->tags) == t && matches(e, q))
+          ix->scratch[n++] = e;
+    }
+  } else {
+    for (i = 0; i < ix->nbuckets; i++)
+      for (e = ix->chains[KeyClient][i]; e; e = e->link[KeyClient].next)
+        ix->scratch[n++] = e;
+  }
+
+  qsort(ix->scratch, n, sizeof(Entry *), byseq);
+  for (i = 0; i < n && i < max; i++)
+    out[i] = ix->scratch[i]->client;
+  return n;
+}
@@ -0,0 +1,47 @@
+/*
+ * Secondary indexes over the mapped clients.
+ *
+ * Every indexed client is kept in hash chains keyed by app_id, title, pid and
+ * monitor, and in one list per tag bit, so lookups only visit clients that can
+ * match instead of walking every client and querying each property.  The
+ * index stores its own copy of the keys; callers must call
+ * clientindex_update() whenever one of them changes and clientindex_remove()
+ * when the client goes away.
+ *
+ * Clients are opaque pointers; the index never dereferences them.
+ */
+#ifndef CLIENTINDEX_H
+#define CLIENTINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ClientIndex ClientIndex;
+
+/* Unset fields (NULL, 0) match any client */
+typedef struct {
+  const char *appid; /* exact app_id */
+  const char *title; /* exact title */
+  int pid;
+  uint32_t tags;       /* client has at least one of these tags */
+  const void *monitor;
+} ClientQuery;
+
+ClientIndex *clientindex_create(void);
+void clientindex_destroy(ClientIndex *ix);
+
+/* add client, or refresh its keys if it is already indexed */
+void clientindex_update(ClientIndex *ix, void *client, const char *appid,
+                        const char *title, int pid, uint32_t tags,
+                        const void *monitor);
+void clientindex_remove(ClientIndex *ix, void *client);
+size_t clientindex_count(const ClientIndex *ix);
+
+/*
+ * Store up to max clients matching q into out, in the order they were first
+ * indexed, and return the total number of matches.
+ */
+size_t clientindex_find(ClientIndex *ix, const ClientQuery *q, void **out,
+                        size_t max);
+
+#endif
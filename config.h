@@ -18,6 +18,11 @@ static const float urgentcolor[] = COLOR(0xff0000ff);
 static const float fullscreen_bg[] = {0.1f, 0.1f, 0.1f,
                                       1.0f}; /* You can also use glsl colors */
 
+/* visible clients are pinged every pinginterval ms, and marked unresponsive
+ * when a ping goes unanswered for pingtimeout ms */
+static const unsigned int pinginterval = 2000;
+static const unsigned int pingtimeout = 3000;
+
 /* tagging - TAGCOUNT must be no greater than 31 */
 #define TAGCOUNT (5)
 
@@ -48,16 +53,21 @@ static const Layout layouts[] = {
  * WARNING: negative values other than (-1, -1) cause problems with Xwayland
  * clients https://gitlab.freedesktop.org/xorg/xserver/-/issues/899
  */
+/* maxrendertime: render each frame this many ms before the output's next
+ * vblank instead of as soon as the previous one is shown, so that client
+ * commits made in between still make it; -1 measures the time needed, 0 is
+ * off */
 /* NOTE: ALWAYS add a fallback rule, even if you are completely sure it won't be
  * used */
 static const MonitorRule monrules[] = {
-    /* name       mfact  nmaster scale layout       rotate/reflect x    y */
+    /* name       mfact  nmaster scale layout       rotate/reflect x    y
+       maxrendertime */
     /* example of a HiDPI laptop monitor:
     { "eDP-1",    0.5f,  1,      2,    &layouts[0], WL_OUTPUT_TRANSFORM_NORMAL,
-    -1,  -1 },
+    -1,  -1,  0 },
     */
     /* defaults */
-    {NULL, 0.55f, 1, 1, &layouts[0], WL_OUTPUT_TRANSFORM_NORMAL, -1, -1},
+    {NULL, 0.55f, 1, 1, &layouts[0], WL_OUTPUT_TRANSFORM_NORMAL, -1, -1, 0},
 };
 
 /* keyboard */
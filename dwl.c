@@ -1,13 +1,16 @@
 /*
  * See LICENSE file for copyright and license details.
  */
+#include <errno.h>
 #include <getopt.h>
 #include <libinput.h>
 #include <linux/input-event-codes.h>
 #include <math.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
@@ -67,8 +70,18 @@
 #include <xcb/xcb_icccm.h>
 #endif
 
+#include "ipc.h"
 #include "luaa.h"
+#include "luasignal.h"
+#include "clientindex.h"
+#include "hotstate.h"
+#include "perfstat.h"
+#include "record.h"
+#include "trace.h"
+#include "rulematch.h"
+#include "statuspage.h"
 #include "util.h"
+#include "watchdog.h"
 #include "include/common.h"
 
 /* macros */
@@ -76,6 +89,11 @@
   ((M) && (C)->mon == (M) && ((C)->tags & (M)->tagset[(M)->seltags]))
 
 #define TAGMASK ((1u << TAGCOUNT) - 1)
+#define FRAMEGRAPH_BARS 64
+#define FRAMEGRAPH_BAR 3 /* px, plus a 1 px gap */
+#define FRAMEGRAPH_W (FRAMEGRAPH_BARS * (FRAMEGRAPH_BAR + 1))
+#define FRAMEGRAPH_H 64 /* px, two refresh periods */
+#define RENDER_MARGIN_MIN 1000000ull /* ns, see rendermon() */
 #define LISTEN(E, L, H) wl_signal_add((E), ((L)->notify = (H), (L)))
 #define LISTEN_STATIC(E, H)                                                    \
   do {                                                                         \
@@ -95,6 +113,24 @@ enum {
   LyrBlock,
   NUM_LAYERS
 }; /* scene layers */
+enum {
+  StatusTitle,
+  StatusAppid,
+  StatusFullscreen,
+  StatusFloating,
+  StatusSelmon,
+  StatusTags,
+  StatusLayout,
+  StatusLast
+}; /* printstatus() fields */
+enum {
+  InputLuaKey,
+  InputCKey,
+  InputFocus,
+  InputMove,
+  InputLast
+}; /* inputlat[] kinds */
+enum { FrameFailed, FrameIdle, FrameCommitted }; /* commitframe() results */
 #ifdef XWAYLAND
 enum {
   NetWMWindowTypeDialog,
@@ -136,9 +172,11 @@ typedef struct {
   struct wl_listener unmap;
   struct wl_listener destroy;
   struct wl_listener set_title;
+  struct wl_listener set_appid;
   struct wl_listener fullscreen;
   struct wl_listener set_decoration_mode;
   struct wl_listener destroy_decoration;
+  struct wl_listener ping_timeout;
   struct wlr_box prev; /* layout-relative, includes border */
   struct wlr_box bounds;
 #ifdef XWAYLAND
@@ -148,10 +186,29 @@ typedef struct {
   struct wl_listener configure;
   struct wl_listener set_hints;
 #endif
+  unsigned int id; /* stable identifier exposed over IPC */
+  int slot;        /* index into clientvec, -1 while not on clients */
   unsigned int bw;
   uint32_t tags;
   int isfloating, isurgent, isfullscreen;
   uint32_t resize; /* configure serial of a pending resize */
+  uint64_t *rulematch;          /* memoized rulematcher_match() result */
+  char *ruleappid, *ruletitle;  /* strings rulematch was computed from */
+  int ruletitledep;             /* some candidate rule tests the title */
+  uint64_t created;             /* perf_now() at creation, 0 once mapped */
+  int occluded;                 /* on a visible tag but entirely covered */
+  int surfacew, surfaceh;       /* as of the last commit, see commitnotify() */
+  unsigned int maxfps[FpsLast]; /* frame callback caps, see fpsheld() */
+  uint64_t lastframedone;       /* perf_now() of the last capped frame-done */
+  uint64_t commits, framesheld;
+  uint64_t ratestart;           /* perf_now() when the rate window began */
+  unsigned int ratecount;       /* commits in the rate window */
+  double commitrate;            /* per second, over the last full window */
+  int unresponsive;             /* a ping went unanswered, see pingclients() */
+  uint64_t pingsent;            /* perf_now() of the ping awaiting a pong */
+  uint64_t lastping;            /* perf_now() of the last ping sent */
+  uint64_t pingsmissed;         /* pings wlroots gave up on */
+  PerfStat ping;                /* ping to pong */
 } Client;
 
 typedef struct {
@@ -197,12 +254,28 @@ typedef struct {
   void (*arrange)(Monitor *);
 } Layout;
 
+typedef struct {
+  Monitor *m;
+  struct timespec *now;
+  uint64_t t;   /* now, from perf_now() */
+  Client *sel;  /* the focused client */
+  uint64_t due; /* earliest frame-done held back, 0 if none */
+} FrameDone;
+
+typedef struct {
+  struct wlr_scene_tree *tree;
+  struct wlr_scene_rect *bars[FRAMEGRAPH_BARS];
+  uint64_t intervals[FRAMEGRAPH_BARS]; /* ns, the oldest at head */
+  unsigned int head;
+} FrameGraph;
+
 struct Monitor {
   struct wl_list link;
   struct wlr_output *wlr_output;
   struct wlr_scene_output *scene_output;
   struct wlr_scene_rect *fullscreen_bg; /* See createmon() for info */
   struct wl_listener frame;
+  struct wl_listener present;
   struct wl_listener destroy;
   struct wl_listener request_state;
   struct wl_listener destroy_lock_surface;
@@ -219,8 +292,33 @@ struct Monitor {
   int nmaster;
   char ltsymbol[16];
   int asleep;
+  char *status[StatusLast]; /* values last written by emitstatus() */
+  uint32_t hotid;           /* identifies the monitor in hot */
+  FrameStats fstat;         /* kept by rendermon() */
+  FrameGraph *framegraph;   /* the frame timing overlay, if shown */
+  /* rendering late, see rendermon() */
+  int maxrendertime;        /* ms before vblank, -1 adaptive, 0 off */
+  struct wl_event_source *rendertimer;
+  int renderpending;        /* rendertimer is armed */
+  int renderdue;            /* rendermon() is called by rendertimer */
+  int lastdelayed;          /* the last frame was rendered late */
+  uint64_t lastpresent;     /* ns, when the last frame was shown */
+  uint64_t refreshns;       /* from the last present event */
+  uint64_t rendercost;      /* ns, decaying maximum of rendermon() */
+  uint64_t rendermargin;    /* ns, grown whenever a late frame misses */
+  int occluded;             /* clients, see updateocclusion() */
+  int occlusiondirty;       /* see occlusionchanged() */
+  struct wl_event_source *fpstimer; /* a frame for clients held by max_fps */
 };
 
+typedef struct {
+  /* time from the input event reaching dwl to ... */
+  PerfStat handled; /* ... the binding or focus change having run */
+  PerfStat commit;  /* ... the next wlr_scene_output_commit() */
+  PerfStat frame;   /* ... the frame-done sent after that commit */
+  uint64_t pending; /* input time not yet rendered, 0 if none */
+} InputLatency;
+
 typedef struct {
   const char *name;
   float mfact;
@@ -229,6 +327,7 @@ typedef struct {
   const Layout *lt;
   enum wl_output_transform rr;
   int x, y;
+  int maxrendertime; /* ms, see config.def.h */
 } MonitorRule;
 
 typedef struct {
@@ -256,6 +355,7 @@ typedef struct {
 /* function declarations */
 static void applybounds(Client *c, struct wlr_box *bbox);
 static void applyrules(Client *c);
+static void applytitlerules(Client *c);
 static void arrange(Monitor *m);
 static void arrangelayer(Monitor *m, struct wl_list *list,
                          struct wlr_box *usable_area, int exclusive);
@@ -266,10 +366,15 @@ static void chvt(const Arg *arg);
 static void checkidleinhibitor(struct wlr_surface *exclude);
 static void cleanup(void);
 static void cleanupmon(struct wl_listener *listener, void *data);
+static const uint64_t *clientrules(Client *c, const char *appid,
+                                   const char *title);
+static void clientvecadd(Client *c);
+static void clientvecremove(Client *c);
 static void closemon(Monitor *m);
 static void commitlayersurfacenotify(struct wl_listener *listener, void *data);
 static void commitnotify(struct wl_listener *listener, void *data);
 static void commitpopup(struct wl_listener *listener, void *data);
+static int commitframe(Monitor *m, uint64_t framestart);
 static void createdecoration(struct wl_listener *listener, void *data);
 static void createidleinhibitor(struct wl_listener *listener, void *data);
 static void createkeyboard(struct wlr_keyboard *keyboard);
@@ -296,15 +401,26 @@ static void destroysessionlock(struct wl_listener *listener, void *data);
 static void destroysessionmgr(struct wl_listener *listener, void *data);
 static void destroykeyboardgroup(struct wl_listener *listener, void *data);
 static Monitor *dirtomon(enum wlr_direction dir);
+static void emitstatus(void *data);
 static void focusclient(Client *c, int lift);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
 static Client *focustop(Monitor *m);
+static int fpscapped(Client *c);
+static int fpsheld(Client *c, FrameDone *fd);
+static int fpstimeout(void *data);
 static void fullscreennotify(struct wl_listener *listener, void *data);
 static void gpureset(struct wl_listener *listener, void *data);
 static void handlesig(int signo);
+static void hotsync(Client *c);
 static void incnmaster(const Arg *arg);
 static void inputdevice(struct wl_listener *listener, void *data);
+static void inputmark(int kind);
+static void inputrendered(int framedone);
+static void ipcclient(IpcBuf *b, Client *c);
+static void ipcevent(int id, const SigArg *args, int nargs);
+static void ipcmonitor(IpcBuf *b, Monitor *m);
+static int ipcquery(const char *type, long long arg, IpcBuf *b);
 static int keybinding(uint32_t mods, xkb_keysym_t sym);
 static void keypress(struct wl_listener *listener, void *data);
 static void keypressmod(struct wl_listener *listener, void *data);
@@ -314,30 +430,42 @@ static void locksession(struct wl_listener *listener, void *data);
 static void mapnotify(struct wl_listener *listener, void *data);
 static void maximizenotify(struct wl_listener *listener, void *data);
 static void monocle(Monitor *m);
+static int montags(Monitor *m, uint32_t *occ, uint32_t *urg);
+static void monvecadd(Monitor *m);
+static void monvecremove(Monitor *m);
 static void motionabsolute(struct wl_listener *listener, void *data);
 static void motionnotify(uint32_t time, struct wlr_input_device *device,
                          double sx, double sy, double sx_unaccel,
                          double sy_unaccel);
 static void motionrelative(struct wl_listener *listener, void *data);
 static void moveresize(const Arg *arg);
+static void occlusionchanged(Monitor *m);
 static void outputmgrapply(struct wl_listener *listener, void *data);
 static void outputmgrapplyortest(struct wlr_output_configuration_v1 *config,
                                  int test);
 static void outputmgrtest(struct wl_listener *listener, void *data);
 static void pointerfocus(Client *c, struct wlr_surface *surface, double sx,
                          double sy, uint32_t time);
+static int pingclients(void *data);
+static void pingtimedout(struct wl_listener *listener, void *data);
 static void printstatus(void);
 static void powermgrsetmode(struct wl_listener *listener, void *data);
+static void presentmon(struct wl_listener *listener, void *data);
 static void quit(const Arg *arg);
+static void reindexclient(Client *c);
+static int renderdeadline(void *data);
+static uint64_t renderdelay(Monitor *m, uint64_t now);
 static void rendermon(struct wl_listener *listener, void *data);
 static void requestdecorationmode(struct wl_listener *listener, void *data);
 static void requeststartdrag(struct wl_listener *listener, void *data);
 static void requestmonstate(struct wl_listener *listener, void *data);
 static void resize(Client *c, struct wlr_box geo, int interact);
 static void run(char *startup_cmd);
+static void sendframedone(struct wlr_scene_node *node, FrameDone *fd);
 static void setcursor(struct wl_listener *listener, void *data);
 static void setcursorshape(struct wl_listener *listener, void *data);
 static void setfloating(Client *c, int floating);
+static void setframegraph(Monitor *m, int on);
 static void setfullscreen(Client *c, int fullscreen);
 static void setgamma(struct wl_listener *listener, void *data);
 static void setlayout(const Arg *arg);
@@ -345,6 +473,7 @@ static void setmfact(const Arg *arg);
 static void setmon(Client *c, Monitor *m, uint32_t newtags);
 static void setpsel(struct wl_listener *listener, void *data);
 static void setsel(struct wl_listener *listener, void *data);
+static void setunresponsive(Client *c, int unresponsive);
 static void setup(void);
 static void startdrag(struct wl_listener *listener, void *data);
 static void swapstack(const Arg *arg);
@@ -355,15 +484,23 @@ static void togglefloating(const Arg *arg);
 static void togglefullscreen(const Arg *arg);
 static void toggletag(const Arg *arg);
 static void toggleview(const Arg *arg);
+static int tracesignal(int signo, void *data);
 static void unlocksession(struct wl_listener *listener, void *data);
 static void unmaplayersurfacenotify(struct wl_listener *listener, void *data);
 static void unmapnotify(struct wl_listener *listener, void *data);
+static void updateappid(struct wl_listener *listener, void *data);
+static void updateframegraph(Monitor *m, uint64_t interval);
 static void updatemons(struct wl_listener *listener, void *data);
+static void updateocclusion(Monitor *m);
 static void updatetitle(struct wl_listener *listener, void *data);
 static void urgent(struct wl_listener *listener, void *data);
 static void view(const Arg *arg);
+static void viewchanged(Monitor *m, uint32_t old);
 static void virtualkeyboard(struct wl_listener *listener, void *data);
 static void virtualpointer(struct wl_listener *listener, void *data);
+static void visiblebuffer(struct wlr_scene_buffer *buffer, int sx, int sy,
+                          void *data);
+static void writestatuspage(void);
 static Monitor *xytomon(double x, double y);
 static void xytonode(double x, double y, struct wlr_surface **psurface,
                      Client **pc, LayerSurface **pl, double *nx, double *ny);
@@ -371,11 +508,33 @@ static void zoom(const Arg *arg);
 
 /* variables */
 static const char broken[] = "broken";
+static const float framegraphbg[] = {0.0f, 0.0f, 0.0f, 0.6f};
+static const float framegraphok[] = {0.2f, 0.8f, 0.3f, 1.0f};
+static const float framegraphlate[] = {0.9f, 0.2f, 0.2f, 1.0f};
+static const float framegraphtarget[] = {1.0f, 1.0f, 1.0f, 0.5f};
 static pid_t child_pid = -1;
 static int locked;
+static int ncapped; /* clients with a max_fps */
+static struct wl_event_source *pingtimer;
+static volatile sig_atomic_t running;
 static void *exclusive_focus;
 static struct wl_display *dpy;
 static struct wl_event_loop *event_loop;
+static struct wl_event_source *status_idle;
+static const char *const statuskeys[] = {"title",    "appid",  "fullscreen",
+                                         "floating", "selmon", "tags",
+                                         "layout"};
+static int statuscompact;
+static unsigned long statusseq;
+static unsigned int lastclientid;
+static SomewmStatusPage *statuspage;
+/* served by the "get_stats" IPC request, see "make bench" */
+static PerfStat maplatency, arrangestat, tagswitchstat;
+static InputLatency inputlat[InputLast];
+static const char *const inputnames[InputLast] = {"lua_key", "c_key", "focus",
+                                                  "move"};
+static uint64_t inputtime; /* perf_now() at the input being handled, or 0 */
+static char statuspath[256];
 static struct wlr_backend *backend;
 static struct wlr_scene *scene;
 static struct wlr_scene_tree *layers[NUM_LAYERS];
@@ -392,6 +551,15 @@ static struct wlr_xdg_activation_v1 *activation;
 static struct wlr_xdg_decoration_manager_v1 *xdg_decoration_mgr;
 static struct wl_list clients; /* tiling order */
 static struct wl_list fstack;  /* focus order */
+/* Dense arrays mirroring clients and mons for indexed access and for scans
+ * that do not care about order. clientvec is unordered: removal moves the
+ * last client into the freed slot. monvec keeps the order of mons. */
+static Client **clientvec;
+static size_t nclientvec, clientveccap;
+static Monitor **monvec;
+static size_t nmonvec, monveccap;
+static HotState hot; /* tags, monitor and flags of clientvec[i], see hotsync */
+static uint32_t lastmonid;
 static struct wlr_idle_notifier_v1 *idle_notifier;
 static struct wlr_idle_inhibit_manager_v1 *idle_inhibit_mgr;
 static struct wlr_layer_shell_v1 *layer_shell;
@@ -426,6 +594,9 @@ static struct wlr_box sgeom;
 static struct wl_list mons;
 static Monitor *selmon;
 
+static RuleMatcher *rulematcher;
+static ClientIndex *clientindex;
+
 #ifdef XWAYLAND
 static void activatex11(struct wl_listener *listener, void *data);
 static void associatex11(struct wl_listener *listener, void *data);
@@ -450,12 +621,7 @@ static xcb_atom_t netatom[NetLast];
 /* Lua API wrapper functions - these allow luaa.c to access client data
  * without circular dependencies */
 int lua_get_client_count(void) {
-  int count = 0;
-  Client *c;
-  wl_list_for_each(c, &clients, link) {
-    count++;
-  }
-  return count;
+  return nclientvec;
 }
 
 void *lua_get_focused_client(void) {
@@ -524,13 +690,35 @@ int lua_get_client_fullscreen(void *client) {
 }
 
 void *lua_get_client_by_index(int index) {
-  int i = 0;
-  Client *c;
-  wl_list_for_each(c, &clients, link) {
-    if (i == index) return c;
-    i++;
-  }
-  return NULL;
+  /* Slot order, not tiling order; use lua_get_next_client() for that */
+  return index >= 0 && (size_t)index < nclientvec ? clientvec[index] : NULL;
+}
+
+void *lua_get_next_client(void *prev) {
+  Client *c = (Client *)prev;
+  struct wl_list *next = c ? c->link.next : clients.next;
+  return next == &clients ? NULL : wl_container_of(next, c, link);
+}
+
+size_t lua_find_clients(const ClientQuery *q, void **out, size_t max) {
+  return clientindex_find(clientindex, q, out, max);
+}
+
+void lua_get_client_snapshot(void *client, LuaClientSnapshot *out) {
+  Client *c = (Client *)client;
+  out->title = client_get_title(c);
+  out->appid = client_get_appid(c);
+  out->pid = lua_get_client_pid(c);
+  out->x = c->geom.x;
+  out->y = c->geom.y;
+  out->width = c->geom.width;
+  out->height = c->geom.height;
+  out->tags = c->tags;
+  out->floating = c->isfloating;
+  out->fullscreen = c->isfullscreen;
+  out->urgent = c->isurgent;
+  out->visible = c->mon && VISIBLEON(c, c->mon);
+  out->monitor = c->mon;
 }
 
 /* Client manipulation wrapper functions for Lua API */
@@ -574,19 +762,56 @@ void lua_client_set_tags(void *client, uint32_t tags) {
   Client *c = (Client *)client;
   if (c && tags > 0) {
     c->tags = tags;
+    reindexclient(c);
     focusclient(focustop(selmon), 1);
     arrange(selmon);
   }
 }
 
+void lua_client_set_max_fps(void *client, const unsigned int fps[FpsLast]) {
+  Client *c = client;
+  int was;
+  if (!c)
+    return;
+  was = fpscapped(c);
+  memcpy(c->maxfps, fps, sizeof(c->maxfps));
+  /* mapnotify() counts the caps of a client that is not mapped yet */
+  if (client_surface(c) && client_surface(c)->mapped)
+    ncapped += fpscapped(c) - was;
+}
+
+void lua_client_get_max_fps(void *client, unsigned int fps[FpsLast]) {
+  Client *c = client;
+  if (c)
+    memcpy(fps, c->maxfps, sizeof(c->maxfps));
+}
+
+void lua_get_client_commit_stats(void *client, LuaCommitStats *out) {
+  Client *c = client;
+  uint64_t window;
+  if (!c)
+    return;
+  window = perf_now() - c->ratestart;
+  out->commits = c->commits;
+  out->frames_held = c->framesheld;
+  /* past a second without commits, the rate decays towards 0 */
+  out->rate = window < 1000000000ull || !c->ratestart
+                  ? c->commitrate
+                  : (double)c->ratecount * 1e9 / (double)window;
+}
+
+void lua_get_client_ping_stats(void *client, LuaPingStats *out) {
+  Client *c = client;
+  if (!c)
+    return;
+  out->responsive = !c->unresponsive;
+  out->missed = c->pingsmissed;
+  out->latency = c->ping;
+}
+
 /* Monitor wrapper functions for Lua API */
 int lua_get_monitor_count() {
-  int count = 0;
-  Monitor *m;
-  wl_list_for_each(m, &mons, link) {
-    count++;
-  }
-  return count;
+  return nmonvec;
 }
 
 void* lua_get_focused_monitor() {
@@ -594,13 +819,7 @@ void* lua_get_focused_monitor() {
 }
 
 void* lua_get_monitor_by_index(int index) {
-  int i = 0;
-  Monitor *m;
-  wl_list_for_each(m, &mons, link) {
-    if (i == index) return (void*)m;
-    i++;
-  }
-  return NULL;
+  return index >= 0 && (size_t)index < nmonvec ? (void*)monvec[index] : NULL;
 }
 
 const char* lua_get_monitor_name(void *monitor) {
@@ -682,9 +901,11 @@ void lua_focus_monitor(void *monitor) {
 void lua_set_monitor_tags(void *monitor, uint32_t tags) {
   Monitor *m = (Monitor*)monitor;
   if (m && tags > 0) {
+    uint32_t old = m->tagset[m->seltags];
     m->tagset[m->seltags] = tags;
     focusclient(focustop(m), 1);
     arrange(m);
+    viewchanged(m, old);
   }
 }
 
@@ -704,6 +925,52 @@ void lua_set_monitor_master_count(void *monitor, int count) {
   }
 }
 
+int lua_get_monitor_frame_stats(void *monitor, FrameStats *out) {
+  Monitor *m = monitor;
+  if (!m)
+    return 0;
+  *out = m->fstat;
+  out->refresh_mhz = m->wlr_output->refresh;
+  out->width = m->wlr_output->width;
+  out->height = m->wlr_output->height;
+  out->render_cost_ns = m->rendercost;
+  out->render_margin_ns = m->rendermargin;
+  out->occluded = m->occluded;
+  return 1;
+}
+
+void lua_reset_monitor_frame_stats(void *monitor) {
+  Monitor *m = monitor;
+  uint64_t last;
+  if (!m)
+    return;
+  /* keep the interval running across the reset */
+  last = m->fstat.last_frame;
+  memset(&m->fstat, 0, sizeof(m->fstat));
+  m->fstat.last_frame = last;
+}
+
+void lua_set_monitor_frame_overlay(void *monitor, int on) {
+  if (monitor)
+    setframegraph(monitor, on);
+}
+
+int lua_get_monitor_frame_overlay(void *monitor) {
+  Monitor *m = monitor;
+  return m && m->framegraph;
+}
+
+void lua_set_monitor_max_render_time(void *monitor, int ms) {
+  Monitor *m = monitor;
+  if (m && ms >= -1)
+    m->maxrendertime = ms;
+}
+
+int lua_get_monitor_max_render_time(void *monitor) {
+  Monitor *m = monitor;
+  return m ? m->maxrendertime : 0;
+}
+
 /* Tag wrapper functions for Lua API */
 int lua_get_tag_count() {
   return TAGCOUNT;
@@ -726,9 +993,11 @@ uint32_t lua_get_monitor_current_tags(void *monitor) {
 
 void lua_set_current_tags(uint32_t tags) {
   if (selmon && tags > 0) {
+    uint32_t old = selmon->tagset[selmon->seltags];
     selmon->tagset[selmon->seltags] = tags;
     focusclient(focustop(selmon), 1);
     arrange(selmon);
+    viewchanged(selmon, old);
   }
 }
 
@@ -736,47 +1005,32 @@ void lua_toggle_tag_view(uint32_t tags) {
   if (selmon && tags > 0) {
     uint32_t newtagset = selmon->tagset[selmon->seltags] ^ tags;
     if (newtagset) {
+      uint32_t old = selmon->tagset[selmon->seltags];
       selmon->tagset[selmon->seltags] = newtagset;
       focusclient(focustop(selmon), 1);
       arrange(selmon);
+      viewchanged(selmon, old);
     }
   }
 }
 
 uint32_t lua_get_occupied_tags() {
-  uint32_t occupied = 0;
-  Client *c;
-  wl_list_for_each(c, &clients, link) {
-    if (VISIBLEON(c, selmon)) {
-      occupied |= c->tags;
-    }
-  }
-  return occupied;
+  return lua_get_monitor_occupied_tags(selmon);
 }
 
 uint32_t lua_get_monitor_occupied_tags(void *monitor) {
   Monitor *m = (Monitor*)monitor;
-  uint32_t occupied = 0;
-  Client *c;
-  if (m) {
-    wl_list_for_each(c, &clients, link) {
-      if (VISIBLEON(c, m)) {
-        occupied |= c->tags;
-      }
-    }
-  }
-  return occupied;
+  HotMasks hm;
+  if (!m) return 0;
+  hotstate_scan(&hot, m->hotid, m->tagset[m->seltags], &hm, NULL);
+  return hm.visible;
 }
 
 uint32_t lua_get_urgent_tags() {
-  uint32_t urgent = 0;
-  Client *c;
-  wl_list_for_each(c, &clients, link) {
-    if (c->isurgent && VISIBLEON(c, selmon)) {
-      urgent |= c->tags;
-    }
-  }
-  return urgent;
+  HotMasks hm;
+  if (!selmon) return 0;
+  hotstate_scan(&hot, selmon->hotid, selmon->tagset[selmon->seltags], &hm, NULL);
+  return hm.visibleurgent;
 }
 
 /* Layer surface wrapper functions for Lua API */
@@ -877,8 +1131,9 @@ void applybounds(Client *c, struct wlr_box *bbox) {
 void applyrules(Client *c) {
   /* rule matching */
   const char *appid, *title;
+  const uint64_t *matched;
   uint32_t newtags = 0;
-  int i;
+  int i, j;
   const Rule *r;
   Monitor *mon = selmon, *m;
 
@@ -888,36 +1143,101 @@ void applyrules(Client *c) {
   if (!(title = client_get_title(c)))
     title = broken;
 
-  for (r = rules; r < END(rules); r++) {
-    if ((!r->title || strstr(title, r->title)) &&
-        (!r->id || strstr(appid, r->id))) {
-      c->isfloating = r->isfloating;
-      newtags |= r->tags;
-      i = 0;
-      wl_list_for_each(m, &mons, link) {
-        if (r->monitor == i++)
-          mon = m;
-      }
+  matched = clientrules(c, appid, title);
+  for (i = rulematcher_next(rulematcher, matched, 0); i >= 0;
+       i = rulematcher_next(rulematcher, matched, i + 1)) {
+    r = &rules[i];
+    c->isfloating = r->isfloating;
+    newtags |= r->tags;
+    j = 0;
+    wl_list_for_each(m, &mons, link) {
+      if (r->monitor == j++)
+        mon = m;
     }
   }
   setmon(c, mon, newtags);
 }
 
+void applytitlerules(Client *c) {
+  /* Many clients only set their real title after mapping. Apply the rules
+   * that start matching because of a title change; rules that stop matching
+   * are not undone. Nothing is applied when the matched set is unchanged. */
+  const char *appid, *title;
+  const uint64_t *matched;
+  uint64_t *old;
+  size_t nw = rulematcher_words(rulematcher);
+  uint32_t newtags = 0;
+  int i, j, floating = -1;
+  const Rule *r;
+  Monitor *mon = NULL, *m;
+
+  if (!c->rulematch || !c->ruletitledep || !client_surface(c)->mapped ||
+      client_get_parent(c))
+    return;
+  if (!(appid = client_get_appid(c)))
+    appid = broken;
+  if (!(title = client_get_title(c)))
+    title = broken;
+  if (!strcmp(c->ruletitle, title) && !strcmp(c->ruleappid, appid))
+    return;
+
+  old = ecalloc(nw, sizeof(*old));
+  memcpy(old, c->rulematch, nw * sizeof(*old));
+  matched = clientrules(c, appid, title);
+  for (i = rulematcher_next(rulematcher, matched, 0); i >= 0;
+       i = rulematcher_next(rulematcher, matched, i + 1)) {
+    if (old[i / 64] & (UINT64_C(1) << (i % 64)))
+      continue;
+    r = &rules[i];
+    floating = r->isfloating;
+    newtags |= r->tags;
+    j = 0;
+    wl_list_for_each(m, &mons, link) {
+      if (r->monitor == j++)
+        mon = m;
+    }
+  }
+  free(old);
+  if (floating < 0)
+    return;
+
+  c->isfloating = floating;
+  if (mon && mon != c->mon) {
+    setmon(c, mon, newtags);
+  } else {
+    if (newtags)
+      c->tags = newtags;
+    reindexclient(c);
+    setfloating(c, c->isfloating);
+    focusclient(focustop(selmon), 1);
+    arrange(c->mon);
+  }
+  printstatus();
+}
+
 void arrange(Monitor *m) {
+  TRACE_SCOPE("arrange");
   Client *c;
+  size_t i;
+  uint64_t start;
 
   if (!m->wlr_output->enabled)
     return;
+  start = perf_now();
 
-  wl_list_for_each(c, &clients, link) {
+  for (i = 0; i < nclientvec; i++) {
+    c = clientvec[i];
     if (c->mon == m) {
       wlr_scene_node_set_enabled(&c->scene->node, VISIBLEON(c, m));
-      client_set_suspended(c, !VISIBLEON(c, m));
+      if (!VISIBLEON(c, m))
+        c->occluded = 0;
+      client_set_suspended(c, !VISIBLEON(c, m) || c->occluded);
     }
   }
 
   wlr_scene_node_set_enabled(&m->fullscreen_bg->node,
                              (c = focustop(m)) && c->isfullscreen);
+  occlusionchanged(m);
 
   strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, LENGTH(m->ltsymbol));
 
@@ -938,6 +1258,7 @@ void arrange(Monitor *m) {
     m->lt[m->sellt]->arrange(m);
   motionnotify(0, NULL, 0, 0, 0, 0);
   checkidleinhibitor(NULL);
+  perfstat_since(&arrangestat, start);
 }
 
 void arrangelayer(Monitor *m, struct wl_list *list, struct wlr_box *usable_area,
@@ -970,6 +1291,7 @@ void arrangelayers(Monitor *m) {
   };
   if (!m->wlr_output->enabled)
     return;
+  occlusionchanged(m);
 
   /* Arrange exclusive surfaces from top->bottom */
   for (i = 3; i >= 0; i--)
@@ -1004,6 +1326,10 @@ void axisnotify(struct wl_listener *listener, void *data) {
   /* This event is forwarded by the cursor when a pointer emits an axis event,
    * for example when you move the scroll wheel. */
   struct wlr_pointer_axis_event *event = data;
+  if (recordfile)
+    record_write(RecAxis, (unsigned int)event->orientation,
+                 (int)(event->delta * 256), (int)event->delta_discrete,
+                 (unsigned int)event->source);
   wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
   /* TODO: allow usage of scroll whell for mousebindings, it can be implemented
    * checking the event's orientation and the delta of the event */
@@ -1020,6 +1346,8 @@ void buttonpress(struct wl_listener *listener, void *data) {
   Client *c;
   const Button *b;
 
+  if (recordfile)
+    record_write(RecButton, event->button, (unsigned int)event->state);
   wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
 
   switch (event->state) {
@@ -1031,8 +1359,10 @@ void buttonpress(struct wl_listener *listener, void *data) {
 
     /* Change focus if the button was _pressed_ over a client */
     xytonode(cursor->x, cursor->y, NULL, &c, NULL, NULL, NULL);
+    inputtime = perf_now();
     if (c && (!client_is_unmanaged(c) || client_wants_focus(c)))
       focusclient(c, 1);
+    inputtime = 0;
 
     keyboard = wlr_seat_get_keyboard(seat);
     mods = keyboard ? wlr_keyboard_get_modifiers(keyboard) : 0;
@@ -1091,6 +1421,12 @@ void cleanup(void) {
   wlr_xwayland_destroy(xwayland);
   xwayland = NULL;
 #endif
+  luasignal_set_loop(NULL);
+  luasignal_set_observer(NULL);
+  ipc_finish();
+  wl_event_source_remove(pingtimer);
+  statuspage_destroy(statuspage, statuspath);
+  statuspage = NULL;
   wl_display_destroy_clients(dpy);
   if (child_pid > 0) {
     kill(-child_pid, SIGTERM);
@@ -1105,6 +1441,11 @@ void cleanup(void) {
   wlr_backend_destroy(backend);
 
   wl_display_destroy(dpy);
+  rulematcher_destroy(rulematcher);
+  clientindex_destroy(clientindex);
+  free(clientvec);
+  free(monvec);
+  hotstate_finish(&hot);
   /* Destroy after the wayland display (when the monitors are already destroyed)
      to avoid destroying them with an invalid scene output. */
   wlr_scene_node_destroy(&scene->tree.node);
@@ -1115,6 +1456,10 @@ void cleanupmon(struct wl_listener *listener, void *data) {
   LayerSurface *l, *tmp;
   size_t i;
 
+  SIGEMIT(SigMonitorRemoved, ARGMONITOR(m));
+  if (recordfile)
+    record_write(RecOutputRemove, m->wlr_output->name);
+
   /* m->layers[i] are intentionally not unlinked */
   for (i = 0; i < LENGTH(m->layers); i++) {
     wl_list_for_each_safe(l, tmp, &m->layers[i], link)
@@ -1123,17 +1468,67 @@ void cleanupmon(struct wl_listener *listener, void *data) {
 
   wl_list_remove(&m->destroy.link);
   wl_list_remove(&m->frame.link);
+  wl_list_remove(&m->present.link);
+  wl_event_source_remove(m->rendertimer);
+  wl_event_source_remove(m->fpstimer);
   wl_list_remove(&m->link);
+  monvecremove(m);
   wl_list_remove(&m->request_state.link);
   m->wlr_output->data = NULL;
   wlr_output_layout_remove(output_layout, m->wlr_output);
   wlr_scene_output_destroy(m->scene_output);
 
   closemon(m);
+  setframegraph(m, 0);
   wlr_scene_node_destroy(&m->fullscreen_bg->node);
+  for (i = 0; i < StatusLast; i++)
+    free(m->status[i]);
   free(m);
 }
 
+/* The rules matching c, recomputed only when its app_id or title changed
+ * since the last call, so applyrules() in mapnotify() after the one in
+ * commitnotify() costs two string compares. */
+const uint64_t *clientrules(Client *c, const char *appid, const char *title) {
+  if (c->rulematch && !strcmp(c->ruleappid, appid) &&
+      !strcmp(c->ruletitle, title))
+    return c->rulematch;
+
+  if (!c->rulematch)
+    c->rulematch =
+        ecalloc(MAX(rulematcher_words(rulematcher), 1), sizeof(uint64_t));
+  free(c->ruleappid);
+  free(c->ruletitle);
+  if (!(c->ruleappid = strdup(appid)) || !(c->ruletitle = strdup(title)))
+    die("strdup:");
+  rulematcher_match(rulematcher, appid, title, c->rulematch);
+  c->ruletitledep = rulematcher_titledep(rulematcher, appid);
+  return c->rulematch;
+}
+
+void clientvecadd(Client *c) {
+  if (nclientvec == clientveccap) {
+    clientveccap = clientveccap ? 2 * clientveccap : 32;
+    if (!(clientvec = realloc(clientvec, clientveccap * sizeof(*clientvec))))
+      die("realloc:");
+  }
+  c->slot = nclientvec;
+  clientvec[nclientvec++] = c;
+  hotsync(c);
+}
+
+void clientvecremove(Client *c) {
+  Client *last;
+
+  if (c->slot < 0)
+    return;
+  hotstate_remove(&hot, c->slot);
+  last = clientvec[--nclientvec];
+  clientvec[c->slot] = last;
+  last->slot = c->slot;
+  c->slot = -1;
+}
+
 void closemon(Monitor *m) {
   /* update selmon if needed and
    * move closed monitor's clients to the focused one */
@@ -1165,6 +1560,40 @@ void closemon(Monitor *m) {
   printstatus();
 }
 
+int commitframe(Monitor *m, uint64_t framestart) {
+  /* wlr_scene_output_commit(), taken apart to see the damage it commits */
+  struct wlr_output_state state;
+  const pixman_box32_t *box;
+  uint64_t start = perf_now(), area = 0;
+  int ok, n;
+
+  if (!wlr_scene_output_needs_frame(m->scene_output)) {
+    m->fstat.idle++;
+    return FrameIdle;
+  }
+  wlr_output_state_init(&state);
+  ok = wlr_scene_output_build_state(m->scene_output, &state, NULL) &&
+       wlr_output_commit_state(m->wlr_output, &state);
+  if (ok) {
+    perfstat_since(&m->fstat.commit, start);
+    m->fstat.committed++;
+    m->fstat.last_frame = framestart;
+    if (state.committed & WLR_OUTPUT_STATE_DAMAGE) {
+      box = pixman_region32_rectangles(&state.damage, &n);
+      for (; n > 0; n--, box++)
+        area += (uint64_t)(box->x2 - box->x1) * (uint64_t)(box->y2 - box->y1);
+    } else {
+      area = (uint64_t)m->wlr_output->width * (uint64_t)m->wlr_output->height;
+    }
+    m->fstat.last_damage_px = area;
+    m->fstat.damage_px += area;
+  } else {
+    m->fstat.failed++;
+  }
+  wlr_output_state_finish(&state);
+  return ok ? FrameCommitted : FrameFailed;
+}
+
 void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
   LayerSurface *l = wl_container_of(listener, l, surface_commit);
   struct wlr_layer_surface_v1 *layer_surface = l->layer_surface;
@@ -1207,7 +1636,19 @@ void commitlayersurfacenotify(struct wl_listener *listener, void *data) {
 }
 
 void commitnotify(struct wl_listener *listener, void *data) {
+  TRACE_SCOPE("commitnotify");
   Client *c = wl_container_of(listener, c, commit);
+  uint64_t now = perf_now();
+
+  c->commits++;
+  if (now - c->ratestart >= 1000000000ull) {
+    c->commitrate = c->ratestart ? (double)c->ratecount * 1e9 /
+                                       (double)(now - c->ratestart)
+                                 : 0;
+    c->ratestart = now;
+    c->ratecount = 0;
+  }
+  c->ratecount++;
 
   if (c->surface.xdg->initial_commit) {
     /*
@@ -1233,6 +1674,19 @@ void commitnotify(struct wl_listener *listener, void *data) {
 
   if (client_surface(c)->mapped && c->mon)
     resize(c, c->geom, (c->isfloating && !c->isfullscreen));
+  /* new buffers only change what is covered with a new size or opaque
+   * region */
+  if (client_surface(c)->mapped &&
+      (client_surface(c)->current.width != c->surfacew ||
+       client_surface(c)->current.height != c->surfaceh ||
+       client_surface(c)->current.committed & WLR_SURFACE_STATE_OPAQUE_REGION)) {
+    c->surfacew = client_surface(c)->current.width;
+    c->surfaceh = client_surface(c)->current.height;
+    occlusionchanged(c->isfloating ? NULL : c->mon);
+  }
+  if (recordfile && client_surface(c)->mapped)
+    record_write(RecClientCommit, c->id, client_surface(c)->current.width,
+                 client_surface(c)->current.height);
 
   /* mark a pending resize as completed */
   if (c->resize && c->resize <= c->surface.xdg->current.configure_serial)
@@ -1395,6 +1849,7 @@ void createmon(struct wl_listener *listener, void *data) {
     return;
 
   m = wlr_output->data = ecalloc(1, sizeof(*m));
+  m->hotid = ++lastmonid;
   m->wlr_output = wlr_output;
 
   for (i = 0; i < LENGTH(m->layers); i++)
@@ -1411,6 +1866,7 @@ void createmon(struct wl_listener *listener, void *data) {
       m->nmaster = r->nmaster;
       m->lt[0] = r->lt;
       m->lt[1] = &layouts[LENGTH(layouts) > 1 && r->lt != &layouts[1]];
+      m->maxrendertime = r->maxrendertime;
       strncpy(m->ltsymbol, m->lt[m->sellt]->symbol, LENGTH(m->ltsymbol));
       wlr_output_state_set_scale(&state, r->scale);
       wlr_output_state_set_transform(&state, r->rr);
@@ -1426,7 +1882,11 @@ void createmon(struct wl_listener *listener, void *data) {
 
   /* Set up event listeners */
   LISTEN(&wlr_output->events.frame, &m->frame, rendermon);
+  LISTEN(&wlr_output->events.present, &m->present, presentmon);
   LISTEN(&wlr_output->events.destroy, &m->destroy, cleanupmon);
+  m->rendertimer = wl_event_loop_add_timer(event_loop, renderdeadline, m);
+  m->fpstimer = wl_event_loop_add_timer(event_loop, fpstimeout, m);
+  m->rendermargin = 2 * RENDER_MARGIN_MIN;
   LISTEN(&wlr_output->events.request_state, &m->request_state, requestmonstate);
 
   wlr_output_state_set_enabled(&state, 1);
@@ -1434,6 +1894,7 @@ void createmon(struct wl_listener *listener, void *data) {
   wlr_output_state_finish(&state);
 
   wl_list_insert(&mons, &m->link);
+  monvecadd(m);
   printstatus();
 
   /* The xdg-protocol specifies:
@@ -1459,6 +1920,11 @@ void createmon(struct wl_listener *listener, void *data) {
     wlr_output_layout_add_auto(output_layout, wlr_output);
   else
     wlr_output_layout_add(output_layout, wlr_output, m->m.x, m->m.y);
+  if (recordfile)
+    record_write(RecOutputAdd, wlr_output->name, m->m.x, m->m.y, m->m.width,
+                 m->m.height);
+
+  SIGEMIT(SigMonitorAdded, ARGMONITOR(m));
 }
 
 void createnotify(struct wl_listener *listener, void *data) {
@@ -1469,6 +1935,9 @@ void createnotify(struct wl_listener *listener, void *data) {
 
   /* Allocate a Client for this surface */
   c = toplevel->base->data = ecalloc(1, sizeof(*c));
+  c->id = ++lastclientid;
+  c->created = perf_now();
+  c->slot = -1;
   c->surface.xdg = toplevel->base;
   c->bw = borderpx;
 
@@ -1480,6 +1949,8 @@ void createnotify(struct wl_listener *listener, void *data) {
          fullscreennotify);
   LISTEN(&toplevel->events.request_maximize, &c->maximize, maximizenotify);
   LISTEN(&toplevel->events.set_title, &c->set_title, updatetitle);
+  LISTEN(&toplevel->events.set_app_id, &c->set_appid, updateappid);
+  LISTEN(&toplevel->base->events.ping_timeout, &c->ping_timeout, pingtimedout);
 }
 
 void createpointer(struct wlr_pointer *pointer) {
@@ -1614,6 +2085,7 @@ void destroylock(SessionLock *lock, int unlock) {
     goto destroy;
 
   wlr_scene_node_set_enabled(&locked_bg->node, 0);
+  occlusionchanged(NULL);
 
   focusclient(focustop(selmon), 0);
   motionnotify(0, NULL, 0, 0, 0, 0);
@@ -1657,7 +2129,9 @@ void destroynotify(struct wl_listener *listener, void *data) {
   
   wl_list_remove(&c->destroy.link);
   wl_list_remove(&c->set_title.link);
+  wl_list_remove(&c->set_appid.link);
   wl_list_remove(&c->fullscreen.link);
+  wl_list_remove(&c->ping_timeout.link);
 #ifdef XWAYLAND
   if (c->type != XDGShell) {
     wl_list_remove(&c->activate.link);
@@ -1672,6 +2146,9 @@ void destroynotify(struct wl_listener *listener, void *data) {
     wl_list_remove(&c->map.link);
     wl_list_remove(&c->unmap.link);
   }
+  free(c->rulematch);
+  free(c->ruleappid);
+  free(c->ruletitle);
   free(c);
 }
 
@@ -1722,7 +2199,77 @@ Monitor *dirtomon(enum wlr_direction dir) {
   return selmon;
 }
 
+void emitstatus(void *data) {
+  Monitor *m;
+  Client *c;
+  uint32_t occ, urg, sel;
+  const char *val[StatusLast], *p;
+  char fs[16], fl[16], sm[16], tags[64];
+  int i, changed, printed = 0;
+  IpcBuf b = {0};
+
+  status_idle = NULL;
+  wl_list_for_each(m, &mons, link) {
+    montags(m, &occ, &urg);
+    if ((c = focustop(m))) {
+      if (!(val[StatusTitle] = client_get_title(c)))
+        val[StatusTitle] = broken;
+      if (!(val[StatusAppid] = client_get_appid(c)))
+        val[StatusAppid] = broken;
+      snprintf(fs, sizeof(fs), "%d", c->isfullscreen);
+      snprintf(fl, sizeof(fl), "%d", c->isfloating);
+      val[StatusFullscreen] = fs;
+      val[StatusFloating] = fl;
+      sel = c->tags;
+    } else {
+      val[StatusTitle] = val[StatusAppid] = "";
+      val[StatusFullscreen] = val[StatusFloating] = "";
+      sel = 0;
+    }
+    snprintf(sm, sizeof(sm), "%u", m == selmon);
+    snprintf(tags, sizeof(tags),
+             "%" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32, occ,
+             m->tagset[m->seltags], sel, urg);
+    val[StatusSelmon] = sm;
+    val[StatusTags] = tags;
+    val[StatusLayout] = m->ltsymbol;
+
+    /* Only lines that changed since the last emission are written */
+    for (changed = i = 0; i < StatusLast; i++) {
+      if (m->status[i] && !strcmp(m->status[i], val[i]))
+        continue;
+      changed = 1;
+      free(m->status[i]);
+      if (!(m->status[i] = strdup(val[i])))
+        die("strdup:");
+      if (!printed++)
+        statusseq++;
+      if (!statuscompact) {
+        printf("%s %s %s\n", m->wlr_output->name, statuskeys[i], val[i]);
+        continue;
+      }
+      /* seq<TAB>output<TAB>key<TAB>value, with control characters blanked */
+      printf("%lu\t%s\t%s\t", statusseq, m->wlr_output->name, statuskeys[i]);
+      for (p = val[i]; *p; p++)
+        putchar((unsigned char)*p < ' ' ? ' ' : *p);
+      putchar('\n');
+    }
+
+    if (changed && ipc_wants("monitor::status")) {
+      b.len = 0;
+      ipcbuf_printf(&b, "\"seq\":%lu,\"monitor\":", statusseq);
+      ipcmonitor(&b, m);
+      ipc_broadcast("monitor::status", b.data, b.len);
+    }
+  }
+  free(b.data);
+  if (printed)
+    fflush(stdout);
+  writestatuspage();
+}
+
 void focusclient(Client *c, int lift) {
+  TRACE_SCOPE("focusclient");
   struct wlr_surface *old = seat->keyboard_state.focused_surface;
   int unused_lx, unused_ly, old_client_type;
   Client *old_c = NULL;
@@ -1732,11 +2279,14 @@ void focusclient(Client *c, int lift) {
     return;
 
   /* Raise client in stacking order if requested */
-  if (c && lift)
+  if (c && lift) {
     wlr_scene_node_raise_to_top(&c->scene->node);
+    occlusionchanged(c->isfloating ? NULL : c->mon);
+  }
 
   if (c && client_surface(c) == old)
     return;
+  inputmark(InputFocus);
 
   if ((old_client_type = toplevel_from_wlr_surface(old, &old_c, &old_l)) ==
       XDGShell) {
@@ -1751,6 +2301,7 @@ void focusclient(Client *c, int lift) {
     wl_list_insert(&fstack, &c->flink);
     selmon = c->mon;
     c->isurgent = 0;
+    hotsync(c);
     client_restack_surface(c);
 
     /* Don't change border color if there is an exclusive focus or we are
@@ -1781,7 +2332,7 @@ void focusclient(Client *c, int lift) {
     
     /* Fire unfocus event for old client */
     if (old_c && !client_is_unmanaged(old_c)) {
-      lua_event_emit(LUA_EVENT_CLIENT_UNFOCUS, old_c, NULL);
+      SIGEMIT(SigClientUnfocus, ARGCLIENT(old_c));
     }
   }
   printstatus();
@@ -1803,7 +2354,7 @@ void focusclient(Client *c, int lift) {
   
   /* Fire focus event for new client */
   if (!client_is_unmanaged(c)) {
-    lua_event_emit(LUA_EVENT_CLIENT_FOCUS, c, NULL);
+    SIGEMIT(SigClientFocus, ARGCLIENT(c));
   }
 }
 
@@ -1853,6 +2404,39 @@ Client *focustop(Monitor *m) {
   return NULL;
 }
 
+int fpscapped(Client *c) {
+  return c->maxfps[FpsFocused] || c->maxfps[FpsUnfocused];
+}
+
+int fpsheld(Client *c, FrameDone *fd) {
+  /* Whether c's max_fps for its current state holds back this frame-done.
+   * Only visible clients get here, see sendframedone() */
+  int state = c == fd->sel ? FpsFocused : FpsUnfocused;
+  uint64_t period, due;
+
+  if (!c->maxfps[state] || c->mon != fd->m)
+    return 0;
+  period = 1000000000ull / c->maxfps[state];
+  /* rather half a refresh period early than a whole one late */
+  due = c->lastframedone + period - MIN(period, fd->m->refreshns) / 2;
+  if (fd->t >= due) {
+    c->lastframedone = fd->t;
+    return 0;
+  }
+  c->framesheld++;
+  if (!fd->due || due < fd->due)
+    fd->due = due;
+  return 1;
+}
+
+int fpstimeout(void *data) {
+  /* A client held back by max_fps is due, even if nothing else is drawn */
+  Monitor *m = data;
+  if (m->wlr_output->enabled)
+    wlr_output_schedule_frame(m->wlr_output);
+  return 0;
+}
+
 void fullscreennotify(struct wl_listener *listener, void *data) {
   Client *c = wl_container_of(listener, c, fullscreen);
   setfullscreen(c, client_wants_fullscreen(c));
@@ -1900,6 +2484,29 @@ void handlesig(int signo) {
   }
 }
 
+void hotsync(Client *c) {
+  /* Must be called whenever c->tags, c->mon or a flag mirrored in hot
+   * changes; also tells Lua's property cache what did */
+  uint32_t flags;
+  unsigned int changed = 0;
+
+  if (c->slot < 0)
+    return;
+  flags = (c->isfloating ? HotFloating : 0) |
+          (c->isfullscreen ? HotFullscreen : 0) |
+          (c->isurgent ? HotUrgent : 0);
+  if ((size_t)c->slot < hot.n) {
+    if (hot.tags[c->slot] != c->tags)
+      changed |= ClientPropTags;
+    if ((hot.flags[c->slot] ^ flags) & HotFloating)
+      changed |= ClientPropFloating;
+    if ((hot.flags[c->slot] ^ flags) & HotFullscreen)
+      changed |= ClientPropFullscreen;
+  }
+  hotstate_set(&hot, c->slot, c->tags, c->mon ? c->mon->hotid : 0, flags);
+  lua_client_invalidate(c, changed);
+}
+
 void incnmaster(const Arg *arg) {
   if (!arg || !selmon)
     return;
@@ -1935,6 +2542,237 @@ void inputdevice(struct wl_listener *listener, void *data) {
   wlr_seat_set_capabilities(seat, caps);
 }
 
+void inputmark(int kind) {
+  /* The input being handled caused kind; its latency to the screen is taken
+   * by inputrendered() */
+  InputLatency *il = &inputlat[kind];
+
+  if (!inputtime)
+    return;
+  perfstat_since(&il->handled, inputtime);
+  if (!il->pending)
+    il->pending = inputtime;
+}
+
+void inputrendered(int framedone) {
+  InputLatency *il;
+
+  for (il = inputlat; il < END(inputlat); il++) {
+    if (!il->pending)
+      continue;
+    perfstat_since(framedone ? &il->frame : &il->commit, il->pending);
+    if (framedone)
+      il->pending = 0;
+  }
+}
+
+void ipcclient(IpcBuf *b, Client *c) {
+  LuaCommitStats cs;
+
+  ipcbuf_printf(b, "{\"id\":%u,\"title\":", c->id);
+  ipcbuf_json_string(b, client_get_title(c));
+  ipcbuf_append(b, ",\"appid\":", 9);
+  ipcbuf_json_string(b, client_get_appid(c));
+  ipcbuf_append(b, ",\"monitor\":", 11);
+  ipcbuf_json_string(b, c->mon ? c->mon->wlr_output->name : NULL);
+  ipcbuf_printf(b,
+                ",\"pid\":%d,\"tags\":%" PRIu32 ",\"floating\":%s"
+                ",\"fullscreen\":%s,\"urgent\":%s,\"focused\":%s"
+                ",\"geometry\":{\"x\":%d,\"y\":%d,\"width\":%d,"
+                "\"height\":%d}",
+                lua_get_client_pid(c), c->tags, c->isfloating ? "true" : "false",
+                c->isfullscreen ? "true" : "false",
+                c->isurgent ? "true" : "false",
+                c == focustop(selmon) ? "true" : "false", c->geom.x, c->geom.y,
+                c->geom.width, c->geom.height);
+  lua_get_client_commit_stats(c, &cs);
+  ipcbuf_printf(b,
+                ",\"commits\":%" PRIu64 ",\"commit_rate\":%.1f"
+                ",\"frames_held\":%" PRIu64 ",\"max_fps\":{\"focused\":%u"
+                ",\"unfocused\":%u}"
+                ",\"responsive\":%s,\"pings_missed\":%" PRIu64 ",\"ping\":",
+                cs.commits, cs.rate, cs.frames_held, c->maxfps[FpsFocused],
+                c->maxfps[FpsUnfocused],
+                c->unresponsive ? "false" : "true", c->pingsmissed);
+  perfstat_json(b, &c->ping);
+  ipcbuf_append(b, "}", 1);
+}
+
+void ipcevent(int id, const SigArg *args, int nargs) {
+  /* Forward the signals Lua sees to subscribed IPC connections, one field
+   * per payload value */
+  const char *name = luasignal_name(id);
+  const SigArg *a;
+  IpcBuf b = {0};
+
+  if (!name || !ipc_wants(name))
+    return;
+  for (a = args; a < args + nargs; a++) {
+    if (b.len)
+      ipcbuf_append(&b, ",", 1);
+    ipcbuf_json_string(&b, a->key);
+    ipcbuf_append(&b, ":", 1);
+    switch (a->type) {
+    case SigBool:
+      ipcbuf_printf(&b, "%s", a->v.b ? "true" : "false");
+      break;
+    case SigInt:
+      ipcbuf_printf(&b, "%lld", a->v.i);
+      break;
+    case SigString:
+      if (a->v.s)
+        ipcbuf_json_string(&b, a->v.s);
+      else
+        ipcbuf_append(&b, "null", 4);
+      break;
+    case SigClient:
+      if (a->v.p)
+        ipcclient(&b, a->v.p);
+      else
+        ipcbuf_append(&b, "null", 4);
+      break;
+    case SigMonitor:
+      if (a->v.p)
+        ipcbuf_json_string(&b, ((Monitor *)a->v.p)->wlr_output->name);
+      else
+        ipcbuf_append(&b, "null", 4);
+      break;
+    case SigBox:
+      ipcbuf_printf(&b, "{\"x\":%d,\"y\":%d,\"width\":%d,\"height\":%d}",
+                    a->v.box.x, a->v.box.y, a->v.box.width, a->v.box.height);
+      break;
+    default:
+      ipcbuf_append(&b, "null", 4);
+      break;
+    }
+  }
+  ipc_broadcast(name, b.data, b.len);
+  free(b.data);
+}
+
+void ipcmonitor(IpcBuf *b, Monitor *m) {
+  Client *c;
+  uint32_t occ, urg;
+
+  montags(m, &occ, &urg);
+  ipcbuf_append(b, "{\"name\":", 8);
+  ipcbuf_json_string(b, m->wlr_output->name);
+  ipcbuf_append(b, ",\"layout\":", 10);
+  ipcbuf_json_string(b, m->ltsymbol);
+  c = focustop(m);
+  ipcbuf_printf(b,
+                ",\"selected\":%s,\"tags\":%" PRIu32 ",\"occupied\":%" PRIu32
+                ",\"urgent\":%" PRIu32 ",\"focused\":%u,\"mfact\":%g"
+                ",\"nmaster\":%d,\"geometry\":{\"x\":%d,\"y\":%d,"
+                "\"width\":%d,\"height\":%d}}",
+                m == selmon ? "true" : "false", m->tagset[m->seltags], occ, urg,
+                c ? c->id : 0, (double)m->mfact, m->nmaster, m->m.x, m->m.y,
+                m->m.width, m->m.height);
+}
+
+int ipcquery(const char *type, long long arg, IpcBuf *b) {
+  Client *c;
+  Monitor *m;
+  uint32_t occ, urg;
+  int i, first = 1;
+
+  if (!strcmp(type, "get_clients")) {
+    ipcbuf_append(b, "[", 1);
+    wl_list_for_each(c, &clients, link) {
+      if (!first)
+        ipcbuf_append(b, ",", 1);
+      first = 0;
+      ipcclient(b, c);
+    }
+    ipcbuf_append(b, "]", 1);
+  } else if (!strcmp(type, "get_monitors")) {
+    ipcbuf_append(b, "[", 1);
+    wl_list_for_each(m, &mons, link) {
+      if (!first)
+        ipcbuf_append(b, ",", 1);
+      first = 0;
+      ipcmonitor(b, m);
+    }
+    ipcbuf_append(b, "]", 1);
+  } else if (!strcmp(type, "get_tags")) {
+    ipcbuf_append(b, "[", 1);
+    wl_list_for_each(m, &mons, link) {
+      montags(m, &occ, &urg);
+      for (i = 0; i < TAGCOUNT; i++) {
+        if (!first)
+          ipcbuf_append(b, ",", 1);
+        first = 0;
+        ipcbuf_append(b, "{\"monitor\":", 11);
+        ipcbuf_json_string(b, m->wlr_output->name);
+        ipcbuf_printf(b,
+                      ",\"index\":%d,\"mask\":%u,\"selected\":%s"
+                      ",\"occupied\":%s,\"urgent\":%s}",
+                      i + 1, 1u << i,
+                      (m->tagset[m->seltags] & (1u << i)) ? "true" : "false",
+                      (occ & (1u << i)) ? "true" : "false",
+                      (urg & (1u << i)) ? "true" : "false");
+      }
+    }
+    ipcbuf_append(b, "]", 1);
+  } else if (!strcmp(type, "get_stats")) {
+    ipcbuf_printf(b, "{\"clients\":%zu,\"rss_kb\":%ld,\"map_latency\":",
+                  nclientvec, perf_rss_kb());
+    perfstat_json(b, &maplatency);
+    ipcbuf_append(b, ",\"arrange\":", 11);
+    perfstat_json(b, &arrangestat);
+    ipcbuf_append(b, ",\"tag_switch\":", 14);
+    perfstat_json(b, &tagswitchstat);
+    ipcbuf_append(b, ",\"outputs\":[", 12);
+    wl_list_for_each(m, &mons, link) {
+      if (!first)
+        ipcbuf_append(b, ",", 1);
+      first = 0;
+      ipcbuf_append(b, "{\"name\":", 8);
+      ipcbuf_json_string(b, m->wlr_output->name);
+      ipcbuf_append(b, ",\"frame\":", 9);
+      perfstat_json(b, &m->fstat.render);
+      ipcbuf_append(b, ",\"commit\":", 10);
+      perfstat_json(b, &m->fstat.commit);
+      ipcbuf_append(b, ",\"interval\":", 12);
+      perfstat_json(b, &m->fstat.interval);
+      ipcbuf_printf(b,
+                    ",\"frames\":%" PRIu64 ",\"committed\":%" PRIu64
+                    ",\"missed\":%" PRIu64 ",\"skipped_resize\":%" PRIu64
+                    ",\"skipped_gamma\":%" PRIu64 ",\"damage_px\":%" PRIu64
+                    ",\"occluded\":%d}",
+                    m->fstat.frames, m->fstat.committed, m->fstat.missed,
+                    m->fstat.skipped_resize, m->fstat.skipped_gamma,
+                    m->fstat.damage_px, m->occluded);
+    }
+    ipcbuf_append(b, "],\"input\":{", 11);
+    for (i = 0; i < InputLast; i++) {
+      ipcbuf_printf(b, "%s\"%s\":{\"handled\":", i ? "," : "", inputnames[i]);
+      perfstat_json(b, &inputlat[i].handled);
+      ipcbuf_append(b, ",\"commit\":", 10);
+      perfstat_json(b, &inputlat[i].commit);
+      ipcbuf_append(b, ",\"frame\":", 9);
+      perfstat_json(b, &inputlat[i].frame);
+      ipcbuf_append(b, "}", 1);
+    }
+    ipcbuf_append(b, "}}", 2);
+  } else if (!strcmp(type, "reset_stats")) {
+    perfstat_reset(&maplatency);
+    perfstat_reset(&arrangestat);
+    perfstat_reset(&tagswitchstat);
+    memset(inputlat, 0, sizeof(inputlat));
+    wl_list_for_each(m, &mons, link)
+      lua_reset_monitor_frame_stats(m);
+    ipcbuf_append(b, "true", 4);
+  } else if (!strcmp(type, "view")) {
+    /* show the tags in arg on the focused monitor, as the view keybinding */
+    view(&(Arg){.ui = (uint32_t)arg});
+    ipcbuf_printf(b, "%" PRIu32, selmon ? selmon->tagset[selmon->seltags] : 0);
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
 int keybinding(uint32_t mods, xkb_keysym_t sym) {
   /*
    * Here we handle compositor keybindings. This is when the compositor is
@@ -1946,6 +2784,7 @@ int keybinding(uint32_t mods, xkb_keysym_t sym) {
    */
   const Key *k;
   char msg[256];
+  TRACE_SCOPE("keybinding");
 
   // Log the key press if logger is available
   if (L) {
@@ -1983,10 +2822,13 @@ if (CLEANMASK(mods) == CLEANMASK(lua_keys[i].mod) && sym == lua_keys[i].keysym)
     }
     
     lua_rawgeti(L, LUA_REGISTRYINDEX, lua_keys[i].press_ref);
+    TRACE_BEGIN("lua_key");
     if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
       fprintf(stderr, "Error calling Lua function: %s\n", lua_tostring(L, -1));
       lua_pop(L, 1);
     }
+    TRACE_END();
+    inputmark(InputLuaKey);
     return 1;
   }
 }
@@ -2008,7 +2850,10 @@ if (CLEANMASK(mods) == CLEANMASK(lua_keys[i].mod) && sym == lua_keys[i].keysym)
         }
       }
       
+      TRACE_BEGIN("c_key");
       k->func(&k->arg);
+      TRACE_END();
+      inputmark(InputCKey);
       return 1;
     }
   }
@@ -2031,6 +2876,7 @@ if (CLEANMASK(mods) == CLEANMASK(lua_keys[i].mod) && sym == lua_keys[i].keysym)
 }
 
 void keypress(struct wl_listener *listener, void *data) {
+  TRACE_SCOPE("keypress");
   int i;
   /* This event is raised when a key is pressed or released. */
   KeyboardGroup *group = wl_container_of(listener, group, key);
@@ -2046,13 +2892,17 @@ void keypress(struct wl_listener *listener, void *data) {
   int handled = 0;
   uint32_t mods = wlr_keyboard_get_modifiers(&group->wlr_group->keyboard);
 
+  if (recordfile)
+    record_write(RecKey, event->keycode, (unsigned int)event->state);
   wlr_idle_notifier_v1_notify_activity(idle_notifier, seat);
 
   /* On _press_ if there is no active screen locker,
    * attempt to process a compositor keybinding. */
   if (!locked && event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+    inputtime = perf_now();
     for (i = 0; i < nsyms; i++)
       handled = keybinding(mods, syms[i]) || handled;
+    inputtime = 0;
   }
 
   if (handled && group->wlr_group->keyboard.repeat_info.delay > 0) {
@@ -2079,7 +2929,11 @@ void keypressmod(struct wl_listener *listener, void *data) {
   /* This event is raised when a modifier key, such as shift or alt, is
    * pressed. We simply communicate this to the client. */
   KeyboardGroup *group = wl_container_of(listener, group, modifiers);
+  struct wlr_keyboard_modifiers *mods = &group->wlr_group->keyboard.modifiers;
 
+  if (recordfile)
+    record_write(RecModifiers, mods->depressed, mods->latched, mods->locked,
+                 mods->group);
   wlr_seat_set_keyboard(seat, &group->wlr_group->keyboard);
   /* Send modifiers to the client. */
   wlr_seat_keyboard_notify_modifiers(seat,
@@ -2112,6 +2966,7 @@ void locksession(struct wl_listener *listener, void *data) {
   struct wlr_session_lock_v1 *session_lock = data;
   SessionLock *lock;
   wlr_scene_node_set_enabled(&locked_bg->node, 1);
+  occlusionchanged(NULL);
   if (cur_lock) {
     wlr_session_lock_v1_destroy(session_lock);
     return;
@@ -2139,6 +2994,8 @@ void mapnotify(struct wl_listener *listener, void *data) {
   int i;
   enum StackInsertMode mode;
 
+  occlusionchanged(NULL);
+
   /* Create scene tree for this client and its border */
   c->scene = client_surface(c)->data = wlr_scene_tree_create(layers[LyrTile]);
   wlr_scene_node_set_enabled(&c->scene->node, c->type != XDGShell);
@@ -2147,8 +3004,13 @@ void mapnotify(struct wl_listener *listener, void *data) {
           ? wlr_scene_xdg_surface_create(c->scene, c->surface.xdg)
           : wlr_scene_subsurface_tree_create(c->scene, client_surface(c));
   c->scene->node.data = c->scene_surface->node.data = c;
+  ncapped += fpscapped(c);
 
   client_get_geometry(c, &c->geom);
+  if (recordfile)
+    record_write(RecClientMap, c->id, client_get_appid(c), client_get_title(c),
+                 client_surface(c)->current.width,
+                 client_surface(c)->current.height);
 
   /* Handle unmanaged clients first so we can return prior create borders */
   if (client_is_unmanaged(c)) {
@@ -2181,6 +3043,7 @@ void mapnotify(struct wl_listener *listener, void *data) {
     } else {
         wl_list_insert(clients.prev, &c->link);  // Add to end
     }
+    clientvecadd(c);
     wl_list_insert(&fstack, &c->flink);
 
   /* Set initial monitor, tags, floating status, and focus:
@@ -2193,6 +3056,7 @@ void mapnotify(struct wl_listener *listener, void *data) {
   } else {
     applyrules(c);
   }
+  reindexclient(c);
   printstatus();
 
 unset_fullscreen:
@@ -2207,7 +3071,12 @@ unset_fullscreen:
   lua_client_mapped(c);
   
   /* Fire Lua event for client map */
-  lua_event_emit(LUA_EVENT_CLIENT_MAP, c, NULL);
+  SIGEMIT(SigClientMap, ARGCLIENT(c));
+
+  if (c->created) {
+    perfstat_since(&maplatency, c->created);
+    c->created = 0;
+  }
 }
 
 void maximizenotify(struct wl_listener *listener, void *data) {
@@ -2242,6 +3111,38 @@ void monocle(Monitor *m) {
     wlr_scene_node_raise_to_top(&c->scene->node);
 }
 
+int montags(Monitor *m, uint32_t *occ, uint32_t *urg) {
+  /* Tags occupied by / urgent on m; returns the number of clients on m */
+  HotMasks hm;
+
+  hotstate_scan(&hot, m->hotid, m->tagset[m->seltags], &hm, NULL);
+  *occ = hm.occupied;
+  *urg = hm.urgent;
+  return hm.nclients;
+}
+
+void monvecadd(Monitor *m) {
+  /* mons is a stack, new monitors go first */
+  if (nmonvec == monveccap) {
+    monveccap = monveccap ? 2 * monveccap : 8;
+    if (!(monvec = realloc(monvec, monveccap * sizeof(*monvec))))
+      die("realloc:");
+  }
+  memmove(monvec + 1, monvec, nmonvec++ * sizeof(*monvec));
+  monvec[0] = m;
+}
+
+void monvecremove(Monitor *m) {
+  size_t i;
+
+  for (i = 0; i < nmonvec; i++) {
+    if (monvec[i] == m) {
+      memmove(monvec + i, monvec + i + 1, (--nmonvec - i) * sizeof(*monvec));
+      return;
+    }
+  }
+}
+
 void motionabsolute(struct wl_listener *listener, void *data) {
   /* This event is forwarded by the cursor when a pointer emits an _absolute_
    * motion event, from 0..1 on each axis. This happens, for example, when
@@ -2259,11 +3160,16 @@ void motionabsolute(struct wl_listener *listener, void *data) {
                                        event->y, &lx, &ly);
   dx = lx - cursor->x;
   dy = ly - cursor->y;
+  inputtime = perf_now();
   motionnotify(event->time_msec, &event->pointer->base, dx, dy, dx, dy);
+  inputtime = 0;
+  if (recordfile)
+    record_write(RecMotion, (int)(cursor->x * 256), (int)(cursor->y * 256));
 }
 
 void motionnotify(uint32_t time, struct wlr_input_device *device, double dx,
                   double dy, double dx_unaccel, double dy_unaccel) {
+  TRACE_SCOPE("motionnotify");
   double sx = 0, sy = 0, sx_confined, sy_confined;
   Client *c = NULL, *w = NULL;
   LayerSurface *l = NULL;
@@ -2331,6 +3237,7 @@ void motionnotify(uint32_t time, struct wlr_input_device *device, double dx,
                             .width = grabc->geom.width,
                             .height = grabc->geom.height},
            1);
+    inputmark(InputMove);
     return;
   } else if (cursor_mode == CurResize) {
     resize(grabc,
@@ -2360,8 +3267,12 @@ void motionrelative(struct wl_listener *listener, void *data) {
    * special configuration applied for the specific input device which
    * generated the event. You can pass NULL for the device if you want to move
    * the cursor around without any input. */
+  inputtime = perf_now();
   motionnotify(event->time_msec, &event->pointer->base, event->delta_x,
                event->delta_y, event->unaccel_dx, event->unaccel_dy);
+  inputtime = 0;
+  if (recordfile)
+    record_write(RecMotion, (int)(cursor->x * 256), (int)(cursor->y * 256));
 }
 
 void moveresize(const Arg *arg) {
@@ -2389,6 +3300,18 @@ void moveresize(const Arg *arg) {
   }
 }
 
+void occlusionchanged(Monitor *m) {
+  /* Something that can cover or uncover clients changed on m, or on every
+   * output if m is NULL: geometry, stacking, visible tags or what a surface
+   * declares opaque. updateocclusion() runs at m's next committed frame. */
+  if (m) {
+    m->occlusiondirty = 1;
+    return;
+  }
+  wl_list_for_each(m, &mons, link)
+    m->occlusiondirty = 1;
+}
+
 void outputmgrapply(struct wl_listener *listener, void *data) {
   struct wlr_output_configuration_v1 *config = data;
   outputmgrapplyortest(config, 0);
@@ -2488,43 +3411,81 @@ void pointerfocus(Client *c, struct wlr_surface *surface, double sx, double sy,
   wlr_seat_pointer_notify_motion(seat, time, sx, sy);
 }
 
-void printstatus(void) {
-  Monitor *m = NULL;
+void presentmon(struct wl_listener *listener, void *data) {
+  Monitor *m = wl_container_of(listener, m, present);
+  struct wlr_output_event_present *event = data;
+
+  if (!event->presented || !event->when)
+    return;
+  m->lastpresent = (uint64_t)event->when->tv_sec * 1000000000ull +
+                   (uint64_t)event->when->tv_nsec;
+  /* refresh is in ns here but in mHz on the output */
+  if (event->refresh > 0)
+    m->refreshns = (uint64_t)event->refresh;
+  else if (m->wlr_output->refresh > 0)
+    m->refreshns = 1000000000000ull / (uint64_t)m->wlr_output->refresh;
+  else
+    m->refreshns = 0;
+}
+
+int pingclients(void *data) {
+  /* Ping every mapped client once per pinginterval while it is visible:
+   * hidden and covered clients are suspended and not woken up for a ping,
+   * though one already sent is still followed. wlroots takes the pong
+   * without telling us, so look for it again after as long as the ping has
+   * been out: a pong is recorded at most about twice as late as it came,
+   * and never under 1 ms. The timer is also armed for the next ping due and
+   * the next pingtimeout to run out. */
+  uint64_t now = perf_now(), next = (uint64_t)pinginterval * 1000000, due;
+  size_t i;
   Client *c;
-  uint32_t occ, urg, sel;
-  const char *appid, *title;
 
-  wl_list_for_each(m, &mons, link) {
-    occ = urg = 0;
-    wl_list_for_each(c, &clients, link) {
-      if (c->mon != m)
-        continue;
-      occ |= c->tags;
-      if (c->isurgent)
-        urg |= c->tags;
+  for (i = 0; i < nclientvec; i++) {
+    c = clientvec[i];
+    if (c->pingsent && !client_ping_pending(c)) {
+      perfstat_add(&c->ping, now - c->pingsent);
+      c->pingsent = 0;
+      if (c->unresponsive)
+        setunresponsive(c, 0);
     }
-    if ((c = focustop(m))) {
-      title = client_get_title(c);
-      appid = client_get_appid(c);
-      printf("%s title %s\n", m->wlr_output->name, title ? title : broken);
-      printf("%s appid %s\n", m->wlr_output->name, appid ? appid : broken);
-      printf("%s fullscreen %d\n", m->wlr_output->name, c->isfullscreen);
-      printf("%s floating %d\n", m->wlr_output->name, c->isfloating);
-      sel = c->tags;
-    } else {
-      printf("%s title \n", m->wlr_output->name);
-      printf("%s appid \n", m->wlr_output->name);
-      printf("%s fullscreen \n", m->wlr_output->name);
-      printf("%s floating \n", m->wlr_output->name);
-      sel = 0;
+    if (!c->pingsent && VISIBLEON(c, c->mon) && !c->occluded) {
+      due = c->lastping + (uint64_t)pinginterval * 1000000;
+      if (now < due)
+        next = MIN(next, due - now);
+      else if (client_ping(c))
+        c->pingsent = c->lastping = now;
     }
-
-    printf("%s selmon %u\n", m->wlr_output->name, m == selmon);
-    printf("%s tags %" PRIu32 " %" PRIu32 " %" PRIu32 " %" PRIu32 "\n",
-           m->wlr_output->name, occ, m->tagset[m->seltags], sel, urg);
-    printf("%s layout %s\n", m->wlr_output->name, m->ltsymbol);
+    if (!c->pingsent)
+      continue;
+    next = MIN(next, MAX(now - c->pingsent, 1000000));
+    if (c->unresponsive)
+      continue;
+    due = c->pingsent + (uint64_t)pingtimeout * 1000000;
+    if (now >= due)
+      setunresponsive(c, 1);
+    else
+      next = MIN(next, due - now);
   }
-  fflush(stdout);
+  wl_event_source_timer_update(pingtimer, (int)((next + 999999) / 1000000));
+  return 0;
+}
+
+void pingtimedout(struct wl_listener *listener, void *data) {
+  /* wlroots gave up on the ping; pingclients() sends the next one */
+  Client *c = wl_container_of(listener, c, ping_timeout);
+  if (!c->pingsent)
+    return;
+  c->pingsent = 0;
+  c->pingsmissed++;
+  if (!c->unresponsive)
+    setunresponsive(c, 1);
+}
+
+void printstatus(void) {
+  /* Status is written once per event loop iteration, however many times the
+   * state changed during it. */
+  if (!status_idle)
+    status_idle = wl_event_loop_add_idle(event_loop, emitstatus, NULL);
 }
 
 void powermgrsetmode(struct wl_listener *listener, void *data) {
@@ -2542,23 +3503,105 @@ void powermgrsetmode(struct wl_listener *listener, void *data) {
   m->asleep = !event->mode;
 }
 
-void quit(const Arg *arg) { wl_display_terminate(dpy); }
+void quit(const Arg *arg) {
+  running = 0;
+  wl_display_terminate(dpy);
+}
+
+void reindexclient(Client *c) {
+  /* Lookups only see managed clients while they are mapped; unmapnotify
+   * removes them again */
+  struct wlr_surface *surface = client_surface(c);
+  hotsync(c);
+  if (client_is_unmanaged(c) || !surface || !surface->mapped)
+    return;
+  clientindex_update(clientindex, c, client_get_appid(c), client_get_title(c),
+                     lua_get_client_pid(c), c->tags, c->mon);
+}
+
+int renderdeadline(void *data) {
+  Monitor *m = data;
+
+  m->renderpending = 0;
+  if (!m->wlr_output->enabled)
+    return 0;
+  m->renderdue = 1;
+  rendermon(&m->frame, NULL);
+  m->renderdue = 0;
+  return 0;
+}
+
+uint64_t renderdelay(Monitor *m, uint64_t now) {
+  /* How long rendering can wait: until the next vblank, as predicted from
+   * the last one, minus a fixed budget or the measured cost of rendermon()
+   * plus a margin for the GPU work it only queues */
+  uint64_t next, budget;
+
+  if (!m->maxrendertime || !m->refreshns || !m->lastpresent)
+    return 0;
+  next = m->lastpresent + m->refreshns;
+  if (next <= now)
+    next += ((now - next) / m->refreshns + 1) * m->refreshns;
+  budget = m->maxrendertime > 0 ? (uint64_t)m->maxrendertime * 1000000ull
+                                : m->rendercost + m->rendermargin;
+  return next - now > budget ? next - now - budget : 0;
+}
 
 void rendermon(struct wl_listener *listener, void *data) {
   /* This function is called every time an output is ready to display a frame,
    * generally at the output's refresh rate (e.g. 60Hz). */
   Monitor *m = wl_container_of(listener, m, frame);
+  TRACE_SCOPE("rendermon");
   Client *c;
   struct wlr_output_state pending = {0};
   struct wlr_gamma_control_v1 *gamma_control;
   struct timespec now;
+  FrameDone fd;
+  size_t i;
+  int result = FrameFailed, late;
+  uint64_t start = perf_now(), interval, delay;
+
+  /* With maxrendertime, the frame event only arms rendertimer, which renders
+   * just in time for the next vblank */
+  if (m->renderpending)
+    return;
+  if (!m->renderdue && (delay = renderdelay(m, start)) >= 1000000) {
+    m->renderpending = 1;
+    wl_event_source_timer_update(m->rendertimer, (int)(delay / 1000000));
+    return;
+  }
+
+  m->fstat.frames++;
+  m->fstat.delayed += (uint64_t)m->renderdue;
+  if (m->fstat.last_frame) {
+    interval = start - m->fstat.last_frame;
+    perfstat_add(&m->fstat.interval, interval);
+    /* refresh is in mHz */
+    late = m->wlr_output->refresh > 0 &&
+           interval * (uint64_t)m->wlr_output->refresh * 2 > 3000000000000ull;
+    m->fstat.missed += (uint64_t)late;
+    /* a late frame that missed its vblank doubles the margin, which then
+     * shrinks back slowly */
+    if (m->lastdelayed && late)
+      m->rendermargin = MIN(2 * m->rendermargin, m->refreshns / 2);
+    else if (m->lastdelayed)
+      m->rendermargin = MAX(m->rendermargin - m->rendermargin / 64,
+                            RENDER_MARGIN_MIN);
+    if (m->framegraph)
+      updateframegraph(m, interval);
+    m->fstat.last_frame = 0;
+  }
+  m->lastdelayed = m->renderdue;
 
   /* Render if no XDG clients have an outstanding resize and are visible on
-   * this monitor. */
-  wl_list_for_each(c, &clients, link) {
-    if (c->resize && !c->isfloating && client_is_rendered_on_mon(c, m) &&
-        !client_is_stopped(c))
+   * this monitor, unless they stopped answering pings. */
+  for (i = 0; i < nclientvec; i++) {
+    c = clientvec[i];
+    if (c->resize && !c->isfloating && !c->unresponsive &&
+        client_is_rendered_on_mon(c, m) && !client_is_stopped(c)) {
+      m->fstat.skipped_resize++;
       goto skip;
+    }
   }
 
   /*
@@ -2581,18 +3624,45 @@ void rendermon(struct wl_listener *listener, void *data) {
       wlr_gamma_control_v1_send_failed_and_destroy(gamma_control);
       goto commit;
     }
+    TRACE_BEGIN("gamma_commit");
     wlr_output_commit_state(m->wlr_output, &pending);
+    TRACE_END();
     wlr_output_schedule_frame(m->wlr_output);
+    m->fstat.skipped_gamma++;
   } else {
   commit:
-    wlr_scene_output_commit(m->scene_output, NULL);
+    TRACE_BEGIN("scene_commit");
+    result = commitframe(m, start);
+    TRACE_END();
+    /* an idle frame presents nothing, so pending input waits for the frame
+     * that does */
+    if (result == FrameCommitted) {
+      inputrendered(0);
+      if (m->occlusiondirty)
+        updateocclusion(m);
+    }
   }
 
 skip:
   /* Let clients know a frame has been rendered */
   clock_gettime(CLOCK_MONOTONIC, &now);
-  wlr_scene_output_send_frame_done(m->scene_output, &now);
+  TRACE_BEGIN("frame_done");
+  if (ncapped) {
+    fd = (FrameDone){m, &now, perf_now(), focustop(selmon), 0};
+    sendframedone(&scene->tree.node, &fd);
+    if (fd.due)
+      wl_event_source_timer_update(
+          m->fpstimer, (int)MAX((fd.due - fd.t) / 1000000, 1));
+  } else {
+    wlr_scene_output_send_frame_done(m->scene_output, &now);
+  }
+  TRACE_END();
+  if (result == FrameCommitted)
+    inputrendered(1);
   wlr_output_state_finish(&pending);
+  perfstat_since(&m->fstat.render, start);
+  interval = perf_now() - start;
+  m->rendercost = MAX(interval, m->rendercost - m->rendercost / 32);
 }
 
 void requestdecorationmode(struct wl_listener *listener, void *data) {
@@ -2619,7 +3689,7 @@ void requestmonstate(struct wl_listener *listener, void *data) {
 
 void resize(Client *c, struct wlr_box geo, int interact) {
   struct wlr_box *bbox;
-  struct wlr_box clip;
+  struct wlr_box clip, old = c->geom;
 
   if (!c->mon || !client_surface(c)->mapped)
     return;
@@ -2647,15 +3717,44 @@ void resize(Client *c, struct wlr_box geo, int interact) {
       client_set_size(c, c->geom.width - 2 * c->bw, c->geom.height - 2 * c->bw);
   client_get_clip(c, &clip);
   wlr_scene_subsurface_tree_set_clip(&c->scene_surface->node, &clip);
+
+  if (!wlr_box_equal(&old, &c->geom)) {
+    occlusionchanged(c->isfloating ? NULL : c->mon);
+    lua_client_invalidate(c, ClientPropGeometry);
+    SIGEMIT(SigClientGeometry, ARGCLIENT(c), ARGBOX("old", old),
+            ARGBOX("new", c->geom));
+  }
 }
 
 void run(char *startup_cmd) {
   /* Add a Unix socket to the Wayland display. */
   const char *socket = wl_display_add_socket_auto(dpy);
+  const char *runtime;
+  char ipcpath[256];
+  struct pollfd pfd;
+  int i;
   if (!socket)
     die("startup: display_add_socket_auto");
   setenv("WAYLAND_DISPLAY", socket, 1);
 
+  /* IPC socket next to the Wayland one, advertised to children */
+  if ((runtime = getenv("XDG_RUNTIME_DIR"))) {
+    snprintf(ipcpath, sizeof(ipcpath), "%s/somewm-ipc.%s.sock", runtime,
+             socket);
+    if (ipc_init(event_loop, ipcpath, ipcquery) == 0) {
+      setenv("SOMEWM_SOCK", ipcpath, 1);
+      /* what ipcevent() and emitstatus() forward */
+      for (i = 0; i < SigBuiltinLast; i++)
+        ipc_add_event(luasignal_name(i));
+      ipc_add_event("monitor::status");
+      luasignal_set_observer(ipcevent);
+    }
+    snprintf(statuspath, sizeof(statuspath), "%s/somewm-status.%s", runtime,
+             socket);
+    if ((statuspage = statuspage_create(statuspath)))
+      setenv("SOMEWM_STATUS", statuspath, 1);
+  }
+
   /* Start the backend. This will enumerate outputs and inputs, become the DRM
    * master, etc */
   if (!wlr_backend_start(backend))
@@ -2700,11 +3799,58 @@ void run(char *startup_cmd) {
   wlr_cursor_warp_closest(cursor, NULL, cursor->x, cursor->y);
   wlr_cursor_set_xcursor(cursor, cursor_mgr, "default");
 
+  if (watchdog_start(WATCHDOG_DEFAULT_MS) < 0)
+    fprintf(stderr, "cannot start the stall watchdog: %s\n", strerror(errno));
+
   /* Run the Wayland event loop. This does not return until you exit the
    * compositor. Starting the backend rigged up all of the necessary event
    * loop configuration to listen to libinput events, DRM events, generate
-   * frame events at the refresh rate, and so on. */
-  wl_display_run(dpy);
+   * frame events at the refresh rate, and so on.
+   *
+   * This is wl_display_run(), with the waiting split out of
+   * wl_event_loop_dispatch() so that the watchdog only sees the loop busy
+   * while it handles events. */
+  pfd.fd = wl_event_loop_get_fd(event_loop);
+  pfd.events = POLLIN;
+  running = 1;
+  while (running) {
+    watchdog_busy();
+    wl_event_loop_dispatch(event_loop, 0);
+    wl_event_loop_dispatch_idle(event_loop);
+    wl_display_flush_clients(dpy);
+    watchdog_idle();
+    if (running && poll(&pfd, 1, -1) < 0 && errno != EINTR)
+      die("poll:");
+  }
+  watchdog_stop();
+}
+
+void sendframedone(struct wlr_scene_node *node, FrameDone *fd) {
+  /* wlr_scene_output_send_frame_done(), skipping the clients whose max_fps
+   * holds back this frame */
+  struct wlr_scene_tree *tree;
+  struct wlr_scene_buffer *buffer;
+  struct wlr_scene_node *child;
+
+  if (!node->enabled)
+    return;
+  if (node->type == WLR_SCENE_NODE_BUFFER) {
+    buffer = wlr_scene_buffer_from_node(node);
+    if (buffer->primary_output == fd->m->scene_output)
+      wlr_scene_buffer_send_frame_done(buffer, fd->now);
+    return;
+  }
+  if (node->type != WLR_SCENE_NODE_TREE)
+    return;
+  /* these layers hold nothing but client trees and fullscreen_bg rects */
+  if (node->data &&
+      (node->parent == layers[LyrTile] || node->parent == layers[LyrFloat] ||
+       node->parent == layers[LyrFS]) &&
+      fpsheld(node->data, fd))
+    return;
+  tree = wl_container_of(node, tree, node);
+  wl_list_for_each(child, &tree->children, link)
+    sendframedone(child, fd);
 }
 
 void setcursor(struct wl_listener *listener, void *data) {
@@ -2740,6 +3886,7 @@ void setcursorshape(struct wl_listener *listener, void *data) {
 void setfloating(Client *c, int floating) {
   Client *p = client_get_parent(c);
   c->isfloating = floating;
+  hotsync(c);
   /* If in floating layout do not change the client's layer */
   if (!c->mon || !client_surface(c)->mapped ||
       !c->mon->lt[c->mon->sellt]->arrange)
@@ -2752,11 +3899,40 @@ void setfloating(Client *c, int floating) {
   printstatus();
   
   /* Fire floating state change event */
-  lua_event_emit(LUA_EVENT_CLIENT_FLOATING, c, &floating);
+  SIGEMIT(SigClientFloating, ARGCLIENT(c), ARGBOOL("state", floating));
+}
+
+void setframegraph(Monitor *m, int on) {
+  /* Bars of the recent frame intervals in the top right corner, with a line
+   * at one refresh period; while shown, redrawing it keeps the output busy */
+  FrameGraph *g = m->framegraph;
+  struct wlr_scene_rect *target;
+  int i;
+
+  if (!on == !g)
+    return;
+  if (!on) {
+    wlr_scene_node_destroy(&g->tree->node);
+    free(g);
+    m->framegraph = NULL;
+    return;
+  }
+  g = ecalloc(1, sizeof(*g));
+  g->tree = wlr_scene_tree_create(layers[LyrBlock]);
+  wlr_scene_rect_create(g->tree, FRAMEGRAPH_W, FRAMEGRAPH_H, framegraphbg);
+  for (i = 0; i < FRAMEGRAPH_BARS; i++)
+    g->bars[i] = wlr_scene_rect_create(g->tree, FRAMEGRAPH_BAR, 0,
+                                       framegraphok);
+  target = wlr_scene_rect_create(g->tree, FRAMEGRAPH_W, 1, framegraphtarget);
+  wlr_scene_node_set_position(&target->node, 0, FRAMEGRAPH_H / 2);
+  wlr_scene_node_set_position(&g->tree->node,
+                              m->m.x + m->m.width - FRAMEGRAPH_W, m->m.y);
+  m->framegraph = g;
 }
 
 void setfullscreen(Client *c, int fullscreen) {
   c->isfullscreen = fullscreen;
+  hotsync(c);
   if (!c->mon || !client_surface(c)->mapped)
     return;
   c->bw = fullscreen ? 0 : borderpx;
@@ -2777,7 +3953,7 @@ void setfullscreen(Client *c, int fullscreen) {
   printstatus();
   
   /* Fire fullscreen state change event */
-  lua_event_emit(LUA_EVENT_CLIENT_FULLSCREEN, c, &fullscreen);
+  SIGEMIT(SigClientFullscreen, ARGCLIENT(c), ARGBOOL("state", fullscreen));
 }
 
 void setgamma(struct wl_listener *listener, void *data) {
@@ -2790,8 +3966,13 @@ void setgamma(struct wl_listener *listener, void *data) {
 }
 
 void setlayout(const Arg *arg) {
+  const Layout *old;
+  char oldsymbol[LENGTH(selmon->ltsymbol)];
+
   if (!selmon)
     return;
+  old = selmon->lt[selmon->sellt];
+  memcpy(oldsymbol, selmon->ltsymbol, sizeof(oldsymbol));
   if (!arg || !arg->v || arg->v != selmon->lt[selmon->sellt])
     selmon->sellt ^= 1;
   if (arg && arg->v)
@@ -2800,6 +3981,9 @@ void setlayout(const Arg *arg) {
           LENGTH(selmon->ltsymbol));
   arrange(selmon);
   printstatus();
+  if (old != selmon->lt[selmon->sellt])
+    SIGEMIT(SigMonitorLayout, ARGMONITOR(selmon),
+            ARGSTRING("old", oldsymbol), ARGSTRING("new", selmon->ltsymbol));
 }
 
 /* arg > 1.0 will set mfact absolutely */
@@ -2835,6 +4019,7 @@ void setmon(Client *c, Monitor *m, uint32_t newtags) {
     setfullscreen(c, c->isfullscreen);     /* This will call arrange(c->mon) */
     setfloating(c, c->isfloating);
   }
+  reindexclient(c);
   focusclient(focustop(selmon), 1);
 }
 
@@ -2856,8 +4041,21 @@ void setsel(struct wl_listener *listener, void *data) {
   wlr_seat_set_selection(seat, event->source, event->serial);
 }
 
+void setunresponsive(Client *c, int unresponsive) {
+  const char *appid = client_get_appid(c);
+
+  c->unresponsive = unresponsive;
+  fprintf(stderr, "client %u (%s) %s\n", c->id, appid ? appid : broken,
+          unresponsive ? "is not responding" : "is responding again");
+  /* rendermon() stops waiting for its resize */
+  if (unresponsive && c->resize && c->mon)
+    wlr_output_schedule_frame(c->mon->wlr_output);
+  SIGEMIT(SigClientUnresponsive, ARGCLIENT(c), ARGBOOL("state", unresponsive));
+}
+
 void setup(void) {
   int i, sig[] = {SIGCHLD, SIGINT, SIGTERM, SIGPIPE};
+  const char **ruleids, **ruletitles;
   struct sigaction sa = {.sa_flags = SA_RESTART, .sa_handler = handlesig};
   sigemptyset(&sa.sa_mask);
 
@@ -2867,10 +4065,29 @@ void setup(void) {
   wlr_log_init(log_level, NULL);
 
   sloppyfocus = get_config_bool("sloppyfocus", 0);
+  statuscompact = get_config_bool("status_compact", 0);
+
+  /* Compile rules[] once; applyrules() then scans each string a single time */
+  ruleids = ecalloc(LENGTH(rules), sizeof(*ruleids));
+  ruletitles = ecalloc(LENGTH(rules), sizeof(*ruletitles));
+  for (i = 0; i < (int)LENGTH(rules); i++) {
+    ruleids[i] = rules[i].id;
+    ruletitles[i] = rules[i].title;
+  }
+  rulematcher = rulematcher_create(ruleids, ruletitles, LENGTH(rules));
+  clientindex = clientindex_create();
+  free(ruleids);
+  free(ruletitles);
+
   /* The Wayland display is managed by libwayland. It handles accepting
    * clients from the Unix socket, manging Wayland globals, and so on. */
   dpy = wl_display_create();
   event_loop = wl_display_get_event_loop(dpy);
+  luasignal_set_loop(event_loop);
+  luasignal_set_deferred(get_config_bool("defer_signals", 0));
+  wl_event_loop_add_signal(event_loop, SIGUSR1, tracesignal, NULL);
+  pingtimer = wl_event_loop_add_timer(event_loop, pingclients, NULL);
+  wl_event_source_timer_update(pingtimer, pinginterval);
 
   /* The backend is a wlroots feature which abstracts the underlying input and
    * output hardware. The autocreate option will choose the most suitable
@@ -3094,6 +4311,7 @@ void tag(const Arg *arg) {
     return;
 
   sel->tags = arg->ui & TAGMASK;
+  reindexclient(sel);
   focusclient(focustop(selmon), 1);
   arrange(selmon);
   printstatus();
@@ -3106,6 +4324,7 @@ void tagmon(const Arg *arg) {
 }
 
 void tile(Monitor *m) {
+  TRACE_SCOPE("tile");
   unsigned int mw, my, ty;
   int i, n = 0;
   Client *c;
@@ -3165,21 +4384,44 @@ void toggletag(const Arg *arg) {
     return;
 
   sel->tags = newtags;
+  reindexclient(sel);
   focusclient(focustop(selmon), 1);
   arrange(selmon);
   printstatus();
 }
 
 void toggleview(const Arg *arg) {
-  uint32_t newtagset;
+  uint32_t newtagset, old;
+  uint64_t start = perf_now();
   if (!(newtagset =
             selmon ? selmon->tagset[selmon->seltags] ^ (arg->ui & TAGMASK) : 0))
     return;
 
+  old = selmon->tagset[selmon->seltags];
   selmon->tagset[selmon->seltags] = newtagset;
   focusclient(focustop(selmon), 1);
   arrange(selmon);
   printstatus();
+  viewchanged(selmon, old);
+  perfstat_since(&tagswitchstat, start);
+}
+
+int tracesignal(int signo, void *data) {
+  /* SIGUSR1 starts a trace, the next one writes it out */
+  const char *path;
+
+  if (!(tracing & TRACE_RECORD)) {
+    trace_start(0);
+    fprintf(stderr, "tracing started\n");
+    return 0;
+  }
+  trace_stop();
+  path = trace_default_path();
+  if (trace_dump(path) < 0)
+    fprintf(stderr, "cannot write trace to %s: %s\n", path, strerror(errno));
+  else
+    fprintf(stderr, "trace written to %s\n", path);
+  return 0;
 }
 
 void unlocksession(struct wl_listener *listener, void *data) {
@@ -3204,6 +4446,9 @@ void unmaplayersurfacenotify(struct wl_listener *listener, void *data) {
 void unmapnotify(struct wl_listener *listener, void *data) {
   /* Called when the surface is unmapped, and should no longer be shown. */
   Client *c = wl_container_of(listener, c, unmap);
+  occlusionchanged(NULL);
+  if (recordfile)
+    record_write(RecClientUnmap, c->id);
   if (c == grabc) {
     cursor_mode = CurNormal;
     grabc = NULL;
@@ -3216,18 +4461,57 @@ void unmapnotify(struct wl_listener *listener, void *data) {
     }
   } else {
     wl_list_remove(&c->link);
+    clientvecremove(c);
     setmon(c, NULL, 0);
     wl_list_remove(&c->flink);
+    clientindex_remove(clientindex, c);
   }
 
+  if (fpscapped(c))
+    ncapped--;
+  c->pingsent = 0;
+  c->unresponsive = 0;
+
   /* Fire Lua event for client unmap */
-  lua_event_emit(LUA_EVENT_CLIENT_UNMAP, c, NULL);
+  SIGEMIT(SigClientUnmap, ARGCLIENT(c));
   
   wlr_scene_node_destroy(&c->scene->node);
   printstatus();
   motionnotify(0, NULL, 0, 0, 0, 0);
 }
 
+void updateappid(struct wl_listener *listener, void *data) {
+  Client *c = wl_container_of(listener, c, set_appid);
+  lua_client_invalidate(c, ClientPropAppid);
+  reindexclient(c);
+}
+
+void updateframegraph(Monitor *m, uint64_t interval) {
+  FrameGraph *g = m->framegraph;
+  /* refresh is in mHz; without one, assume 60 Hz */
+  uint64_t period = m->wlr_output->refresh > 0
+                        ? 1000000000000ull / (uint64_t)m->wlr_output->refresh
+                        : 16666667;
+  uint64_t v;
+  int i, h;
+
+  g->intervals[g->head] = interval;
+  g->head = (g->head + 1) % FRAMEGRAPH_BARS;
+  /* oldest on the left */
+  for (i = 0; i < FRAMEGRAPH_BARS; i++) {
+    v = g->intervals[(g->head + (unsigned int)i) % FRAMEGRAPH_BARS];
+    h = v >= 2 * period ? FRAMEGRAPH_H
+                        : (int)(v * FRAMEGRAPH_H / (2 * period));
+    wlr_scene_rect_set_size(g->bars[i], FRAMEGRAPH_BAR, h);
+    wlr_scene_node_set_position(&g->bars[i]->node, i * (FRAMEGRAPH_BAR + 1),
+                                FRAMEGRAPH_H - h);
+    wlr_scene_rect_set_color(g->bars[i], 2 * v > 3 * period ? framegraphlate
+                                                            : framegraphok);
+  }
+  wlr_scene_node_set_position(&g->tree->node,
+                              m->m.x + m->m.width - FRAMEGRAPH_W, m->m.y);
+}
+
 void updatemons(struct wl_listener *listener, void *data) {
   /*
    * Called whenever the output layout changes: adding or removing a
@@ -3236,10 +4520,12 @@ void updatemons(struct wl_listener *listener, void *data) {
    * positions, focus, and the stored configuration in wlroots'
    * output-manager implementation.
    */
+  TRACE_SCOPE("updatemons");
   struct wlr_output_configuration_v1 *config =
       wlr_output_configuration_v1_create();
   Client *c;
   struct wlr_output_configuration_head_v1 *config_head;
+  struct wlr_box old;
   Monitor *m;
 
   /* First remove from the layout the disabled monitors */
@@ -3278,6 +4564,7 @@ void updatemons(struct wl_listener *listener, void *data) {
         wlr_output_configuration_head_v1_create(config, m->wlr_output);
 
     /* Get the effective monitor geometry to use for surfaces */
+    old = m->m;
     wlr_output_layout_get_box(output_layout, m->wlr_output, &m->m);
     m->w = m->m;
     wlr_scene_output_set_position(m->scene_output, m->m.x, m->m.y);
@@ -3299,6 +4586,9 @@ void updatemons(struct wl_listener *listener, void *data) {
     /* make sure fullscreen clients have the right size */
     if ((c = focustop(m)) && c->isfullscreen)
       resize(c, m->m, 0);
+    if (!wlr_box_equal(&old, &m->m))
+      SIGEMIT(SigMonitorGeometry, ARGMONITOR(m), ARGBOX("old", old),
+              ARGBOX("new", m->m));
 
     /* Try to re-set the gamma LUT when updating monitors,
      * it's only really needed when enabling a disabled output, but meh. */
@@ -3335,13 +4625,45 @@ void updatemons(struct wl_listener *listener, void *data) {
   wlr_output_manager_v1_set_configuration(output_mgr, config);
 }
 
+void updateocclusion(Monitor *m) {
+  /* A client on m's visible tags of which the scene graph shows nothing, as
+   * it is covered by opaque surfaces or fullscreen_bg, gets no frame
+   * callbacks from wlr_scene_output_send_frame_done(): suspend it as well,
+   * until any of it shows again. Run by rendermon() only after
+   * occlusionchanged(), once the new scene is committed. */
+  Client *c;
+  size_t i;
+  int visible;
+
+  m->occlusiondirty = 0;
+  m->occluded = 0;
+  for (i = 0; i < nclientvec; i++) {
+    c = clientvec[i];
+    if (c->mon != m || !VISIBLEON(c, m))
+      continue;
+    visible = 0;
+    wlr_scene_node_for_each_buffer(&c->scene_surface->node, visiblebuffer,
+                                   &visible);
+    if (c->occluded == visible) {
+      c->occluded = !visible;
+      client_set_suspended(c, c->occluded);
+    }
+    m->occluded += c->occluded;
+  }
+}
+
 void updatetitle(struct wl_listener *listener, void *data) {
   Client *c = wl_container_of(listener, c, set_title);
+  if (recordfile)
+    record_write(RecClientTitle, c->id, client_get_title(c));
+  lua_client_invalidate(c, ClientPropTitle);
+  reindexclient(c);
+  applytitlerules(c);
   if (c == focustop(c->mon))
     printstatus();
     
   /* Fire title change event */
-  lua_event_emit(LUA_EVENT_CLIENT_TITLE_CHANGE, c, NULL);
+  SIGEMIT(SigClientTitle, ARGCLIENT(c));
 }
 
 void urgent(struct wl_listener *listener, void *data) {
@@ -3352,6 +4674,7 @@ void urgent(struct wl_listener *listener, void *data) {
     return;
 
   c->isurgent = 1;
+  hotsync(c);
   printstatus();
 
   if (client_surface(c)->mapped)
@@ -3359,14 +4682,28 @@ void urgent(struct wl_listener *listener, void *data) {
 }
 
 void view(const Arg *arg) {
+  uint32_t old;
+  uint64_t start = perf_now();
+
   if (!selmon || (arg->ui & TAGMASK) == selmon->tagset[selmon->seltags])
     return;
+  old = selmon->tagset[selmon->seltags];
   selmon->seltags ^= 1; /* toggle sel tagset */
   if (arg->ui & TAGMASK)
     selmon->tagset[selmon->seltags] = arg->ui & TAGMASK;
   focusclient(focustop(selmon), 1);
   arrange(selmon);
   printstatus();
+  viewchanged(selmon, old);
+  perfstat_since(&tagswitchstat, start);
+}
+
+void viewchanged(Monitor *m, uint32_t old) {
+  /* Tell Lua and IPC that m now shows another tagset; call once m has been
+   * arranged */
+  if (old != m->tagset[m->seltags])
+    SIGEMIT(SigTagView, ARGMONITOR(m), ARGINT("old", old),
+            ARGINT("new", m->tagset[m->seltags]));
 }
 
 void virtualkeyboard(struct wl_listener *listener, void *data) {
@@ -3391,6 +4728,49 @@ void virtualpointer(struct wl_listener *listener, void *data) {
     wlr_cursor_map_input_to_output(cursor, device, event->suggested_output);
 }
 
+void visiblebuffer(struct wlr_scene_buffer *buffer, int sx, int sy,
+                   void *data) {
+  /* primary_output is NULL while none of the buffer is visible anywhere */
+  if (buffer->primary_output)
+    *(int *)data = 1;
+}
+
+void writestatuspage(void) {
+  /* Mirror the printstatus() data into the shared status page */
+  SomewmStatusMonitor *sm;
+  Monitor *m;
+  Client *c;
+  const char *s;
+  uint32_t n = 0;
+
+  if (!statuspage)
+    return;
+  statuspage_begin(statuspage);
+  wl_list_for_each(m, &mons, link) {
+    if (n == SOMEWM_STATUS_MONITORS)
+      break;
+    sm = &statuspage->mons[n++];
+    memset(sm, 0, sizeof(*sm));
+    snprintf(sm->name, sizeof(sm->name), "%s", m->wlr_output->name);
+    snprintf(sm->layout, sizeof(sm->layout), "%s", m->ltsymbol);
+    sm->selected = m == selmon;
+    sm->tagset = m->tagset[m->seltags];
+    sm->nclients = montags(m, &sm->occupied, &sm->urgent);
+    if ((c = focustop(m))) {
+      snprintf(sm->title, sizeof(sm->title), "%s",
+               (s = client_get_title(c)) ? s : broken);
+      snprintf(sm->appid, sizeof(sm->appid), "%s",
+               (s = client_get_appid(c)) ? s : broken);
+      sm->seltags = c->tags;
+      sm->fullscreen = c->isfullscreen;
+      sm->floating = c->isfloating;
+    }
+  }
+  statuspage->nmonitors = n;
+  statuspage->nclients = nclientvec;
+  statuspage_end(statuspage);
+}
+
 Monitor *xytomon(double x, double y) {
   struct wlr_output *o = wlr_output_layout_output_at(output_layout, x, y);
   return o ? o->data : NULL;
@@ -3502,6 +4882,9 @@ void createnotifyx11(struct wl_listener *listener, void *data) {
 
   /* Allocate a Client for this surface */
   c = xsurface->data = ecalloc(1, sizeof(*c));
+  c->id = ++lastclientid;
+  c->created = perf_now();
+  c->slot = -1;
   c->surface.xwayland = xsurface;
   c->type = X11;
   c->bw = client_is_unmanaged(c) ? 0 : borderpx;
@@ -3516,6 +4899,8 @@ void createnotifyx11(struct wl_listener *listener, void *data) {
          fullscreennotify);
   LISTEN(&xsurface->events.set_hints, &c->set_hints, sethints);
   LISTEN(&xsurface->events.set_title, &c->set_title, updatetitle);
+  LISTEN(&xsurface->events.set_class, &c->set_appid, updateappid);
+  LISTEN(&xsurface->events.ping_timeout, &c->ping_timeout, pingtimedout);
 }
 
 void dissociatex11(struct wl_listener *listener, void *data) {
@@ -3542,6 +4927,7 @@ void sethints(struct wl_listener *listener, void *data) {
     return;
 
   c->isurgent = xcb_icccm_wm_hints_get_urgency(c->surface.xwayland->hints);
+  hotsync(c);
   printstatus();
 
   if (c->isurgent && surface && surface->mapped)
@@ -3613,10 +4999,13 @@ int main(int argc, char *argv[]) {
   char *startup_cmd = NULL;
   int c;
 
-  while ((c = getopt(argc, argv, "s:hdv")) != -1) {
+  while ((c = getopt(argc, argv, "s:r:hdv")) != -1) {
     if (c == 's')
       startup_cmd = optarg;
-    else if (c == 'd')
+    else if (c == 'r') {
+      if (record_open(optarg) < 0)
+        die("cannot record to %s:", optarg);
+    } else if (c == 'd')
       log_level = WLR_DEBUG;
     else if (c == 'v')
       die("dwl " VERSION);
@@ -3637,8 +5026,9 @@ int main(int argc, char *argv[]) {
   run(startup_cmd);
   cleanup();
   cleanup_lua();
+  record_close();
   return EXIT_SUCCESS;
 
 usage:
-  die("Usage: %s [-v] [-d] [-s startup command]", argv[0]);
+  die("Usage: %s [-v] [-d] [-r recording] [-s startup command]", argv[0]);
 }
@@ -0,0 +1,246 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hotstate.h"
+#include "util.h"
+
+#if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#define HOT_X86
+#include <immintrin.h>
+#endif
+
+typedef struct {
+  uint32_t occ, urg, vis, visurg;
+  size_t nclients, nvisible;
+} Acc;
+
+/* A vector scan: scans a prefix of the slots and returns its length */
+typedef size_t (*ScanFunc)(const HotState *h, uint32_t mon, uint32_t tagset,
+                           Acc *a, uint64_t *visible);
+
+static int impl = -1;
+
+static void *erealloc(void *p, size_t size) {
+  if (!(p = realloc(p, size)))
+    die("realloc:");
+  return p;
+}
+
+void hotstate_set(HotState *h, size_t slot, uint32_t tags, uint32_t mon,
+                  uint32_t flags) {
+  if (slot == h->n) {
+    if (h->n == h->cap) {
+      h->cap = h->cap ? 2 * h->cap : 32;
+      h->tags = erealloc(h->tags, h->cap * sizeof(*h->tags));
+      h->mon = erealloc(h->mon, h->cap * sizeof(*h->mon));
+      h->flags = erealloc(h->flags, h->cap * sizeof(*h->flags));
+    }
+    h->n++;
+  }
+  h->tags[slot] = tags;
+  h->mon[slot] = mon;
+  h->flags[slot] = flags;
+}
+
+void hotstate_remove(HotState *h, size_t slot) {
+  size_t last;
+
+  if (slot >= h->n)
+    return;
+  last = --h->n;
+  h->tags[slot] = h->tags[last];
+  h->mon[slot] = h->mon[last];
+  h->flags[slot] = h->flags[last];
+}
+
+void hotstate_finish(HotState *h) {
+  free(h->tags);
+  free(h->mon);
+  free(h->flags);
+  memset(h, 0, sizeof(*h));
+}
+
+/* Scan slots [from, n) one at a time: the HotScalar implementation, and the
+ * end of the vector scans */
+static void scantail(const HotState *h, size_t from, uint32_t mon,
+                     uint32_t tagset, Acc *a, uint64_t *visible) {
+  uint32_t t, urgent;
+  size_t i;
+
+  for (i = from; i < h->n; i++) {
+    if (h->mon[i] != mon)
+      continue;
+    t = h->tags[i];
+    urgent = h->flags[i] & HotUrgent;
+    a->nclients++;
+    a->occ |= t;
+    if (urgent)
+      a->urg |= t;
+    if (!(t & tagset))
+      continue;
+    a->nvisible++;
+    a->vis |= t;
+    if (urgent)
+      a->visurg |= t;
+    if (visible)
+      visible[i / 64] |= UINT64_C(1) << (i % 64);
+  }
+}
+
+#ifdef HOT_X86
+static uint32_t hor128(__m128i x) {
+  x = _mm_or_si128(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+  x = _mm_or_si128(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (uint32_t)_mm_cvtsi128_si32(x);
+}
+
+static uint32_t hadd128(__m128i x) {
+  x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+  x = _mm_add_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+  return (uint32_t)_mm_cvtsi128_si32(x);
+}
+
+static size_t scansse2(const HotState *h, uint32_t mon, uint32_t tagset,
+                       Acc *a, uint64_t *visible) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i vmon = _mm_set1_epi32((int)mon);
+  const __m128i vtags = _mm_set1_epi32((int)tagset);
+  const __m128i vurg = _mm_set1_epi32(HotUrgent);
+  __m128i occ = zero, urg = zero, vis = zero, visurg = zero;
+  __m128i non = zero, nvis = zero; /* per-lane counts */
+  __m128i t, on, u, v;
+  size_t i, end = h->n & ~(size_t)3;
+  int visbits;
+
+  for (i = 0; i < end; i += 4) {
+    on = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(h->mon + i)), vmon);
+    t = _mm_and_si128(_mm_loadu_si128((const __m128i *)(h->tags + i)), on);
+    u = _mm_and_si128(_mm_loadu_si128((const __m128i *)(h->flags + i)), vurg);
+    u = _mm_cmpeq_epi32(u, vurg);
+    /* visible: on the monitor and sharing a tag with tagset */
+    v = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(t, vtags), zero), on);
+
+    occ = _mm_or_si128(occ, t);
+    urg = _mm_or_si128(urg, _mm_and_si128(t, u));
+    vis = _mm_or_si128(vis, _mm_and_si128(t, v));
+    visurg = _mm_or_si128(visurg, _mm_and_si128(t, _mm_and_si128(v, u)));
+
+    /* matching lanes are -1 */
+    non = _mm_sub_epi32(non, on);
+    nvis = _mm_sub_epi32(nvis, v);
+    if (visible && (visbits = _mm_movemask_ps(_mm_castsi128_ps(v))))
+      visible[i / 64] |= (uint64_t)visbits << (i % 64);
+  }
+  a->nclients += hadd128(non);
+  a->nvisible += hadd128(nvis);
+  a->occ |= hor128(occ);
+  a->urg |= hor128(urg);
+  a->vis |= hor128(vis);
+  a->visurg |= hor128(visurg);
+  return end;
+}
+
+__attribute__((target("avx2"))) static uint32_t hor256(__m256i x) {
+  return hor128(_mm_or_si128(_mm256_castsi256_si128(x),
+                             _mm256_extracti128_si256(x, 1)));
+}
+
+__attribute__((target("avx2"))) static uint32_t hadd256(__m256i x) {
+  return hadd128(_mm_add_epi32(_mm256_castsi256_si128(x),
+                               _mm256_extracti128_si256(x, 1)));
+}
+
+__attribute__((target("avx2"))) static size_t
+scanavx2(const HotState *h, uint32_t mon, uint32_t tagset, Acc *a,
+         uint64_t *visible) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i vmon = _mm256_set1_epi32((int)mon);
+  const __m256i vtags = _mm256_set1_epi32((int)tagset);
+  const __m256i vurg = _mm256_set1_epi32(HotUrgent);
+  __m256i occ = zero, urg = zero, vis = zero, visurg = zero;
+  __m256i non = zero, nvis = zero;
+  __m256i t, on, u, v;
+  size_t i, end = h->n & ~(size_t)7;
+  int visbits;
+
+  for (i = 0; i < end; i += 8) {
+    on = _mm256_cmpeq_epi32(
+        _mm256_loadu_si256((const __m256i *)(h->mon + i)), vmon);
+    t = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(h->tags + i)),
+                         on);
+    u = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(h->flags + i)),
+                         vurg);
+    u = _mm256_cmpeq_epi32(u, vurg);
+    v = _mm256_andnot_si256(
+        _mm256_cmpeq_epi32(_mm256_and_si256(t, vtags), zero), on);
+
+    occ = _mm256_or_si256(occ, t);
+    urg = _mm256_or_si256(urg, _mm256_and_si256(t, u));
+    vis = _mm256_or_si256(vis, _mm256_and_si256(t, v));
+    visurg = _mm256_or_si256(visurg,
+                             _mm256_and_si256(t, _mm256_and_si256(v, u)));
+
+    non = _mm256_sub_epi32(non, on);
+    nvis = _mm256_sub_epi32(nvis, v);
+    if (visible && (visbits = _mm256_movemask_ps(_mm256_castsi256_ps(v))))
+      visible[i / 64] |= (uint64_t)visbits << (i % 64);
+  }
+  a->nclients += hadd256(non);
+  a->nvisible += hadd256(nvis);
+  a->occ |= hor256(occ);
+  a->urg |= hor256(urg);
+  a->vis |= hor256(vis);
+  a->visurg |= hor256(visurg);
+  return end;
+}
+#endif
+
+#ifdef HOT_X86
+static const ScanFunc scanners[] = {
+    [HotSSE2] = scansse2,
+    [HotAVX2] = scanavx2,
+};
+#endif
+
+static int bestimpl(void) {
+#ifdef HOT_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return HotAVX2;
+  return HotSSE2;
+#else
+  return HotScalar;
+#endif
+}
+
+int hotstate_select(int want) {
+  int best = bestimpl();
+
+  impl = want < HotScalar ? HotScalar : want > best ? best : want;
+  return impl;
+}
+
+void hotstate_scan(const HotState *h, uint32_t mon, uint32_t tagset,
+                   HotMasks *out, uint64_t *visible) {
+  Acc a = {0};
+  size_t done = 0;
+
+  if (impl < 0)
+    impl = bestimpl();
+  if (visible)
+    memset(visible, 0, (h->n + 63) / 64 * sizeof(*visible));
+#ifdef HOT_X86
+  if (impl != HotScalar)
+    done = scanners[impl](h, mon, tagset, &a, visible);
+#endif
+  scantail(h, done, mon, tagset, &a, visible);
+
+  out->occupied = a.occ;
+  out->urgent = a.urg;
+  out->visible = a.vis;
+  out->visibleurgent = a.visurg;
+  out->nclients = a.nclients;
+  out->nvisible = a.nvisible;
+}
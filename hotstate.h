@@ -0,0 +1,57 @@
+/*
+ * Packed per-client hot state.
+ *
+ * The fields that status, occupancy and visibility scans read for every
+ * client (tags, monitor and state flags) are mirrored into parallel uint32_t
+ * arrays, indexed by the same slot as dwl.c's clientvec.  A scan over one
+ * monitor then touches three small contiguous arrays instead of chasing list
+ * links through large Client structs and dereferencing each c->mon, and is
+ * done four or eight clients at a time with SSE2 or AVX2 where available.
+ *
+ * Monitors are identified by a nonzero id; 0 means "no monitor".
+ */
+#ifndef HOTSTATE_H
+#define HOTSTATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum { HotFloating = 1 << 0, HotFullscreen = 1 << 1, HotUrgent = 1 << 2 };
+
+/* scan implementations, in order of preference */
+enum { HotScalar, HotSSE2, HotAVX2 };
+
+typedef struct {
+  uint32_t *tags, *mon, *flags;
+  size_t n, cap;
+} HotState;
+
+typedef struct {
+  uint32_t occupied;      /* tags of the clients on the monitor */
+  uint32_t urgent;        /* tags of its urgent clients */
+  uint32_t visible;       /* tags of its clients on the given tagset */
+  uint32_t visibleurgent; /* same, urgent clients only */
+  size_t nclients, nvisible;
+} HotMasks;
+
+/* set slot, which must be at most n; slot n appends */
+void hotstate_set(HotState *h, size_t slot, uint32_t tags, uint32_t mon,
+                  uint32_t flags);
+/* remove slot by moving the last slot into it, like clientvec */
+void hotstate_remove(HotState *h, size_t slot);
+void hotstate_finish(HotState *h);
+
+/*
+ * Compute the masks of monitor mon showing tagset.  If visible is not NULL
+ * it receives a bitset ((n + 63) / 64 words) of the slots visible on mon.
+ */
+void hotstate_scan(const HotState *h, uint32_t mon, uint32_t tagset,
+                   HotMasks *out, uint64_t *visible);
+
+/*
+ * Use the given implementation (clamped to what the CPU supports) for later
+ * scans and return the one selected; the default is the best available.
+ */
+int hotstate_select(int impl);
+
+#endif
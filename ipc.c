@@ -0,0 +1,604 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "ipc.h"
+#include "util.h"
+
+#define IPC_MAX_REQUEST (64 * 1024)
+#define IPC_MAX_PENDING (4 * 1024 * 1024)
+#define IPC_MAX_EVENTS 64
+
+typedef struct {
+  struct wl_list link;
+  int fd;
+  struct wl_event_source *source;
+  IpcBuf in, out;
+  size_t outpos; /* bytes of out already written */
+  uint64_t subs; /* bit per event id, see eventid() */
+  int dead;
+} IpcClient;
+
+static struct wl_event_loop *ipcloop;
+static struct wl_event_source *listensrc;
+static struct wl_event_source *reapsrc; /* frees dead clients, see reap() */
+static struct wl_list ipcclients;
+static IpcQueryFunc ipcquery;
+static int listenfd = -1;
+static char *sockpath;
+static char *eventnames[IPC_MAX_EVENTS];
+static int neventnames;
+
+void ipcbuf_append(IpcBuf *b, const char *s, size_t n) {
+  if (b->len + n + 1 > b->cap) {
+    b->cap = b->cap ? b->cap : 256;
+    while (b->len + n + 1 > b->cap)
+      b->cap *= 2;
+    if (!(b->data = realloc(b->data, b->cap)))
+      die("realloc:");
+  }
+  memcpy(b->data + b->len, s, n);
+  b->len += n;
+  b->data[b->len] = '\0';
+}
+
+void ipcbuf_printf(IpcBuf *b, const char *fmt, ...) {
+  char small[256];
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return;
+  if ((size_t)n < sizeof(small)) {
+    ipcbuf_append(b, small, (size_t)n);
+    return;
+  }
+  ipcbuf_append(b, "", 0);
+  while (b->len + (size_t)n + 1 > b->cap) {
+    b->cap *= 2;
+    if (!(b->data = realloc(b->data, b->cap)))
+      die("realloc:");
+  }
+  va_start(ap, fmt);
+  vsnprintf(b->data + b->len, (size_t)n + 1, fmt, ap);
+  va_end(ap);
+  b->len += (size_t)n;
+}
+
+void ipcbuf_json_string(IpcBuf *b, const char *s) {
+  const char *p;
+  char esc[8];
+
+  if (!s) {
+    ipcbuf_append(b, "null", 4);
+    return;
+  }
+  ipcbuf_append(b, "\"", 1);
+  for (p = s; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      esc[0] = '\\';
+      esc[1] = *p;
+      ipcbuf_append(b, esc, 2);
+    } else if ((unsigned char)*p < 0x20) {
+      snprintf(esc, sizeof(esc), "\\u%04x", (unsigned char)*p);
+      ipcbuf_append(b, esc, 6);
+    } else {
+      ipcbuf_append(b, p, 1);
+    }
+  }
+  ipcbuf_append(b, "\"", 1);
+}
+
+/* Index of an event name added with ipc_add_event(); -1 if unknown */
+static int eventid(const char *name) {
+  int i;
+
+  for (i = 0; i < neventnames; i++)
+    if (!strcmp(eventnames[i], name))
+      return i;
+  return -1;
+}
+
+static void clientdestroy(IpcClient *cl) {
+  wl_list_remove(&cl->link);
+  wl_event_source_remove(cl->source);
+  close(cl->fd);
+  free(cl->in.data);
+  free(cl->out.data);
+  free(cl);
+}
+
+/* Free the clients ipc_broadcast() found dead.  It cannot free them itself:
+ * a broadcast may run from within the request handler of one of them. */
+static void reap(void *data) {
+  IpcClient *cl, *tmp;
+
+  reapsrc = NULL;
+  wl_list_for_each_safe(cl, tmp, &ipcclients, link) {
+    if (cl->dead)
+      clientdestroy(cl);
+  }
+}
+
+/* Write as much queued output as the socket takes; -1 if the peer is gone */
+static int clientflush(IpcClient *cl) {
+  ssize_t n;
+
+  while (cl->outpos < cl->out.len) {
+    n = send(cl->fd, cl->out.data + cl->outpos, cl->out.len - cl->outpos,
+             MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (n <= 0)
+      return -1;
+    cl->outpos += (size_t)n;
+  }
+  if (cl->outpos == cl->out.len) {
+    cl->outpos = cl->out.len = 0;
+    wl_event_source_fd_update(cl->source, WL_EVENT_READABLE);
+  } else {
+    wl_event_source_fd_update(cl->source,
+                              WL_EVENT_READABLE | WL_EVENT_WRITABLE);
+  }
+  return 0;
+}
+
+static void clientsend(IpcClient *cl, const char *payload, size_t len) {
+  unsigned char hdr[4];
+
+  if (cl->dead)
+    return;
+  if (cl->out.len - cl->outpos + len + 4 > IPC_MAX_PENDING) {
+    /* Slow subscriber: drop it rather than buffering without bound */
+    fprintf(stderr, "ipc: dropping client %d, output queue full\n", cl->fd);
+    cl->dead = 1;
+    return;
+  }
+  /* Reclaim the already written prefix before growing the buffer */
+  if (cl->outpos && cl->out.len + len + 4 > cl->out.cap) {
+    memmove(cl->out.data, cl->out.data + cl->outpos,
+            cl->out.len - cl->outpos);
+    cl->out.len -= cl->outpos;
+    cl->outpos = 0;
+  }
+  hdr[0] = len & 0xff;
+  hdr[1] = (len >> 8) & 0xff;
+  hdr[2] = (len >> 16) & 0xff;
+  hdr[3] = (len >> 24) & 0xff;
+  ipcbuf_append(&cl->out, (const char *)hdr, 4);
+  ipcbuf_append(&cl->out, payload, len);
+  if (clientflush(cl) < 0)
+    cl->dead = 1;
+}
+
+/* Minimal JSON scanning for requests: objects, strings and skippable values */
+static const char *skipws(const char *p, const char *end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    p++;
+  return p;
+}
+
+/* Parse the four hex digits of a \u escape at p into *out */
+static const char *scanhex4(const char *p, const char *end, unsigned int *out) {
+  int i;
+
+  *out = 0;
+  for (i = 0; i < 4; i++, p++) {
+    if (p >= end)
+      return NULL;
+    if (*p >= '0' && *p <= '9')
+      *out = *out << 4 | (unsigned int)(*p - '0');
+    else if ((*p | 0x20) >= 'a' && (*p | 0x20) <= 'f')
+      *out = *out << 4 | (unsigned int)((*p | 0x20) - 'a' + 10);
+    else
+      return NULL;
+  }
+  return p;
+}
+
+/* Parse a JSON string at p into out (unescaped, truncated to size) */
+static const char *scanstring(const char *p, const char *end, char *out,
+                              size_t size) {
+  static const char escapes[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
+  const char *e;
+  char utf8[4];
+  unsigned int cp, lo;
+  size_t n = 0, len, i;
+  int cut = 0;
+
+  if (p >= end || *p != '"')
+    return NULL;
+  for (p++; p < end && *p != '"';) {
+    if (*p != '\\') {
+      utf8[0] = *p++;
+      len = 1;
+    } else if (++p == end) {
+      return NULL;
+    } else if (*p == 'u') {
+      if (!(p = scanhex4(p + 1, end, &cp)))
+        return NULL;
+      /* a high surrogate must be followed by an escaped low one */
+      if (cp >= 0xd800 && cp < 0xdc00) {
+        if (end - p < 2 || p[0] != '\\' || p[1] != 'u' ||
+            !(p = scanhex4(p + 2, end, &lo)) || lo < 0xdc00 || lo >= 0xe000)
+          return NULL;
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+      } else if (cp >= 0xdc00 && cp < 0xe000) {
+        return NULL;
+      }
+      if (cp < 0x80) {
+        utf8[0] = (char)cp;
+        len = 1;
+      } else if (cp < 0x800) {
+        utf8[0] = (char)(0xc0 | cp >> 6);
+        utf8[1] = (char)(0x80 | (cp & 0x3f));
+        len = 2;
+      } else if (cp < 0x10000) {
+        utf8[0] = (char)(0xe0 | cp >> 12);
+        utf8[1] = (char)(0x80 | (cp >> 6 & 0x3f));
+        utf8[2] = (char)(0x80 | (cp & 0x3f));
+        len = 3;
+      } else {
+        utf8[0] = (char)(0xf0 | cp >> 18);
+        utf8[1] = (char)(0x80 | (cp >> 12 & 0x3f));
+        utf8[2] = (char)(0x80 | (cp >> 6 & 0x3f));
+        utf8[3] = (char)(0x80 | (cp & 0x3f));
+        len = 4;
+      }
+    } else {
+      for (e = escapes; *e && *e != *p; e += 2)
+        ;
+      if (!*e)
+        return NULL;
+      utf8[0] = e[1];
+      len = 1;
+      p++;
+    }
+    /* whole characters only, so a cut string is still valid UTF-8 */
+    if (out && !cut && n + len < size) {
+      for (i = 0; i < len; i++)
+        out[n++] = utf8[i];
+    } else {
+      cut = 1;
+    }
+  }
+  if (out && size)
+    out[n] = '\0';
+  return p < end ? p + 1 : NULL;
+}
+
+/* Parse a JSON integer at p into *out; values beyond long long are
+ * rejected */
+static const char *scaninteger(const char *p, const char *end, long long *out) {
+  int neg = 0, digits = 0;
+  long long v = 0;
+
+  if (p < end && *p == '-') {
+    neg = 1;
+    p++;
+  }
+  for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+    if (v > (LLONG_MAX - (*p - '0')) / 10)
+      return NULL;
+    v = v * 10 + (*p - '0');
+  }
+  if (!digits)
+    return NULL;
+  *out = neg ? -v : v;
+  return p;
+}
+
+/* Skip one value, stopping at the ',' or '}' that follows it */
+static const char *skipvalue(const char *p, const char *end) {
+  int depth = 0;
+
+  while (p < end) {
+    if (*p == '"') {
+      if (!(p = scanstring(p, end, NULL, 0)))
+        return NULL;
+      continue;
+    }
+    if (*p == '{' || *p == '[') {
+      depth++;
+    } else if (*p == '}' || *p == ']') {
+      if (!depth)
+        return p;
+      depth--;
+    } else if (*p == ',' && !depth) {
+      return p;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+static void replyerror(IpcClient *cl, const char *type, const char *msg) {
+  IpcBuf b = {0};
+
+  ipcbuf_append(&b, "{\"type\":", 8);
+  ipcbuf_json_string(&b, type);
+  ipcbuf_append(&b, ",\"success\":false,\"error\":", 25);
+  ipcbuf_json_string(&b, msg);
+  ipcbuf_append(&b, "}", 1);
+  clientsend(cl, b.data, b.len);
+  free(b.data);
+}
+
+static void handlerequest(IpcClient *cl, const char *p, const char *end) {
+  char key[32], type[64] = "", name[128];
+  long long arg = 0;
+  uint64_t subs = 0;
+  int havesubs = 0, unknown = 0, id;
+  IpcBuf b = {0};
+
+  p = skipws(p, end);
+  if (p >= end || *p++ != '{')
+    goto malformed;
+  for (;;) {
+    p = skipws(p, end);
+    if (p < end && *p == '}')
+      break;
+    if (!(p = scanstring(p, end, key, sizeof(key))))
+      goto malformed;
+    p = skipws(p, end);
+    if (p >= end || *p++ != ':')
+      goto malformed;
+    p = skipws(p, end);
+    if (!strcmp(key, "type")) {
+      if (!(p = scanstring(p, end, type, sizeof(type))))
+        goto malformed;
+    } else if (!strcmp(key, "arg") && p < end && *p != '"') {
+      if (!(p = scaninteger(p, end, &arg)))
+        goto malformed;
+    } else if (!strcmp(key, "events") && p < end && *p == '[') {
+      havesubs = 1;
+      for (p++;;) {
+        p = skipws(p, end);
+        if (p < end && *p == ']') {
+          p++;
+          break;
+        }
+        if (!(p = scanstring(p, end, name, sizeof(name))))
+          goto malformed;
+        if (!strcmp(name, "*"))
+          subs = ~UINT64_C(0);
+        else if ((id = eventid(name)) >= 0)
+          subs |= UINT64_C(1) << id;
+        else
+          unknown = 1;
+        p = skipws(p, end);
+        if (p < end && *p == ',')
+          p++;
+      }
+    } else if (!(p = skipvalue(p, end))) {
+      goto malformed;
+    }
+    p = skipws(p, end);
+    if (p < end && *p == ',')
+      p++;
+  }
+
+  if (!strcmp(type, "subscribe")) {
+    if (unknown) {
+      replyerror(cl, type, "unknown event");
+      return;
+    }
+    cl->subs = havesubs ? subs : ~UINT64_C(0);
+    ipcbuf_append(&b, "{\"type\":\"subscribe\",\"success\":true}", 35);
+    clientsend(cl, b.data, b.len);
+    free(b.data);
+    return;
+  }
+
+  ipcbuf_append(&b, "{\"type\":", 8);
+  ipcbuf_json_string(&b, type);
+  ipcbuf_append(&b, ",\"success\":true,\"result\":", 25);
+  if (!*type || !ipcquery || !ipcquery(type, arg, &b)) {
+    free(b.data);
+    replyerror(cl, type, "unknown request type");
+    return;
+  }
+  ipcbuf_append(&b, "}", 1);
+  clientsend(cl, b.data, b.len);
+  free(b.data);
+  return;
+
+malformed:
+  free(b.data);
+  replyerror(cl, type, "malformed request");
+}
+
+static int clientevent(int fd, uint32_t mask, void *data) {
+  IpcClient *cl = data;
+  char buf[4096];
+  size_t off = 0, len;
+  ssize_t n;
+  const unsigned char *h;
+
+  if (mask & WL_EVENT_WRITABLE && clientflush(cl) < 0)
+    cl->dead = 1;
+
+  while (!cl->dead && mask & WL_EVENT_READABLE) {
+    n = recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (n <= 0) {
+      cl->dead = 1;
+      break;
+    }
+    ipcbuf_append(&cl->in, buf, (size_t)n);
+  }
+
+  /* Dispatch every complete frame */
+  while (!cl->dead && cl->in.len - off >= 4) {
+    h = (const unsigned char *)cl->in.data + off;
+    len = (size_t)h[0] | (size_t)h[1] << 8 | (size_t)h[2] << 16 |
+          (size_t)h[3] << 24;
+    if (len > IPC_MAX_REQUEST) {
+      cl->dead = 1;
+      break;
+    }
+    if (cl->in.len - off - 4 < len)
+      break;
+    handlerequest(cl, cl->in.data + off + 4, cl->in.data + off + 4 + len);
+    off += 4 + len;
+  }
+  if (off) {
+    memmove(cl->in.data, cl->in.data + off, cl->in.len - off);
+    cl->in.len -= off;
+  }
+
+  if (cl->dead || mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR))
+    clientdestroy(cl);
+  return 0;
+}
+
+static int listenevent(int fd, uint32_t mask, void *data) {
+  IpcClient *cl;
+  int cfd;
+
+  while ((cfd = accept(fd, NULL, NULL)) >= 0) {
+    if (fd_set_nonblock(cfd) < 0 || fcntl(cfd, F_SETFD, FD_CLOEXEC) < 0) {
+      close(cfd);
+      continue;
+    }
+    cl = ecalloc(1, sizeof(*cl));
+    cl->fd = cfd;
+    cl->source = wl_event_loop_add_fd(ipcloop, cfd, WL_EVENT_READABLE,
+                                      clientevent, cl);
+    wl_list_insert(&ipcclients, &cl->link);
+  }
+  return 0;
+}
+
+int ipc_init(struct wl_event_loop *loop, const char *path,
+             IpcQueryFunc query) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "ipc: socket path too long: %s\n", path);
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  if ((listenfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+    perror("ipc: socket");
+    return -1;
+  }
+  if (fd_set_nonblock(listenfd) < 0 ||
+      fcntl(listenfd, F_SETFD, FD_CLOEXEC) < 0)
+    goto fail;
+  unlink(path);
+  if (bind(listenfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(listenfd, 16) < 0) {
+    perror("ipc: bind");
+    goto fail;
+  }
+
+  if (!(sockpath = strdup(path)))
+    die("strdup:");
+  ipcloop = loop;
+  ipcquery = query;
+  wl_list_init(&ipcclients);
+  listensrc =
+      wl_event_loop_add_fd(loop, listenfd, WL_EVENT_READABLE, listenevent, NULL);
+  return 0;
+
+fail:
+  close(listenfd);
+  listenfd = -1;
+  return -1;
+}
+
+void ipc_finish(void) {
+  IpcClient *cl, *tmp;
+  int i;
+
+  if (listenfd < 0)
+    return;
+  wl_list_for_each_safe(cl, tmp, &ipcclients, link)
+      clientdestroy(cl);
+  if (reapsrc)
+    wl_event_source_remove(reapsrc);
+  reapsrc = NULL;
+  wl_event_source_remove(listensrc);
+  close(listenfd);
+  listenfd = -1;
+  unlink(sockpath);
+  free(sockpath);
+  for (i = 0; i < neventnames; i++)
+    free(eventnames[i]);
+  neventnames = 0;
+}
+
+int ipc_add_event(const char *event) {
+  int id = eventid(event);
+
+  if (id >= 0)
+    return id;
+  if (neventnames == IPC_MAX_EVENTS)
+    return -1;
+  if (!(eventnames[neventnames] = strdup(event)))
+    die("strdup:");
+  return neventnames++;
+}
+
+int ipc_wants(const char *event) {
+  IpcClient *cl;
+  int id;
+
+  if (listenfd < 0 || wl_list_empty(&ipcclients))
+    return 0;
+  id = eventid(event);
+  wl_list_for_each(cl, &ipcclients, link) {
+    if (cl->dead)
+      continue;
+    if (cl->subs == ~UINT64_C(0) ||
+        (id >= 0 && cl->subs & (UINT64_C(1) << id)))
+      return 1;
+  }
+  return 0;
+}
+
+void ipc_broadcast(const char *event, const char *fields, size_t len) {
+  IpcClient *cl;
+  IpcBuf b = {0};
+  int id;
+
+  if (listenfd < 0)
+    return;
+  id = eventid(event);
+  ipcbuf_append(&b, "{\"event\":", 9);
+  ipcbuf_json_string(&b, event);
+  if (len) {
+    ipcbuf_append(&b, ",", 1);
+    ipcbuf_append(&b, fields, len);
+  }
+  ipcbuf_append(&b, "}", 1);
+
+  wl_list_for_each(cl, &ipcclients, link) {
+    if (cl->dead || (cl->subs != ~UINT64_C(0) &&
+                     (id < 0 || !(cl->subs & (UINT64_C(1) << id)))))
+      continue;
+    clientsend(cl, b.data, b.len);
+    if (cl->dead && !reapsrc)
+      reapsrc = wl_event_loop_add_idle(ipcloop, reap, NULL);
+  }
+  free(b.data);
+}
@@ -0,0 +1,54 @@
+/*
+ * Unix-socket IPC server.
+ *
+ * Every message in either direction is a frame: a 4-byte little-endian
+ * payload length followed by that many bytes of JSON.  Requests are objects
+ * with a "type" member:
+ *
+ *   {"type": "get_clients"}   {"type": "get_monitors"}   {"type": "get_tags"}
+ *   {"type": "subscribe", "events": ["client::map", "monitor::status"]}
+ *   {"type": "view", "arg": 4}
+ *
+ * An integer "arg" is passed to the query function (0 if absent).
+ * Each request gets exactly one reply {"type": ..., "success": ..., ...}.
+ * After a successful subscribe the connection also receives event frames
+ * {"event": name, ...} for the listed names ("*" subscribes to all).  Only
+ * names added with ipc_add_event() can be subscribed to; a subscribe that
+ * lists any other name fails and leaves the subscriptions as they were.
+ *
+ * All sockets are non-blocking and served from wl_event_loop fd sources.
+ * Output is queued per connection; a connection whose queue grows past
+ * IPC_MAX_PENDING is dropped instead of stalling the compositor.
+ */
+#ifndef IPC_H
+#define IPC_H
+
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+typedef struct {
+  char *data;
+  size_t len, cap;
+} IpcBuf;
+
+void ipcbuf_append(IpcBuf *b, const char *s, size_t n);
+void ipcbuf_printf(IpcBuf *b, const char *fmt, ...);
+/* append s as a quoted JSON string, or null if s is NULL */
+void ipcbuf_json_string(IpcBuf *b, const char *s);
+
+/* Append the JSON result for a query type; return 0 if it is unknown */
+typedef int (*IpcQueryFunc)(const char *type, long long arg, IpcBuf *reply);
+
+int ipc_init(struct wl_event_loop *loop, const char *path, IpcQueryFunc query);
+void ipc_finish(void);
+
+/* make event available to subscribe to; returns its index, or -1 once
+ * 64 names were added.  Other events only reach connections
+ * subscribed to "*". */
+int ipc_add_event(const char *event);
+/* nonzero if at least one connection is subscribed to event */
+int ipc_wants(const char *event);
+/* send {"event": event, <fields>} to every subscriber; fields may be empty */
+void ipc_broadcast(const char *event, const char *fields, size_t len);
+
+#endif
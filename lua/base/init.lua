@@ -15,6 +15,9 @@ local base = {
   
   -- Centralized logging system
   logger = require("base.logger"),
+
+  -- Compiled rule/condition matching
+  predicate = require("base.predicate"),
 }
 
 -- Initialize base systems
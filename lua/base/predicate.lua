@@ -0,0 +1,329 @@
+-- Compiled predicate engine for SomeWM
+-- Turns declarative match tables ({ class = "firefox", title = "^Save" }) into
+-- a decision structure: rules are bucketed by the exact value of one index
+-- property (appid/class), and each rule keeps a flat list of precompiled
+-- checks for the remaining conditions. Subject properties are read into a
+-- snapshot, so a getter that crosses into C is called once no matter how
+-- many rules test it, until a matched rule may have changed the subject.
+
+local predicate = {}
+predicate.__index = predicate
+
+-- Characters that make a string a Lua pattern rather than a plain substring
+local MAGIC = "[%^%$%(%)%%%.%[%]%*%+%-%?]"
+
+-- Snapshot placeholder for properties that were fetched and are nil
+local NONE = {}
+
+local clock = os.clock
+
+-- Compile a single condition into a check record
+local function compile_check(prop, expected, fields)
+  local kind = type(expected)
+
+  if kind == "string" then
+    if expected:find(MAGIC) then
+      return { prop = prop, kind = "pattern", value = expected }
+    end
+    return { prop = prop, kind = "plain", value = expected }
+  elseif kind == "function" then
+    return { prop = prop, kind = "func", value = expected }
+  elseif kind == "table" then
+    if fields[prop] then
+      return { prop = prop, kind = "fields", value = expected }
+    end
+    local set = {}
+    for _, val in ipairs(expected) do
+      set[val] = true
+    end
+    return { prop = prop, kind = "oneof", value = set, list = expected }
+  end
+  return { prop = prop, kind = "equal", value = expected }
+end
+
+-- Exact index keys implied by a check, or nil if it cannot be indexed
+local function index_keys(check)
+  if check.kind == "oneof" then
+    for _, val in ipairs(check.list) do
+      if type(val) ~= "string" then return nil end
+    end
+    return check.list
+  elseif check.kind == "pattern" then
+    local literal = check.value:match("^%^(.*)%$$")
+    if literal and literal ~= "" and not literal:find(MAGIC) then
+      return { literal }
+    end
+  end
+  return nil
+end
+
+local function run_check(check, actual, subject)
+  local kind = check.kind
+
+  if kind == "plain" then
+    return type(actual) == "string" and actual:find(check.value, 1, true) ~= nil
+  elseif kind == "pattern" then
+    return type(actual) == "string" and actual:match(check.value) ~= nil
+  elseif kind == "equal" then
+    return actual == check.value
+  elseif kind == "oneof" then
+    return actual ~= nil and check.value[actual] == true
+  elseif kind == "func" then
+    return check.value(actual, subject) and true or false
+  elseif kind == "fields" then
+    if type(actual) ~= "table" then return false end
+    for key, val in pairs(check.value) do
+      if actual[key] ~= val then return false end
+    end
+    return true
+  end
+  return false
+end
+
+-- Create an engine.
+-- opts.fetch(subject, prop) returns a property of the subject (default: index)
+-- opts.index is the snapshot property rules are bucketed by
+-- opts.alias maps condition keys onto snapshot properties
+-- opts.fields lists properties whose table conditions match field by field
+-- opts.conditions(rule) returns the match table of a rule
+-- opts.enabled(rule) excludes rules from compilation when it returns false
+-- opts.budget_us is the per-evaluation time evaluations are counted against
+function predicate.new(opts)
+  opts = opts or {}
+  local self = setmetatable({}, predicate)
+  self.fetch = opts.fetch or function(subject, prop) return subject[prop] end
+  self.index = opts.index
+  self.alias = opts.alias or {}
+  self.fields = opts.fields or {}
+  self.conditions = opts.conditions or function(rule) return rule.rule end
+  self.enabled = opts.enabled or function() return true end
+  self.budget_us = opts.budget_us or 50
+  self.rules = {}
+  self.compiled = nil
+  predicate.reset_stats(self)
+  return self
+end
+
+-- Replace the ordered rule list; compilation is deferred to the next match
+function predicate:set_rules(list)
+  self.rules = list
+  self.compiled = nil
+end
+
+-- Drop the compiled form after rules were mutated in place
+function predicate:invalidate()
+  self.compiled = nil
+end
+
+-- Compile one match table into an ordered list of checks plus index keys
+function predicate:compile_conditions(conditions)
+  local checks, keys = {}, nil
+
+  for key, expected in pairs(conditions or {}) do
+    local check = compile_check(self.alias[key] or key, expected, self.fields)
+    local implied = not keys and check.prop == self.index and index_keys(check)
+    if implied then
+      keys = implied
+    else
+      table.insert(checks, check)
+    end
+  end
+
+  -- Cheap exact checks first, callbacks last
+  local cost = { equal = 1, oneof = 1, plain = 2, fields = 3, pattern = 4, func = 5 }
+  table.sort(checks, function(a, b) return cost[a.kind] < cost[b.kind] end)
+  return checks, keys
+end
+
+function predicate:compile()
+  local compiled = { by_key = {}, generic = {}, indexed = 0, entries = {},
+    tested = {} }
+
+  for order, rule in ipairs(self.rules) do
+    if self.enabled(rule) then
+      local checks, keys = self:compile_conditions(self.conditions(rule))
+      local entry = { rule = rule, order = order, checks = checks, deps = {} }
+
+      for _, check in ipairs(checks) do
+        entry.deps[check.prop] = true
+        compiled.tested[check.prop] = true
+      end
+      compiled.entries[rule] = entry
+
+      if keys then
+        for _, key in ipairs(keys) do
+          local bucket = compiled.by_key[key] or {}
+          compiled.by_key[key] = bucket
+          if bucket[#bucket] ~= entry then
+            table.insert(bucket, entry)
+          end
+        end
+        compiled.indexed = compiled.indexed + 1
+      else
+        table.insert(compiled.generic, entry)
+      end
+    end
+  end
+
+  self.compiled = compiled
+  return compiled
+end
+
+local function lookup(self, snap, subject, prop)
+  local value = snap[prop]
+  if value == nil then
+    value = self.fetch(subject, prop)
+    if value == nil then value = NONE end
+    snap[prop] = value
+  end
+  if value == NONE then return nil end
+  return value
+end
+
+local function entry_matches(self, entry, snap, subject)
+  for _, check in ipairs(entry.checks) do
+    if not run_check(check, lookup(self, snap, subject, check.prop), subject) then
+      return false
+    end
+  end
+  return true
+end
+
+-- Evaluate the rules against subject in rule order, calling on_match(rule)
+-- as soon as a rule matches. on_match may return true to stop processing;
+-- later rules are then not evaluated at all, so their function conditions
+-- do not run. A property is read when a condition first needs it, and read
+-- again after on_match ran, since applying a rule may have changed it.
+-- When only is given, just the rules testing that property are evaluated;
+-- when last is given, the rules after it are not. Returns the match count,
+-- the matched rules and the number of rules examined.
+function predicate:match(subject, on_match, only, last)
+  local compiled = self.compiled or self:compile()
+  local stop_at = last and compiled.entries[last]
+  stop_at = stop_at and stop_at.order or math.huge
+  local start = clock()
+  local snap = {}
+  local bucket = compiled.by_key
+  local generic = compiled.generic
+  local matched, examined = 0, 0
+  local matches = {}
+
+  if self.index and next(bucket) then
+    bucket = bucket[lookup(self, snap, subject, self.index) or NONE] or {}
+  else
+    bucket = {}
+  end
+
+  -- Merge the index bucket and the generic list, both already in rule order
+  local i, j = 1, 1
+  while i <= #bucket or j <= #generic do
+    local entry
+    if j > #generic or (i <= #bucket and bucket[i].order < generic[j].order) then
+      entry = bucket[i]
+      i = i + 1
+    else
+      entry = generic[j]
+      j = j + 1
+    end
+    if entry.order > stop_at then break end
+
+    if not only or entry.deps[only] then
+      examined = examined + 1
+      if entry_matches(self, entry, snap, subject) then
+        matched = matched + 1
+        matches[matched] = entry.rule
+        if on_match then
+          -- the time spent applying the rule is not matching time
+          local t = clock()
+          local stop = on_match(entry.rule)
+          start = start + (clock() - t)
+          if stop then break end
+          for prop in pairs(snap) do
+            snap[prop] = nil
+          end
+        end
+      end
+    end
+  end
+
+  self:_record(start, examined, matched)
+  return matched, matches, examined
+end
+
+-- Whether rule has a condition on prop, or without rule, whether any
+-- enabled rule does. The index property of bucketed rules is not counted.
+function predicate:tests(prop, rule)
+  local compiled = self.compiled or self:compile()
+  if rule then
+    local entry = compiled.entries[rule]
+    return entry ~= nil and entry.deps[prop] == true
+  end
+  return compiled.tested[prop] == true
+end
+
+-- Test a single match table against a subject without an engine
+function predicate.test(conditions, subject, opts)
+  local engine = predicate.new(opts)
+  local checks, keys = engine:compile_conditions(conditions)
+  local snap = {}
+
+  if keys then
+    local actual = lookup(engine, snap, subject, engine.index)
+    local found = false
+    for _, key in ipairs(keys) do
+      if actual == key then found = true break end
+    end
+    if not found then return false end
+  end
+  return entry_matches(engine, { checks = checks }, snap, subject)
+end
+
+function predicate:_record(start, examined, matched)
+  local us = (clock() - start) * 1e6
+  local s = self.stat
+
+  s.evaluations = s.evaluations + 1
+  s.examined = s.examined + examined
+  s.matched = s.matched + matched
+  s.total_us = s.total_us + us
+  s.last_us = us
+  if us > s.max_us then s.max_us = us end
+  if us > self.budget_us then s.over_budget = s.over_budget + 1 end
+end
+
+function predicate:reset_stats()
+  self.stat = {
+    evaluations = 0,
+    examined = 0,
+    matched = 0,
+    total_us = 0,
+    last_us = 0,
+    max_us = 0,
+    over_budget = 0,
+  }
+end
+
+-- Match-time statistics, in microseconds
+function predicate:stats()
+  local s = self.stat
+  local compiled = self.compiled or self:compile()
+  local keys = 0
+  for _ in pairs(compiled.by_key) do keys = keys + 1 end
+
+  return {
+    rules = #self.rules,
+    indexed_rules = compiled.indexed,
+    generic_rules = #compiled.generic,
+    index_keys = keys,
+    evaluations = s.evaluations,
+    examined = s.examined,
+    matched = s.matched,
+    avg_us = s.evaluations > 0 and s.total_us / s.evaluations or 0,
+    last_us = s.last_us,
+    max_us = s.max_us,
+    budget_us = self.budget_us,
+    over_budget = s.over_budget,
+  }
+end
+
+return predicate
@@ -3,8 +3,23 @@
 
 local signal = {}
 
--- Global signal registry
-local signals = {}
+-- Global signals live on the compositor's signal bus (Some.signal_*), which
+-- also carries the signals emitted from C such as "client::focus",
+-- "monitor::added" or "tag::view_changed". Names are interned once; emit
+-- passes its arguments straight through without building a table.
+local bus_connect = Some.signal_connect
+local bus_disconnect = Some.signal_disconnect
+local bus_emit = Some.signal_emit
+local bus_count = Some.signal_count
+
+-- Signal name -> bus id
+local ids = setmetatable({}, {
+  __index = function(t, name)
+    local id = Some.signal_intern(name)
+    t[name] = id
+    return id
+  end
+})
 
 -- Connect a callback to a global signal
 function signal.connect(signal_name, callback)
@@ -16,73 +31,48 @@ function signal.connect(signal_name, callback)
     error("Callback must be a function", 2)
   end
   
-  if not signals[signal_name] then
-    signals[signal_name] = {}
-  end
-  
-  table.insert(signals[signal_name], callback)
+  bus_connect(ids[signal_name], callback)
 end
 
 -- Disconnect a callback from a global signal
 function signal.disconnect(signal_name, callback)
-  if not signals[signal_name] then
-    return false
-  end
-  
-  for i, cb in ipairs(signals[signal_name]) do
-    if cb == callback then
-      table.remove(signals[signal_name], i)
-      return true
-    end
-  end
-  
-  return false
+  return bus_disconnect(ids[signal_name], callback)
 end
 
 -- Disconnect all callbacks from a signal
 function signal.disconnect_all(signal_name)
-  if signals[signal_name] then
-    signals[signal_name] = {}
-    return true
-  end
-  return false
+  return Some.signal_disconnect_all(ids[signal_name])
 end
 
--- Emit a global signal
+-- Emit a global signal; returns the number of callbacks that ran without
+-- error. Middleware (below) may cancel the emission.
+local middleware = {}
+
 function signal.emit(signal_name, ...)
-  if not signals[signal_name] then
-    return 0
-  end
-  
-  local count = 0
-  for _, callback in ipairs(signals[signal_name]) do
-    local success, err = pcall(callback, ...)
-    if success then
-      count = count + 1
-    else
-      print("Error in global signal callback for " .. signal_name .. ": " .. tostring(err))
+  for i = 1, #middleware do
+    local success, result = pcall(middleware[i], signal_name, ...)
+    if success and result == false then
+      -- Middleware canceled the signal
+      return 0
     end
   end
   
-  return count
+  return bus_emit(ids[signal_name], ...)
 end
 
 -- Check if a signal has any connected callbacks
 function signal.has_callbacks(signal_name)
-  return signals[signal_name] and #signals[signal_name] > 0
+  return bus_count(ids[signal_name]) > 0
 end
 
 -- Get the number of callbacks connected to a signal
 function signal.count_callbacks(signal_name)
-  return signals[signal_name] and #signals[signal_name] or 0
+  return bus_count(ids[signal_name])
 end
 
--- Get all registered signal names
+-- Get the names of all signals with connected callbacks
 function signal.get_signal_names()
-  local names = {}
-  for name, _ in pairs(signals) do
-    table.insert(names, name)
-  end
+  local names = Some.signal_names()
   table.sort(names)
   return names
 end
@@ -90,15 +80,15 @@ end
 -- Get signal statistics for debugging
 function signal.get_stats()
   local stats = {}
-  for name, callbacks in pairs(signals) do
-    stats[name] = #callbacks
+  for _, name in ipairs(Some.signal_names()) do
+    stats[name] = bus_count(ids[name])
   end
   return stats
 end
 
 -- Clear all signals (useful for testing)
 function signal.clear_all()
-  signals = {}
+  Some.signal_clear()
 end
 
 -- Create a signal emitter object (for convenience)
@@ -192,9 +182,8 @@ function signal.connect_debounced(signal_name, callback, delay)
   return wrapper
 end
 
--- Signal middleware system
-local middleware = {}
-
+-- Signal middleware: called as func(signal_name, ...) before every emit;
+-- returning false cancels the emission
 function signal.add_middleware(func)
   table.insert(middleware, func)
 end
@@ -209,21 +198,4 @@ function signal.remove_middleware(func)
   return false
 end
 
--- Enhanced emit with middleware support
-local original_emit = signal.emit
-function signal.emit(signal_name, ...)
-  local args = {...}
-  
-  -- Apply middleware
-  for _, mw in ipairs(middleware) do
-    local success, result = pcall(mw, signal_name, args)
-    if success and result == false then
-      -- Middleware canceled the signal
-      return 0
-    end
-  end
-  
-  return original_emit(signal_name, table.unpack(args))
-end
-
 return signal
\ No newline at end of file
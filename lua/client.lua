@@ -42,6 +42,22 @@ function client.get_pid(c)
   return Some.client_get_pid(c)
 end
 
+-- All properties of c in one table (reuse is refilled if given)
+function client.snapshot(c, reuse)
+  return Some.client_snapshot(c, reuse)
+end
+
+-- Clients matching query ({appid, title, pid, tags, monitor})
+function client.find(query)
+  return Some.client_find(query)
+end
+
+-- Columnar properties of all clients matching filter
+-- ({tags, monitor, floating, visible}); rows are 1..result.n
+function client.snapshot_all(filter, reuse)
+  return Some.clients_snapshot(filter, reuse)
+end
+
 -- Client manipulation functions
 function client.focus(c)
   Some.client_focus(c)
@@ -156,8 +172,8 @@ function client.connect_signal(signal_name, callback)
   Some.client_connect_signal(signal_name, callback)
 end
 
-function client.disconnect_signal(signal_name, callback_ref)
-  Some.client_disconnect_signal(signal_name, callback_ref)
+function client.disconnect_signal(signal_name, callback)
+  return Some.client_disconnect_signal(signal_name, callback)
 end
 
 -- Convenience event connection functions
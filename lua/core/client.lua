@@ -5,170 +5,245 @@ local base = require("base")
 
 local client = {}
 
--- Weak table to store client objects by C pointer
+-- Client objects by cache table (Some.client_cache returns the same table
+-- for every handle of a client, so each client gets one object)
 local client_objects = setmetatable({}, { __mode = "v" })
 
--- Create a client object wrapper with base.object features
-local function create_client_object(c_client)
-  if not c_client then return nil end
-  
-  -- Check if we already have an object for this client
-  if client_objects[c_client] then
-    return client_objects[c_client]
+-- Property cache of each object: the values of its last
+-- Some.client_snapshot() plus a "dirty" bitmask into which the compositor
+-- ORs the Some.client_props bit of every property that changes. Reading a
+-- clean property stays in Lua; reading a dirty one refreshes them all with
+-- one crossing into C.
+local caches = setmetatable({}, { __mode = "k" })
+local props = Some.client_props
+local cache_hits, cache_misses = 0, 0
+
+local function cached(obj, prop)
+  local cache = caches[obj]
+  if not cache then
+    return nil
   end
-  
-  -- Create new client object based on base.object
-  local obj = base.object.new()
-  
-  -- Store the C client pointer privately
-  obj:set_private("c_client", c_client)
-  
-  -- Add property definitions with getters/setters
-  obj:add_property("title", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_title(c) or nil
-    end
-  })
-  
-  obj:add_property("appid", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_appid(c) or nil
-    end
-  })
-  
-  obj:add_property("pid", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_pid(c) or nil
-    end
-  })
-  
-  obj:add_property("geometry", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_geometry(c) or base.geometry.rectangle(0, 0, 0, 0)
-    end,
-    setter = function(self, geom)
-      local c = self:get_private().c_client
-      if c and geom then
-        Some.client_set_geometry(c, geom.x, geom.y, geom.width, geom.height)
-        self:emit_signal("property::geometry", geom)
-      end
-    end
-  })
-  
-  obj:add_property("floating", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_floating(c) or false
-    end,
-    setter = function(self, floating)
-      local c = self:get_private().c_client
-      if c then
-        Some.client_set_floating(c, floating)
-        self:emit_signal("property::floating", floating)
-      end
+  if cache.dirty & prop == 0 then
+    cache_hits = cache_hits + 1
+    return cache
+  end
+  cache_misses = cache_misses + 1
+  if not Some.client_snapshot(obj:get_private().c_client, cache) then
+    return nil
+  end
+  cache.dirty = 0
+  return cache
+end
+
+-- Client class: properties and methods are shared by every client object
+local client_class = base.object.class()
+
+client_class:add_property("title", {
+  getter = function(self)
+    local snap = cached(self, props.title)
+    return snap and snap.title
+  end
+})
+
+client_class:add_property("appid", {
+  getter = function(self)
+    local snap = cached(self, props.appid)
+    return snap and snap.appid
+  end
+})
+
+client_class:add_property("pid", {
+  getter = function(self)
+    local snap = cached(self, props.appid)
+    return snap and snap.pid
+  end
+})
+
+client_class:add_property("geometry", {
+  getter = function(self)
+    local snap = cached(self, props.geometry)
+    if not snap then
+      return base.geometry.rectangle(0, 0, 0, 0)
     end
-  })
-  
-  obj:add_property("fullscreen", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_fullscreen(c) or false
-    end,
-    setter = function(self, fullscreen)
-      local c = self:get_private().c_client
-      if c then
-        Some.client_set_fullscreen(c, fullscreen)
-        self:emit_signal("property::fullscreen", fullscreen)
-      end
+    return { x = snap.x, y = snap.y, width = snap.width, height = snap.height }
+  end,
+  setter = function(self, geom)
+    local c = self:get_private().c_client
+    if c and geom then
+      Some.client_set_geometry(c, geom.x, geom.y, geom.width, geom.height)
+      self:emit_signal("property::geometry", geom)
     end
-  })
-  
-  obj:add_property("tags", {
-    getter = function(self)
-      local c = self:get_private().c_client
-      return c and Some.client_get_tags(c) or 0
-    end,
-    setter = function(self, tags)
-      local c = self:get_private().c_client
-      if c then
-        Some.client_set_tags(c, tags)
-        self:emit_signal("property::tags", tags)
-      end
+  end
+})
+
+client_class:add_property("floating", {
+  getter = function(self)
+    local snap = cached(self, props.floating)
+    return snap and snap.floating or false
+  end,
+  setter = function(self, floating)
+    local c = self:get_private().c_client
+    if c then
+      Some.client_set_floating(c, floating)
+      self:emit_signal("property::floating", floating)
     end
-  })
-  
-  -- Add client-specific methods
-  function obj:focus()
+  end
+})
+
+client_class:add_property("fullscreen", {
+  getter = function(self)
+    local snap = cached(self, props.fullscreen)
+    return snap and snap.fullscreen or false
+  end,
+  setter = function(self, fullscreen)
     local c = self:get_private().c_client
     if c then
-      Some.client_focus(c)
-      self:emit_signal("request::activate", "client.focus")
+      Some.client_set_fullscreen(c, fullscreen)
+      self:emit_signal("property::fullscreen", fullscreen)
     end
   end
-  
-  function obj:close()
+})
+
+client_class:add_property("tags", {
+  getter = function(self)
+    local snap = cached(self, props.tags)
+    return snap and snap.tags or 0
+  end,
+  setter = function(self, tags)
     local c = self:get_private().c_client
     if c then
-      Some.client_close(c)
-      self:emit_signal("request::close")
+      Some.client_set_tags(c, tags)
+      self:emit_signal("property::tags", tags)
     end
   end
-  
-  function obj:kill()
+})
+
+-- Frame callback caps: a number caps both states, a table either of
+-- focused and unfocused, or visible for both
+client_class:add_property("max_fps", {
+  getter = function(self)
+    local c = self:get_private().c_client
+    if not c then
+      return { focused = 0, unfocused = 0 }
+    end
+    local focused, unfocused = Some.client_get_max_fps(c)
+    return { focused = focused, unfocused = unfocused }
+  end,
+  setter = function(self, fps)
     local c = self:get_private().c_client
     if c then
-      Some.client_kill(c)
-      self:emit_signal("request::kill")
+      if type(fps) == "table" then
+        Some.client_set_max_fps(c, fps.focused or fps.visible or 0,
+          fps.unfocused or fps.visible or 0)
+      else
+        Some.client_set_max_fps(c, fps or 0, fps or 0)
+      end
+      self:emit_signal("property::max_fps", self.max_fps)
     end
   end
-  
-  -- Convenience methods using properties
-  function obj:toggle_floating()
-    self.floating = not self.floating
+})
+
+client_class:add_property("commit_rate", {
+  getter = function(self)
+    local c = self:get_private().c_client
+    local stats = c and Some.client_get_commit_stats(c)
+    return stats and stats.rate or 0
   end
-  
-  function obj:toggle_fullscreen()
-    self.fullscreen = not self.fullscreen
+})
+
+client_class:add_property("responsive", {
+  getter = function(self)
+    local c = self:get_private().c_client
+    local stats = c and Some.client_get_responsiveness(c)
+    return not stats or stats.responsive
   end
-  
-  function obj:move(x, y)
-    local geom = self.geometry
-    self.geometry = base.geometry.rectangle(x, y, geom.width, geom.height)
+})
+
+-- Add client-specific methods
+function client_class.methods:focus()
+  local c = self:get_private().c_client
+  if c then
+    Some.client_focus(c)
+    self:emit_signal("request::activate", "client.focus")
   end
-  
-  function obj:resize(w, h)
-    local geom = self.geometry
-    self.geometry = base.geometry.rectangle(geom.x, geom.y, w, h)
+end
+
+function client_class.methods:close()
+  local c = self:get_private().c_client
+  if c then
+    Some.client_close(c)
+    self:emit_signal("request::close")
   end
-  
-  function obj:move_relative(dx, dy)
-    local geom = self.geometry
-    self:move(geom.x + dx, geom.y + dy)
+end
+
+function client_class.methods:kill()
+  local c = self:get_private().c_client
+  if c then
+    Some.client_kill(c)
+    self:emit_signal("request::kill")
   end
+end
+
+-- Convenience methods using properties
+function client_class.methods:toggle_floating()
+  self.floating = not self.floating
+end
+
+function client_class.methods:toggle_fullscreen()
+  self.fullscreen = not self.fullscreen
+end
+
+function client_class.methods:move(x, y)
+  local geom = self.geometry
+  self.geometry = base.geometry.rectangle(x, y, geom.width, geom.height)
+end
+
+function client_class.methods:resize(w, h)
+  local geom = self.geometry
+  self.geometry = base.geometry.rectangle(geom.x, geom.y, w, h)
+end
+
+function client_class.methods:move_relative(dx, dy)
+  local geom = self.geometry
+  self:move(geom.x + dx, geom.y + dy)
+end
+
+function client_class.methods:resize_relative(dw, dh)
+  local geom = self.geometry
+  self:resize(geom.width + dw, geom.height + dh)
+end
+
+-- Info method for debugging
+function client_class.methods:info()
+  return string.format(
+    "%s (%s) [PID:%s] - %dx%d+%d+%d, tags:%d, floating:%s, fullscreen:%s",
+    self.title or "Untitled",
+    self.appid or "unknown", 
+    self.pid or "unknown",
+    self.geometry.width, self.geometry.height, self.geometry.x, self.geometry.y,
+    self.tags, tostring(self.floating), tostring(self.fullscreen)
+  )
+end
+
+-- Create a client object wrapper with base.object features
+local function create_client_object(c_client)
+  if not c_client then return nil end
   
-  function obj:resize_relative(dw, dh)
-    local geom = self.geometry
-    self:resize(geom.width + dw, geom.height + dh)
+  -- Check if we already have an object for this client
+  local cache = Some.client_cache(c_client)
+  if not cache then return nil end
+  if client_objects[cache] then
+    return client_objects[cache]
   end
   
-  -- Info method for debugging
-  function obj:info()
-    return string.format(
-      "%s (%s) [PID:%s] - %dx%d+%d+%d, tags:%d, floating:%s, fullscreen:%s",
-      self.title or "Untitled",
-      self.appid or "unknown", 
-      self.pid or "unknown",
-      self.geometry.width, self.geometry.height, self.geometry.x, self.geometry.y,
-      self.tags, tostring(self.floating), tostring(self.fullscreen)
-    )
-  end
+  local obj = client_class:new()
+  
+  -- Store the C client pointer privately
+  obj:set_private("c_client", c_client)
+  caches[obj] = cache
   
   -- Store in our weak table
-  client_objects[c_client] = obj
+  client_objects[cache] = obj
   
   return obj
 end
@@ -187,59 +262,113 @@ function client.get_all()
   return objects
 end
 
+-- Client object for a raw client handle
+client.create_client_object = create_client_object
+
+-- The client's object if it already has one, without creating it
+function client.get_object(c_client)
+  local cache = c_client and Some.client_cache(c_client)
+  return cache and client_objects[cache]
+end
+
 -- Get focused client as object
 function client.get_focused()
   local c_client = Some.client_get_focused()
   return create_client_object(c_client)
 end
 
+-- Columnar snapshot of all clients matching filter, see Some.clients_snapshot.
+-- The result table is shared and refilled by the next call.
+local columns
+function client.snapshot_all(filter)
+  columns = Some.clients_snapshot(filter, columns)
+  return columns
+end
+
+-- Client objects for the rows of a snapshot_all() result for which
+-- keep(snap, i) returns true (all rows if keep is nil)
+function client.from_snapshot(snap, keep)
+  local objects = {}
+  for i = 1, snap.n do
+    if not keep or keep(snap, i) then
+      objects[#objects + 1] = create_client_object(snap.client[i])
+    end
+  end
+  return objects
+end
+
 -- Convenience functions
 function client.get_all_titles()
-  local clients = client.get_all()
+  local snap = client.snapshot_all()
   local titles = {}
-  for i, c in ipairs(clients) do
-    titles[i] = c.title or "Untitled"
+  for i = 1, snap.n do
+    titles[i] = snap.title[i] or "Untitled"
   end
   return titles
 end
 
-function client.find_by_title(title)
-  local clients = client.get_all()
-  for _, c in ipairs(clients) do
-    if c.title == title then
-      return c
-    end
+-- Client objects matching query ({appid, title, pid, tags, monitor}, exact
+-- matches, all optional), looked up in the C-side indexes
+function client.find(query)
+  local objects = {}
+  for i, c in ipairs(Some.client_find(query)) do
+    objects[i] = create_client_object(c)
   end
-  return nil
+  return objects
+end
+
+local function find_first(query)
+  local c = Some.client_find(query)[1]
+  return c and create_client_object(c) or nil
+end
+
+function client.find_by_title(title)
+  return title and find_first({ title = title }) or nil
 end
 
 function client.find_by_appid(appid)
-  local clients = client.get_all()
-  for _, c in ipairs(clients) do
-    if c.appid == appid then
-      return c
-    end
-  end
-  return nil
+  return appid and find_first({ appid = appid }) or nil
 end
 
 function client.find_by_pid(pid)
-  local clients = client.get_all()
-  for _, c in ipairs(clients) do
-    if c.pid == pid then
-      return c
-    end
-  end
-  return nil
+  return pid and find_first({ pid = pid }) or nil
 end
 
--- Signal handling (delegates to global signals for now)
+-- Signal handling (delegates to global signals). The compositor emits raw
+-- client handles; callbacks get the client object instead.
+local wrappers = setmetatable({}, { __mode = "k" })
+
 function client.connect_signal(signal_name, callback)
-  base.signal.connect("client::" .. signal_name, callback)
+  local wrapper = function(c, ...)
+    if type(c) == "userdata" and not base.object.is(c) then
+      -- a client being destroyed gets no new object; nil if it had none
+      if signal_name == "destroy" then
+        c = client.get_object(c)
+      else
+        c = create_client_object(c)
+      end
+    end
+    return callback(c, ...)
+  end
+  -- one wrapper per connection, so a callback connected twice needs two
+  -- disconnects, as with base.signal
+  wrappers[callback] = wrappers[callback] or {}
+  local list = wrappers[callback][signal_name] or {}
+  wrappers[callback][signal_name] = list
+  list[#list + 1] = wrapper
+  base.signal.connect("client::" .. signal_name, wrapper)
 end
 
 function client.disconnect_signal(signal_name, callback)
-  base.signal.disconnect("client::" .. signal_name, callback)
+  local list = wrappers[callback] and wrappers[callback][signal_name]
+  local wrapper = list and table.remove(list)
+  if wrapper then
+    if #list == 0 then
+      wrappers[callback][signal_name] = nil
+    end
+    return base.signal.disconnect("client::" .. signal_name, wrapper)
+  end
+  return false
 end
 
 -- Convenience signal connections
@@ -267,6 +396,11 @@ function client.on_fullscreen(callback)
   client.connect_signal("fullscreen", callback)
 end
 
+-- callback(c, unresponsive): c stopped or started answering pings again
+function client.on_unresponsive(callback)
+  client.connect_signal("unresponsive", callback)
+end
+
 function client.on_floating(callback)
   client.connect_signal("floating", callback)
 end
@@ -323,13 +457,25 @@ function client.arrange_tiled(clients, area, master_count)
   end
 end
 
+-- Property cache counters: reads answered from the cache (hits) or that
+-- had to refresh it (misses), invalidations pushed by the compositor and
+-- the number of live caches
+function client.cache_stats()
+  local stats = Some.client_cache_stats()
+  stats.hits = cache_hits
+  stats.misses = cache_misses
+  return stats
+end
+
 -- Cleanup function for when clients are destroyed
 function client.cleanup_client(c_client)
-  if client_objects[c_client] then
-    local obj = client_objects[c_client]
+  local cache = Some.client_cache(c_client)
+  local obj = cache and client_objects[cache]
+  if obj then
+    caches[obj] = nil
     obj:emit_signal("destroy")
     obj:destroy()
-    client_objects[c_client] = nil
+    client_objects[cache] = nil
   end
 end
 
@@ -37,22 +37,29 @@ function core.init()
   -- Initialize tag system
   core.tag.get_count() -- This triggers tag initialization
   
-  -- Set up global client event handling
-  base.signal.connect("client::new", function(c_client)
+  -- Set up global client event handling; client::map, client::destroy and
+  -- monitor::removed are emitted by the compositor
+  -- client::manage and client::unmanage bracket the life of a client, which
+  -- may be mapped and unmapped any number of times in between
+  local managed = setmetatable({}, { __mode = "k" })
+  base.signal.connect("client::map", function(c_client)
     local client = core.client.create_client_object(c_client)
-    if client then
+    if client and not managed[client] then
+      managed[client] = true
       base.signal.emit("client::manage", client)
-      -- Apply rules to new client
-      core.rules.apply_to_client(client)
     end
   end)
   
   -- Set up cleanup handlers
-  base.signal.connect("client::destroyed", function(c_client)
+  base.signal.connect("client::destroy", function(c_client)
+    local client = core.client.get_object(c_client)
+    if client and managed[client] then
+      base.signal.emit("client::unmanage", client)
+    end
     core.client.cleanup_client(c_client)
   end)
   
-  base.signal.connect("monitor::destroyed", function(c_monitor)
+  base.signal.connect("monitor::removed", function(c_monitor)
     core.monitor.cleanup_monitor(c_monitor)
   end)
   
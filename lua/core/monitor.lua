@@ -129,34 +129,33 @@ local function create_monitor_object(c_monitor)
   end
   
   -- Get clients on this monitor
-  function obj:get_clients()
+  -- Clients whose geometry intersects the monitor and, if tags is given,
+  -- which are on one of those tags. Works on a single columnar snapshot so
+  -- no per-client property calls are needed.
+  local function clients_on(self, tags)
     local core_client = require("core.client")
-    local all_clients = core_client.get_all()
-    local monitor_clients = {}
-    
-    for _, client in ipairs(all_clients) do
-      -- Check if client's geometry intersects with monitor
-      if base.geometry.intersects(client.geometry, self.geometry) then
-        table.insert(monitor_clients, client)
-      end
-    end
+    local geom = self.geometry
+    local snap = core_client.snapshot_all(tags and { tags = tags } or nil)
+    local rect = {}
     
-    return monitor_clients
+    return core_client.from_snapshot(snap, function(s, i)
+      rect.x, rect.y = s.x[i], s.y[i]
+      rect.width, rect.height = s.width[i], s.height[i]
+      return base.geometry.intersects(rect, geom)
+    end)
+  end
+  
+  function obj:get_clients()
+    return clients_on(self)
   end
   
   -- Get visible clients (non-minimized, on current tags)
   function obj:get_visible_clients()
-    local clients = self:get_clients()
-    local visible = {}
-    
-    for _, client in ipairs(clients) do
-      -- Check if client is on current tags
-      if client.tags & self.tags ~= 0 then
-        table.insert(visible, client)
-      end
+    local tags = self.tags
+    if tags == 0 then
+      return {}
     end
-    
-    return visible
+    return clients_on(self, tags)
   end
   
   -- Info method for debugging
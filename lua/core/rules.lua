@@ -9,88 +9,46 @@ local rules = {}
 local rule_list = {}
 local rule_id_counter = 0
 
--- Rule matching engine
-local function match_rule(rule, client)
-  if not rule.rule then return false end
-  
-  -- Check each rule condition
-  for property, expected in pairs(rule.rule) do
-    local actual
-    
-    -- Get the actual property value from client
-    if property == "class" or property == "appid" then
-      actual = client.appid
-    elseif property == "title" then
-      actual = client.title
-    elseif property == "floating" then
-      actual = client.floating
-    elseif property == "fullscreen" then
-      actual = client.fullscreen
-    elseif property == "pid" then
-      actual = client.pid
-    elseif property == "tags" then
-      actual = client.tags
-    else
-      -- Custom property or geometry check
-      if property == "geometry" then
-        actual = client.geometry
-      else
-        -- Try to get custom property
-        actual = client:get_private()[property]
-      end
-    end
-    
-    -- Match against expected value
-    if type(expected) == "string" then
-      -- String matching (supports patterns)
-      if type(actual) ~= "string" or not string.match(actual, expected) then
-        return false
-      end
-    elseif type(expected) == "number" then
-      if actual ~= expected then
-        return false
-      end
-    elseif type(expected) == "boolean" then
-      if actual ~= expected then
-        return false
-      end
-    elseif type(expected) == "function" then
-      -- Function-based matching
-      if not expected(actual, client) then
-        return false
-      end
-    elseif type(expected) == "table" then
-      if property == "geometry" then
-        -- Geometry matching
-        for geo_prop, geo_val in pairs(expected) do
-          if actual[geo_prop] ~= geo_val then
-            return false
-          end
-        end
-      else
-        -- Table-based matching (e.g., list contains value)
-        local found = false
-        for _, val in ipairs(expected) do
-          if actual == val then
-            found = true
-            break
-          end
-        end
-        if not found then
-          return false
-        end
-      end
-    else
-      -- Direct comparison
-      if actual ~= expected then
-        return false
-      end
-    end
+-- Read one matchable property from a client. Called at most once per
+-- property per evaluation; the engine keeps the value in its snapshot.
+local function fetch_property(client, property)
+  if property == "appid" then
+    return client.appid
+  elseif property == "title" then
+    return client.title
+  elseif property == "floating" then
+    return client.floating
+  elseif property == "fullscreen" then
+    return client.fullscreen
+  elseif property == "pid" then
+    return client.pid
+  elseif property == "tags" then
+    return client.tags
+  elseif property == "geometry" then
+    return client.geometry
   end
-  
-  return true
+  -- Custom property
+  return client:get_private()[property]
 end
 
+-- Rule matching engine: rules are bucketed by exact appid/class and
+-- compiled on first use after any change to the rule list
+local engine = base.predicate.new({
+  fetch = fetch_property,
+  index = "appid",
+  alias = { class = "appid" },
+  fields = { geometry = true },
+  conditions = function(rule) return rule.rule end,
+  enabled = function(rule) return rule.enabled ~= false end,
+})
+engine:set_rules(rule_list)
+
+-- Per-client record of the title-dependent rules, kept while any rule tests
+-- the title: { matched = {[rule] = true}, applied = {[rule] = true},
+-- last = the rule that stopped processing, if one did }
+local title_state = setmetatable({}, { __mode = "k" })
+local title_stats = { reevaluations = 0, unchanged = 0, applied = 0 }
+
 -- Apply rule properties to client
 local function apply_rule_properties(rule, client)
   if not rule.properties then return end
@@ -116,6 +74,8 @@ local function apply_rule_properties(rule, client)
         client.fullscreen = value
       elseif property == "tags" then
         client.tags = value
+      elseif property == "max_fps" then
+        client.max_fps = value
       elseif property == "geometry" then
         if type(value) == "table" then
           client.geometry = value
@@ -153,23 +113,80 @@ end
 
 -- Main rule application function
 local function apply_rules_to_client(client)
-  base.logger.debug("Applying rules to client: " .. (client.title or "unknown"))
-  
-  for _, rule in ipairs(rule_list) do
-    if rule.enabled ~= false and match_rule(rule, client) then
-      base.logger.debug("Rule matched: " .. (rule.description or "unnamed rule"))
-      
-      -- Apply in order: properties, signals, callbacks
-      apply_rule_properties(rule, client)
+  local applied = {}
+  -- Title rules are recorded in this same pass, so that their conditions
+  -- run once and a title change never reaches past a stopping rule
+  local state = engine:tests("title") and { matched = {}, applied = applied }
+
+  engine:match(client, function(rule)
+    base.logger.debug("Rule matched: " .. (rule.description or "unnamed rule"))
+    applied[rule] = true
+    if state and engine:tests("title", rule) then
+      state.matched[rule] = true
+    end
+
+    -- Apply in order: properties, signals, callbacks
+    apply_rule_properties(rule, client)
+    apply_rule_signals(rule, client)
+    apply_rule_callbacks(rule, client)
+
+    -- Check if this rule should stop further processing
+    if rule.stop_processing then
+      base.logger.debug("Rule processing stopped by rule: " .. (rule.description or "unnamed rule"))
+      if state then state.last = rule end
+      return true
+    end
+  end)
+
+  title_state[client] = state or nil
+end
+
+-- Re-evaluate only the title-dependent rules after a title change. Rules that
+-- start matching are applied; rules that stop matching are not undone, and
+-- nothing is applied when the matched set is unchanged.
+local function reapply_title_rules(client)
+  local state = title_state[client]
+  if not state then return end
+
+  local _, matched, examined = engine:match(client, nil, "title", state.last)
+  if examined == 0 then
+    -- none of this client's rules test the title
+    title_state[client] = nil
+    return
+  end
+  title_stats.reevaluations = title_stats.reevaluations + 1
+  local now, added = {}, {}
+  local changed = false
+
+  for _, rule in ipairs(matched) do
+    now[rule] = true
+    if not state.matched[rule] then
+      changed = true
+      table.insert(added, rule)
+    end
+  end
+  for rule in pairs(state.matched) do
+    if not now[rule] then changed = true end
+  end
+  state.matched = now
+
+  if not changed then
+    title_stats.unchanged = title_stats.unchanged + 1
+    return
+  end
+
+  for _, rule in ipairs(added) do
+    base.logger.debug("Title rule matched: " .. (rule.description or "unnamed rule"))
+    title_stats.applied = title_stats.applied + 1
+
+    apply_rule_properties(rule, client)
+    if not state.applied[rule] then
       apply_rule_signals(rule, client)
-      apply_rule_callbacks(rule, client)
-      
-      -- Check if this rule should stop further processing
-      if rule.stop_processing then
-        base.logger.debug("Rule processing stopped by rule: " .. (rule.description or "unnamed rule"))
-        break
-      end
     end
+    apply_rule_callbacks(rule, client)
+    state.applied[rule] = true
+
+    if rule.stop_processing then break end
   end
 end
 
@@ -186,6 +203,7 @@ function rules.add(rule)
   rule.enabled = rule.enabled ~= false  -- Default to enabled
   
   table.insert(rule_list, rule)
+  engine:invalidate()
   
   base.logger.info("Added rule: " .. (rule.description or "rule #" .. rule.id))
   base.signal.emit("rules::rule_added", rule)
@@ -198,6 +216,7 @@ function rules.remove(rule_id)
   for i, rule in ipairs(rule_list) do
     if rule.id == rule_id then
       table.remove(rule_list, i)
+      engine:invalidate()
       base.logger.info("Removed rule: " .. (rule.description or "rule #" .. rule_id))
       base.signal.emit("rules::rule_removed", rule_id)
       return true
@@ -211,6 +230,7 @@ function rules.enable(rule_id)
   for _, rule in ipairs(rule_list) do
     if rule.id == rule_id then
       rule.enabled = true
+      engine:invalidate()
       base.signal.emit("rules::rule_enabled", rule_id)
       return true
     end
@@ -222,6 +242,7 @@ function rules.disable(rule_id)
   for _, rule in ipairs(rule_list) do
     if rule.id == rule_id then
       rule.enabled = false
+      engine:invalidate()
       base.signal.emit("rules::rule_disabled", rule_id)
       return true
     end
@@ -247,6 +268,11 @@ end
 -- Clear all rules
 function rules.clear()
   rule_list = {}
+  engine:set_rules(rule_list)
+  title_state = setmetatable({}, { __mode = "k" })
+  for k in pairs(title_stats) do
+    title_stats[k] = 0
+  end
   base.logger.info("All rules cleared")
   base.signal.emit("rules::all_cleared")
 end
@@ -298,13 +324,12 @@ function rules.debug_client_match(client)
   base.logger.debug("Testing rules against client: " .. (client.title or "unknown"))
   
   local matches = {}
-  for _, rule in ipairs(rule_list) do
-    if rule.enabled ~= false and match_rule(rule, client) then
-      table.insert(matches, {
-        id = rule.id,
-        description = rule.description or "unnamed rule"
-      })
-    end
+  local _, matched = engine:match(client)
+  for _, rule in ipairs(matched) do
+    table.insert(matches, {
+      id = rule.id,
+      description = rule.description or "unnamed rule"
+    })
   end
   
   return matches
@@ -314,7 +339,13 @@ function rules.get_stats()
   local stats = {
     total_rules = #rule_list,
     enabled_rules = 0,
-    disabled_rules = 0
+    disabled_rules = 0,
+    match = engine:stats(),
+    title = {
+      reevaluations = title_stats.reevaluations,
+      unchanged = title_stats.unchanged,
+      applied = title_stats.applied
+    }
   }
   
   for _, rule in ipairs(rule_list) do
@@ -328,6 +359,17 @@ function rules.get_stats()
   return stats
 end
 
+-- Reset the statistics reported in get_stats().match and get_stats().title
+function rules.reset_stats()
+  engine:reset_stats()
+  title_stats = { reevaluations = 0, unchanged = 0, applied = 0 }
+end
+
+-- Re-evaluate title-dependent rules for a client whose title changed
+function rules.apply_title_rules(client)
+  reapply_title_rules(client)
+end
+
 -- Built-in rule templates
 rules.templates = {
   -- Float specific applications
@@ -370,9 +412,24 @@ rules.templates = {
   end
 }
 
--- Connect to client events for automatic rule application
-base.signal.connect("client::map", function(client)
-  apply_rules_to_client(client)
+-- Connect to client events for automatic rule application. Rules apply at
+-- a client's first map, not again when it is shown after being hidden.
+local ruled = setmetatable({}, { __mode = "k" })
+base.signal.connect("client::map", function(c_client)
+  local client = require("core.client").create_client_object(c_client)
+  if client and not ruled[client] then
+    ruled[client] = true
+    apply_rules_to_client(client)
+  end
+end)
+
+-- The compositor passes a raw handle; a client without an object has no
+-- title state either
+base.signal.connect("client::title_change", function(c_client)
+  local client = require("core.client").get_object(c_client)
+  if client then
+    reapply_title_rules(client)
+  end
 end)
 
 -- Signal handling
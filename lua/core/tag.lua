@@ -25,111 +25,104 @@ local function init_tags()
   end
 end
 
--- Tag object creation (represents a single tag)
-local function create_tag_object(tag_number)
-  if not tag_number or tag_number < 1 or tag_number > tag.get_count() then
-    return nil
+-- Tag class: properties and methods are shared by every tag object
+local tag_class = base.object.class()
+
+tag_class:add_property("number", {
+  getter = function(self)
+    return self:get_private().tag_number
   end
-  
-  local obj = base.object.new()
-  
-  -- Store tag number privately
-  obj:set_private("tag_number", tag_number)
-  
-  -- Add properties
-  obj:add_property("number", {
-    getter = function(self)
-      return self:get_private().tag_number
-    end
-  })
-  
-  obj:add_property("name", {
-    getter = function(self)
-      local num = self:get_private().tag_number
-      return tag_config.names[num] or tostring(num)
-    end,
-    setter = function(self, name)
-      local num = self:get_private().tag_number
-      tag_config.names[num] = name
-      self:emit_signal("property::name", name)
-    end
-  })
-  
-  obj:add_property("active", {
-    getter = function(self)
-      local num = self:get_private().tag_number
-      return tag.is_active(num)
-    end
-  })
-  
-  obj:add_property("occupied", {
-    getter = function(self)
-      local num = self:get_private().tag_number
-      return tag.is_occupied(num)
-    end
-  })
-  
-  obj:add_property("urgent", {
-    getter = function(self)
-      local num = self:get_private().tag_number
-      return tag.is_urgent(num)
-    end
-  })
-  
-  obj:add_property("layout", {
-    getter = function(self)
-      local num = self:get_private().tag_number
-      return tag_config.layouts[num] or "tile"
-    end,
-    setter = function(self, layout)
-      local num = self:get_private().tag_number
-      tag_config.layouts[num] = layout
-      self:emit_signal("property::layout", layout)
-      base.signal.emit("tag::layout_changed", self, layout)
-    end
-  })
-  
-  -- Tag methods
-  function obj:view()
+})
+
+tag_class:add_property("name", {
+  getter = function(self)
     local num = self:get_private().tag_number
-    return tag.view(num)
+    return tag_config.names[num] or tostring(num)
+  end,
+  setter = function(self, name)
+    local num = self:get_private().tag_number
+    tag_config.names[num] = name
+    self:emit_signal("property::name", name)
   end
-  
-  function obj:toggle()
+})
+
+tag_class:add_property("active", {
+  getter = function(self)
     local num = self:get_private().tag_number
-    return tag.toggle(num)
+    return tag.is_active(num)
   end
-  
-  function obj:view_on_monitor(monitor)
+})
+
+tag_class:add_property("occupied", {
+  getter = function(self)
     local num = self:get_private().tag_number
-    if monitor and monitor.get_private then
-      local m = monitor:get_private().c_monitor
-      return tag.view_on_monitor(m, num)
-    end
-    return false
+    return tag.is_occupied(num)
   end
-  
-  function obj:get_clients()
-    local core_client = require("core.client")
-    local all_clients = core_client.get_all()
-    local tag_clients = {}
-    local tag_mask = 1 << (self.number - 1)
-    
-    for _, client in ipairs(all_clients) do
-      if client.tags & tag_mask ~= 0 then
-        table.insert(tag_clients, client)
-      end
-    end
-    
-    return tag_clients
+})
+
+tag_class:add_property("urgent", {
+  getter = function(self)
+    local num = self:get_private().tag_number
+    return tag.is_urgent(num)
   end
-  
-  function obj:get_visible_clients()
-    if not self.active then
-      return {}
-    end
-    return self:get_clients()
+})
+
+tag_class:add_property("layout", {
+  getter = function(self)
+    local num = self:get_private().tag_number
+    return tag_config.layouts[num] or "tile"
+  end,
+  setter = function(self, layout)
+    local num = self:get_private().tag_number
+    tag_config.layouts[num] = layout
+    self:emit_signal("property::layout", layout)
+    base.signal.emit("tag::layout_changed", self, layout)
+  end
+})
+
+-- Tag methods
+function tag_class.methods:view()
+  local num = self:get_private().tag_number
+  return tag.view(num)
+end
+
+function tag_class.methods:toggle()
+  local num = self:get_private().tag_number
+  return tag.toggle(num)
+end
+
+function tag_class.methods:view_on_monitor(monitor)
+  local num = self:get_private().tag_number
+  if monitor and monitor.get_private then
+    local m = monitor:get_private().c_monitor
+    return tag.view_on_monitor(m, num)
   end
+  return false
+end
+
+function tag_class.methods:get_clients()
+  local core_client = require("core.client")
+  local tag_mask = 1 << (self.number - 1)
+  return core_client.find({ tags = tag_mask })
+end
+
+function tag_class.methods:get_visible_clients()
+  if not self.active then
+    return {}
+  end
+  return self:get_clients()
+end
+
+-- Tag object creation (represents a single tag)
+local function create_tag_object(tag_number)
+  if not tag_number or tag_number < 1 or tag_number > tag.get_count() then
+    return nil
+  end
+  
+  local obj = tag_class:new()
+  
+  -- Store tag number privately
+  obj:set_private("tag_number", tag_number)
   
   return obj
 end
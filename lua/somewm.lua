@@ -81,6 +81,17 @@ somewm.config = {
       general_options = general_options or {}
       general_options.stack_insert_mode = value
       base.logger.info("Set stack_insert_mode to: " .. tostring(value))
+    elseif key == "status_compact" then
+      general_options = general_options or {}
+      general_options.status_compact = value == true
+      base.logger.info("Set status_compact to: " .. tostring(value))
+    elseif key == "defer_signals" then
+      general_options = general_options or {}
+      general_options.defer_signals = value == true
+      if Some and Some.signal_set_deferred then
+        Some.signal_set_deferred(general_options.defer_signals)
+      end
+      base.logger.info("Set defer_signals to: " .. tostring(value))
     else
       base.logger.warn("Unknown config option: " .. tostring(key))
     end
@@ -89,6 +100,10 @@ somewm.config = {
   get_option = function(key)
     if key == "stack_insert_mode" then
       return general_options and general_options.stack_insert_mode or "bottom"
+    elseif key == "status_compact" then
+      return general_options and general_options.status_compact or false
+    elseif key == "defer_signals" then
+      return general_options and general_options.defer_signals or false
     else
       base.logger.warn("Unknown config option: " .. tostring(key))
       return nil
@@ -111,6 +126,12 @@ somewm.init = function(config)
   if config.stack_insert_mode then
     somewm.config.set_option("stack_insert_mode", config.stack_insert_mode)
   end
+  if config.status_compact ~= nil then
+    somewm.config.set_option("status_compact", config.status_compact)
+  end
+  if config.defer_signals ~= nil then
+    somewm.config.set_option("defer_signals", config.defer_signals)
+  end
   
   -- Enable smart behaviors if requested
   if config.smart_behaviors ~= false then
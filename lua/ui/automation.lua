@@ -12,6 +12,23 @@ automation.rules = {}
 automation.behaviors = {}
 automation.enabled = true
 
+-- Compiled matchers, one per rule type, indexed by exact window class
+local engines = {}
+
+local function engine_for(rule_type)
+  local engine = engines[rule_type]
+  if not engine then
+    engine = base.predicate.new({
+      index = "class",
+      conditions = function(rule) return rule:get_private().conditions end,
+      enabled = function(rule) return rule.enabled end,
+    })
+    engines[rule_type] = engine
+  end
+  engine:set_rules(automation.rules[rule_type] or {})
+  return engine
+end
+
 -- Rule types
 automation.RULE_TYPES = {
   WINDOW_SPAWN = "window_spawn",
@@ -72,44 +89,7 @@ function automation.create_rule(config)
   end
   
   function rule:_matches_conditions(context)
-    local conditions = self:get_private().conditions
-    
-    for key, expected in pairs(conditions) do
-      local actual = context[key]
-      
-      if type(expected) == "function" then
-        if not expected(actual, context) then
-          return false
-        end
-      elseif type(expected) == "string" then
-        if type(actual) == "string" then
-          if not actual:match(expected) then
-            return false
-          end
-        else
-          if actual ~= expected then
-            return false
-          end
-        end
-      elseif type(expected) == "table" then
-        local found = false
-        for _, value in ipairs(expected) do
-          if actual == value then
-            found = true
-            break
-          end
-        end
-        if not found then
-          return false
-        end
-      else
-        if actual ~= expected then
-          return false
-        end
-      end
-    end
-    
-    return true
+    return base.predicate.test(self:get_private().conditions, context)
   end
   
   function rule:_execute_actions(context)
@@ -209,6 +189,7 @@ end
 -- Internal rule management
 function automation._register_rule(rule)
   if not rule.enabled then
+    automation._unregister_rule(rule)
     return
   end
   
@@ -223,7 +204,7 @@ function automation._register_rule(rule)
   -- Add to rules list
   table.insert(automation.rules[rule_type], rule)
   
-  -- Sort by priority
+  -- Sort by priority (also recompiles the matchers)
   automation._sort_rules()
 end
 
@@ -232,6 +213,7 @@ function automation._unregister_rule(rule)
     for i, r in ipairs(rules) do
       if r == rule then
         table.remove(rules, i)
+        engine_for(rule_type)
         break
       end
     end
@@ -239,10 +221,11 @@ function automation._unregister_rule(rule)
 end
 
 function automation._sort_rules()
-  for _, rules in pairs(automation.rules) do
+  for rule_type, rules in pairs(automation.rules) do
     table.sort(rules, function(a, b)
       return a.priority > b.priority
     end)
+    engine_for(rule_type)
   end
 end
 
@@ -251,15 +234,18 @@ function automation._execute_rules(rule_type, context)
     return 0
   end
   
-  local rules = automation.rules[rule_type] or {}
+  local engine = engines[rule_type]
   local executed = 0
   
-  for _, rule in ipairs(rules) do
-    if rule:execute(context) then
-      executed = executed + 1
-    end
+  if not engine then
+    return 0
   end
   
+  engine:match(context, function(rule)
+    rule:_execute_actions(context)
+    executed = executed + 1
+  end)
+  
   return executed
 end
 
@@ -421,6 +407,7 @@ function automation.clear_all_rules()
     end
   end
   automation.rules = {}
+  engines = {}
   base.logger.info("All automation rules cleared")
 end
 
@@ -429,12 +416,16 @@ function automation.get_stats()
   local stats = {
     enabled = automation.enabled,
     total_rules = 0,
-    by_type = {}
+    by_type = {},
+    match = {}
   }
   
   for rule_type, rules in pairs(automation.rules) do
     stats.by_type[rule_type] = #rules
     stats.total_rules = stats.total_rules + #rules
+    if engines[rule_type] then
+      stats.match[rule_type] = engines[rule_type]:stats()
+    end
   end
   
   return stats
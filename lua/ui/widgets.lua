@@ -14,184 +14,188 @@ local widgets = {}
 widgets.active_widgets = {}
 
 -- Widget base class using base.object
-function widgets.create_widget_base()
-  local widget = base.object.new()
-  
-  -- Widget properties
-  widget:add_property("width", {
-    getter = function(self)
-      return self:get_private().width or 100
-    end,
-    setter = function(self, value)
-      self:set_private("width", value)
-      self:emit_signal("property::width", value)
-      self:_update_geometry()
-    end
-  })
-  
-  widget:add_property("height", {
-    getter = function(self)
-      return self:get_private().height or 50
-    end,
-    setter = function(self, value)
-      self:set_private("height", value)
-      self:emit_signal("property::height", value)
-      self:_update_geometry()
-    end
-  })
-  
-  widget:add_property("x", {
-    getter = function(self)
-      return self:get_private().x or 0
-    end,
-    setter = function(self, value)
-      self:set_private("x", value)
-      self:emit_signal("property::x", value)
-      self:_update_geometry()
-    end
-  })
-  
-  widget:add_property("y", {
-    getter = function(self)
-      return self:get_private().y or 0
-    end,
-    setter = function(self, value)
-      self:set_private("y", value)
-      self:emit_signal("property::y", value)
-      self:_update_geometry()
-    end
-  })
-  
-  widget:add_property("visible", {
-    getter = function(self)
-      return self:get_private().visible ~= false
-    end,
-    setter = function(self, value)
-      local old_value = self:get_private().visible
-      self:set_private("visible", value)
-      self:emit_signal("property::visible", value)
-      
-      if value and not old_value then
-        self:show()
-      elseif not value and old_value then
-        self:hide()
-      end
-    end
-  })
-  
-  widget:add_property("text", {
-    getter = function(self)
-      return self:get_private().text or ""
-    end,
-    setter = function(self, value)
-      self:set_private("text", value)
-      self:emit_signal("property::text", value)
-      self:_update_content()
-    end
-  })
-  
-  -- Internal methods
-  function widget:_update_geometry()
-    self:emit_signal("geometry_changed")
-    if self.visible then
-      self:_redraw()
-    end
+local widget_class = base.object.class()
+widgets.widget_class = widget_class
+
+-- Widget properties
+widget_class:add_property("width", {
+  getter = function(self)
+    return self:get_private().width or 100
+  end,
+  setter = function(self, value)
+    self:set_private("width", value)
+    self:emit_signal("property::width", value)
+    self:_update_geometry()
   end
-  
-  function widget:_update_content()
-    self:emit_signal("content_changed")
-    if self.visible then
-      self:_redraw()
-    end
+})
+
+widget_class:add_property("height", {
+  getter = function(self)
+    return self:get_private().height or 50
+  end,
+  setter = function(self, value)
+    self:set_private("height", value)
+    self:emit_signal("property::height", value)
+    self:_update_geometry()
   end
-  
-  function widget:_redraw()
-    -- Override in subclasses
-    self:emit_signal("redraw")
+})
+
+widget_class:add_property("x", {
+  getter = function(self)
+    return self:get_private().x or 0
+  end,
+  setter = function(self, value)
+    self:set_private("x", value)
+    self:emit_signal("property::x", value)
+    self:_update_geometry()
   end
-  
-  -- Public methods
-  function widget:show()
-    if not self.visible then
-      self.visible = true
+})
+
+widget_class:add_property("y", {
+  getter = function(self)
+    return self:get_private().y or 0
+  end,
+  setter = function(self, value)
+    self:set_private("y", value)
+    self:emit_signal("property::y", value)
+    self:_update_geometry()
+  end
+})
+
+widget_class:add_property("visible", {
+  getter = function(self)
+    return self:get_private().visible ~= false
+  end,
+  setter = function(self, value)
+    local old_value = self:get_private().visible
+    self:set_private("visible", value)
+    self:emit_signal("property::visible", value)
+    
+    if value and not old_value then
+      self:show()
+    elseif not value and old_value then
+      self:hide()
     end
-    self:emit_signal("show")
-    -- Ensure we redraw when showing
+  end
+})
+
+widget_class:add_property("text", {
+  getter = function(self)
+    return self:get_private().text or ""
+  end,
+  setter = function(self, value)
+    self:set_private("text", value)
+    self:emit_signal("property::text", value)
+    self:_update_content()
+  end
+})
+
+-- Internal methods
+function widget_class.methods:_update_geometry()
+  self:emit_signal("geometry_changed")
+  if self.visible then
     self:_redraw()
   end
-  
-  function widget:hide()
-    if self.visible then
-      self.visible = false
-    end
-    self:emit_signal("hide")
+end
+
+function widget_class.methods:_update_content()
+  self:emit_signal("content_changed")
+  if self.visible then
+    self:_redraw()
   end
-  
-  function widget:destroy()
-    self:hide()
-    
-    -- Remove from active widgets
-    for i, w in ipairs(widgets.active_widgets) do
-      if w == self then
-        table.remove(widgets.active_widgets, i)
-        break
-      end
+end
+
+function widget_class.methods:_redraw()
+  -- Override in subclasses
+  self:emit_signal("redraw")
+end
+
+-- Public methods
+function widget_class.methods:show()
+  if not self.visible then
+    self.visible = true
+  end
+  self:emit_signal("show")
+  -- Ensure we redraw when showing
+  self:_redraw()
+end
+
+function widget_class.methods:hide()
+  if self.visible then
+    self.visible = false
+  end
+  self:emit_signal("hide")
+end
+
+function widget_class.methods:destroy()
+  self:hide()
+  
+  -- Remove from active widgets
+  for i, w in ipairs(widgets.active_widgets) do
+    if w == self then
+      table.remove(widgets.active_widgets, i)
+      break
     end
-    
-    self:emit_signal("destroy")
-    base.object.destroy(self)
   end
   
-  return widget
+  self:emit_signal("destroy")
+  base.object.destroy(self)
+end
+
+function widgets.create_widget_base()
+  return widget_class:new()
 end
 
 -- Notification widget class
+local notification_class = base.object.class(widget_class)
+
+-- Override redraw for notification-specific rendering
+function notification_class.methods:_redraw()
+  if not self.visible then
+    return
+  end
+  
+  base.logger.debug(string.format("Drawing notification: %dx%d at (%d,%d) with text '%s'", 
+    self.width, self.height, self.x, self.y, self.text))
+  
+  -- Create Wayland surface
+  local surface_created = wayland_surface.create_widget_surface(
+    self.width, self.height, self.x, self.y, self.text
+  )
+  
+  if surface_created then
+    base.logger.info("Notification displayed using Wayland surface")
+    self:set_private("surface_id", surface_created)
+  else
+    base.logger.warn("Could not create Wayland surface for notification")
+  end
+end
+
+function notification_class.methods:hide()
+  if self:get_private().surface_id then
+    wayland_surface.destroy_widget_surface(self:get_private().surface_id)
+    self:set_private("surface_id", nil)
+  end
+  
+  -- Call parent hide
+  widget_class.methods.hide(self)
+end
+
 function widgets.create_notification(text, timeout, config)
   config = config or {}
   
-  local notification = widgets.create_widget_base()
+  local notification = notification_class:new()
   
-  -- Set notification properties
-  notification.width = config.width or 300
-  notification.height = config.height or 100
-  notification.x = config.x or 50
-  notification.y = config.y or 50
-  notification.text = text or ""
+  -- Set notification properties; stored directly so that nothing is drawn
+  -- before show()
+  notification:set_private("width", config.width or 300)
+  notification:set_private("height", config.height or 100)
+  notification:set_private("x", config.x or 50)
+  notification:set_private("y", config.y or 50)
+  notification:set_private("text", text or "")
   notification:set_private("timeout", timeout or 5)
   notification:set_private("surface_id", nil)
   
-  -- Override redraw for notification-specific rendering
-  function notification:_redraw()
-    if not self.visible then
-      return
-    end
-    
-    base.logger.debug(string.format("Drawing notification: %dx%d at (%d,%d) with text '%s'", 
-      self.width, self.height, self.x, self.y, self.text))
-    
-    -- Create Wayland surface
-    local surface_created = wayland_surface.create_widget_surface(
-      self.width, self.height, self.x, self.y, self.text
-    )
-    
-    if surface_created then
-      base.logger.info("Notification displayed using Wayland surface")
-      self:set_private("surface_id", surface_created)
-    else
-      base.logger.warn("Could not create Wayland surface for notification")
-    end
-  end
-  
-  function notification:hide()
-    if self:get_private().surface_id then
-      wayland_surface.destroy_widget_surface(self:get_private().surface_id)
-      self:set_private("surface_id", nil)
-    end
-    
-    -- Call parent hide
-    widgets.create_widget_base().hide(self)
-  end
-  
   -- Auto-hide after timeout
   if notification:get_private().timeout > 0 then
     -- In a real implementation, this would use base.timer
@@ -287,7 +291,7 @@ end
 function widgets.show_widget(widget)
   base.logger.warn("widgets.show_widget is deprecated, use widget:show() instead")
   
-  if type(widget) == "table" and widget.show then
+  if base.object.is(widget) and widget.show then
     widget:show()
     return true
   elseif type(widget) == "table" and widget.text then
@@ -302,7 +306,7 @@ end
 function widgets.hide_widget(widget)
   base.logger.warn("widgets.hide_widget is deprecated, use widget:hide() instead")
   
-  if type(widget) == "table" and widget.hide then
+  if base.object.is(widget) and widget.hide then
     widget:hide()
     return true
   else
@@ -327,168 +331,171 @@ function widgets.clear_all()
 end
 
 -- Wibar (window bar) widget class
-function widgets.create_wibar(config)
-  config = config or {}
-  
-  local wibar = widgets.create_widget_base()
-  
-  -- Set wibar properties with defaults
-  wibar.width = config.width or 1920  -- Full screen width by default
-  wibar.height = config.height or 30
-  wibar.x = config.x or 0
-  wibar.y = config.y or 0
-  wibar.layer = config.layer or "top"
-  wibar.anchor = config.anchor or "top"
-  wibar.exclusive = config.exclusive ~= false  -- Default to true
-  wibar:set_private("surface_id", nil)
-  wibar:set_private("background_color", config.background_color or {0.2, 0.2, 0.2, 0.9})
-  wibar:set_private("border_color", config.border_color or {0.3, 0.6, 1.0, 1.0})
-  wibar:set_private("border_width", config.border_width or 1)
-  
-  -- Wibar-specific properties
-  wibar:add_property("layer", {
-    getter = function(self)
-      return self:get_private().layer or "top"
-    end,
-    setter = function(self, value)
-      self:set_private("layer", value)
-      self:emit_signal("property::layer", value)
-      if self.visible then
-        self:_redraw()
-      end
-    end
-  })
-  
-  wibar:add_property("anchor", {
-    getter = function(self)
-      return self:get_private().anchor or "top"
-    end,
-    setter = function(self, value)
-      self:set_private("anchor", value)
-      self:emit_signal("property::anchor", value)
-      if self.visible then
-        self:_redraw()
-      end
-    end
-  })
-  
-  wibar:add_property("exclusive", {
-    getter = function(self)
-      return self:get_private().exclusive ~= false
-    end,
-    setter = function(self, value)
-      self:set_private("exclusive", value)
-      self:emit_signal("property::exclusive", value)
-      if self.visible then
-        self:_redraw()
-      end
-    end
-  })
-  
-  -- Override redraw for wibar-specific rendering
-  function wibar:_redraw()
-    if not self.visible then
-      return
+local wibar_class = base.object.class(widget_class)
+
+-- Wibar-specific properties
+wibar_class:add_property("layer", {
+  getter = function(self)
+    return self:get_private().layer or "top"
+  end,
+  setter = function(self, value)
+    self:set_private("layer", value)
+    self:emit_signal("property::layer", value)
+    if self.visible then
+      self:_redraw()
     end
-    
-    -- Destroy existing surface if any
-    if self:get_private().surface_id then
-      Some.destroy_layer_surface(self:get_private().surface_id)
-      self:set_private("surface_id", nil)
+  end
+})
+
+wibar_class:add_property("anchor", {
+  getter = function(self)
+    return self:get_private().anchor or "top"
+  end,
+  setter = function(self, value)
+    self:set_private("anchor", value)
+    self:emit_signal("property::anchor", value)
+    if self.visible then
+      self:_redraw()
     end
-    
-    base.logger.debug(string.format("Drawing wibar: %dx%d at (%d,%d), layer=%s, exclusive=%s", 
-      self.width, self.height, self.x, self.y, self.layer, tostring(self.exclusive)))
-    
-    -- Calculate exclusive zone (height if exclusive, 0 if not)
-    local exclusive_zone = self.exclusive and self.height or 0
-    
-    -- Create layer surface
-    local layer_surface = Some.create_layer_surface(
-      self.width, self.height, self.x, self.y, 
-      self.layer, exclusive_zone, self.anchor
-    )
-    
-    if layer_surface then
-      base.logger.info("Wibar layer surface created successfully")
-      self:set_private("surface_id", layer_surface)
-      
-      -- TODO: Add Cairo drawing here to render wibar content
-      self:_draw_content()
-    else
-      base.logger.warn("Could not create layer surface for wibar")
+  end
+})
+
+wibar_class:add_property("exclusive", {
+  getter = function(self)
+    return self:get_private().exclusive ~= false
+  end,
+  setter = function(self, value)
+    self:set_private("exclusive", value)
+    self:emit_signal("property::exclusive", value)
+    if self.visible then
+      self:_redraw()
     end
   end
+})
+
+-- Override redraw for wibar-specific rendering
+function wibar_class.methods:_redraw()
+  if not self.visible then
+    return
+  end
   
-  function wibar:_draw_content()
-    -- Generate wibar content (time, workspace info, etc.)
-    local content = self:_generate_content()
-    self.text = content
-    
-    local bg_color = self:get_private().background_color
-    local border_color = self:get_private().border_color
-    local border_width = self:get_private().border_width
-    
-    base.logger.debug(string.format("Drawing wibar content: '%s' with bg_color=[%.1f,%.1f,%.1f,%.1f]",
-      content, bg_color[1], bg_color[2], bg_color[3], bg_color[4]))
+  -- Destroy existing surface if any
+  if self:get_private().surface_id then
+    Some.destroy_layer_surface(self:get_private().surface_id)
+    self:set_private("surface_id", nil)
   end
   
-  function wibar:_generate_content()
-    local content_parts = {}
-    
-    -- Add current time
-    local time = os.date("%H:%M:%S")
-    table.insert(content_parts, "Time: " .. time)
-    
-    -- Add workspace/tag info if available
-    if somewm and somewm.get_focused_tag then
-      local focused_tag = somewm.get_focused_tag()
-      if focused_tag then
-        table.insert(content_parts, "Tag: " .. (focused_tag.name or "unknown"))
-      end
-    end
-    
-    -- Add client count if available
-    if somewm and somewm.get_clients then
-      local clients = somewm.get_clients()
-      if clients then
-        table.insert(content_parts, "Clients: " .. #clients)
-      end
-    end
+  base.logger.debug(string.format("Drawing wibar: %dx%d at (%d,%d), layer=%s, exclusive=%s", 
+    self.width, self.height, self.x, self.y, self.layer, tostring(self.exclusive)))
+  
+  -- Calculate exclusive zone (height if exclusive, 0 if not)
+  local exclusive_zone = self.exclusive and self.height or 0
+  
+  -- Create layer surface
+  local layer_surface = Some.create_layer_surface(
+    self.width, self.height, self.x, self.y, 
+    self.layer, exclusive_zone, self.anchor
+  )
+  
+  if layer_surface then
+    base.logger.info("Wibar layer surface created successfully")
+    self:set_private("surface_id", layer_surface)
     
-    return table.concat(content_parts, " | ")
+    -- TODO: Add Cairo drawing here to render wibar content
+    self:_draw_content()
+  else
+    base.logger.warn("Could not create layer surface for wibar")
   end
+end
+
+function wibar_class.methods:_draw_content()
+  -- Generate wibar content (time, workspace info, etc.)
+  local content = self:_generate_content()
+  self.text = content
   
-  -- Update wibar content periodically
-  function wibar:start_updates()
-    self:set_private("update_enabled", true)
-    self:_schedule_update()
-  end
+  local bg_color = self:get_private().background_color
+  local border_color = self:get_private().border_color
+  local border_width = self:get_private().border_width
   
-  function wibar:stop_updates()
-    self:set_private("update_enabled", false)
+  base.logger.debug(string.format("Drawing wibar content: '%s' with bg_color=[%.1f,%.1f,%.1f,%.1f]",
+    content, bg_color[1], bg_color[2], bg_color[3], bg_color[4]))
+end
+
+function wibar_class.methods:_generate_content()
+  local content_parts = {}
+  
+  -- Add current time
+  local time = os.date("%H:%M:%S")
+  table.insert(content_parts, "Time: " .. time)
+  
+  -- Add workspace/tag info if available
+  if somewm and somewm.get_focused_tag then
+    local focused_tag = somewm.get_focused_tag()
+    if focused_tag then
+      table.insert(content_parts, "Tag: " .. (focused_tag.name or "unknown"))
+    end
   end
   
-  function wibar:_schedule_update()
-    -- In a real implementation, this would use a proper timer
-    -- For now, we'll update on the next redraw cycle
-    if self:get_private().update_enabled and self.visible then
-      self:_draw_content()
-      
-      -- Log the updated content
-      base.logger.debug("Wibar content updated: " .. (self.text or ""))
+  -- Add client count if available
+  if somewm and somewm.get_clients then
+    local clients = somewm.get_clients()
+    if clients then
+      table.insert(content_parts, "Clients: " .. #clients)
     end
   end
   
-  function wibar:hide()
-    if self:get_private().surface_id then
-      Some.destroy_layer_surface(self:get_private().surface_id)
-      self:set_private("surface_id", nil)
-    end
+  return table.concat(content_parts, " | ")
+end
+
+-- Update wibar content periodically
+function wibar_class.methods:start_updates()
+  self:set_private("update_enabled", true)
+  self:_schedule_update()
+end
+
+function wibar_class.methods:stop_updates()
+  self:set_private("update_enabled", false)
+end
+
+function wibar_class.methods:_schedule_update()
+  -- In a real implementation, this would use a proper timer
+  -- For now, we'll update on the next redraw cycle
+  if self:get_private().update_enabled and self.visible then
+    self:_draw_content()
     
-    -- Call parent hide
-    widgets.create_widget_base().hide(self)
+    -- Log the updated content
+    base.logger.debug("Wibar content updated: " .. (self.text or ""))
   end
+end
+
+function wibar_class.methods:hide()
+  if self:get_private().surface_id then
+    Some.destroy_layer_surface(self:get_private().surface_id)
+    self:set_private("surface_id", nil)
+  end
+  
+  -- Call parent hide
+  widget_class.methods.hide(self)
+end
+
+function widgets.create_wibar(config)
+  config = config or {}
+  
+  local wibar = wibar_class:new()
+  
+  -- Set wibar properties with defaults; stored directly so that nothing is
+  -- drawn before show()
+  wibar:set_private("width", config.width or 1920)  -- Full screen width by default
+  wibar:set_private("height", config.height or 30)
+  wibar:set_private("x", config.x or 0)
+  wibar:set_private("y", config.y or 0)
+  wibar:set_private("layer", config.layer or "top")
+  wibar:set_private("anchor", config.anchor or "top")
+  wibar:set_private("exclusive", config.exclusive ~= false)  -- Default to true
+  wibar:set_private("surface_id", nil)
+  wibar:set_private("background_color", config.background_color or {0.2, 0.2, 0.2, 0.9})
+  wibar:set_private("border_color", config.border_color or {0.3, 0.6, 1.0, 1.0})
+  wibar:set_private("border_width", config.border_width or 1)
   
   -- Add to active widgets registry
   table.insert(widgets.active_widgets, wibar)
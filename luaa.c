@@ -1,4 +1,5 @@
 #include "luaa.h"
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,7 +9,11 @@
 #include <wayland-server-core.h>
 // Cairo header will be included when needed
 
+#include "luaobject.h"
+#include "luasignal.h"
+#include "trace.h"
 #include "util.h"
+#include "watchdog.h"
 
 lua_State *L = NULL;
 
@@ -199,15 +204,19 @@ void lua_client_mapped(void *client_ptr) {
     lua_client_ref_add(client_ptr);
 }
 
+static void drop_client_cache(void *c);
+
 // Called from dwl.c when a client is destroyed
 void lua_client_destroyed(void *client_ptr) {
     if (!client_ptr) return;
     
-    // First emit the unmap event if we haven't already
-    lua_event_emit(LUA_EVENT_CLIENT_UNMAP, client_ptr, NULL);
+    SIGEMIT(SigClientDestroy, ARGCLIENT(client_ptr));
+    // Deliver deferred signals while the client can still be queried
+    luasignal_flush();
     
     // Mark client as invalid in reference tracking
     lua_client_ref_remove(client_ptr);
+    drop_client_cache(client_ptr);
 }
 
 // Client userdata metatable name
@@ -275,103 +284,6 @@ static void *lua_get_safe_client(lua_State *L, int index, const char *function_n
     return client;
 }
 
-// Event system implementation
-#define MAX_CALLBACKS_PER_EVENT 32
-
-typedef struct {
-    int callback_refs[MAX_CALLBACKS_PER_EVENT];
-    int count;
-} EventCallbackList;
-
-static EventCallbackList event_callbacks[LUA_EVENT_COUNT];
-
-void lua_event_init(void) {
-    for (int i = 0; i < LUA_EVENT_COUNT; i++) {
-        event_callbacks[i].count = 0;
-        for (int j = 0; j < MAX_CALLBACKS_PER_EVENT; j++) {
-            event_callbacks[i].callback_refs[j] = LUA_REFNIL;
-        }
-    }
-}
-
-void lua_event_cleanup(void) {
-    if (!L) return;
-    
-    for (int i = 0; i < LUA_EVENT_COUNT; i++) {
-        for (int j = 0; j < event_callbacks[i].count; j++) {
-            if (event_callbacks[i].callback_refs[j] != LUA_REFNIL) {
-                luaL_unref(L, LUA_REGISTRYINDEX, event_callbacks[i].callback_refs[j]);
-                event_callbacks[i].callback_refs[j] = LUA_REFNIL;
-            }
-        }
-        event_callbacks[i].count = 0;
-    }
-}
-
-int lua_event_connect(LuaEventType event_type, int callback_ref) {
-    if (event_type >= LUA_EVENT_COUNT || event_callbacks[event_type].count >= MAX_CALLBACKS_PER_EVENT) {
-        return -1;
-    }
-    
-    int index = event_callbacks[event_type].count;
-    event_callbacks[event_type].callback_refs[index] = callback_ref;
-    event_callbacks[event_type].count++;
-    return index;
-}
-
-void lua_event_disconnect(LuaEventType event_type, int callback_ref) {
-    if (event_type >= LUA_EVENT_COUNT || !L) return;
-    
-    EventCallbackList *list = &event_callbacks[event_type];
-    for (int i = 0; i < list->count; i++) {
-        if (list->callback_refs[i] == callback_ref) {
-            luaL_unref(L, LUA_REGISTRYINDEX, callback_ref);
-            // Shift remaining callbacks down
-            for (int j = i; j < list->count - 1; j++) {
-                list->callback_refs[j] = list->callback_refs[j + 1];
-            }
-            list->callback_refs[list->count - 1] = LUA_REFNIL;
-            list->count--;
-            break;
-        }
-    }
-}
-
-void lua_event_emit(LuaEventType event_type, void *client, void *data) {
-    if (event_type >= LUA_EVENT_COUNT || !L) return;
-    
-    EventCallbackList *list = &event_callbacks[event_type];
-    for (int i = 0; i < list->count; i++) {
-        if (list->callback_refs[i] != LUA_REFNIL) {
-            // Get the callback function from registry
-            lua_rawgeti(L, LUA_REGISTRYINDEX, list->callback_refs[i]);
-            
-            // Push client as first argument (or nil if no client)
-            if (client) {
-                lua_push_client_userdata(L, client);
-            } else {
-                lua_pushnil(L);
-            }
-            
-            // Push event-specific data as second argument (or nil)
-            if (data) {
-                // For now, we'll pass simple data types
-                // This can be expanded later based on event needs
-                lua_pushlightuserdata(L, data);
-            } else {
-                lua_pushnil(L);
-            }
-            
-            // Call the callback function
-            if (lua_pcall(L, 2, 0, 0) != LUA_OK) {
-                const char *error = lua_tostring(L, -1);
-                fprintf(stderr, "Error in event callback: %s\n", error);
-                lua_pop(L, 1);
-            }
-        }
-    }
-}
-
 static int l_hello_world(lua_State *lua) {
   printf("Hello, world!\n");
   return 0;
@@ -662,22 +574,147 @@ static int l_destroy_layer_surface(lua_State *L) {
 
 // Client wrapper functions are now declared in luaa.h
 
+// Per-client property caches, see lua_client_invalidate() in luaa.h. The
+// registry table at &client_caches maps the client pointer to its cache.
+static const char client_caches = 0;
+static unsigned long cache_invalidations;
+
+static void push_client_caches(lua_State *L) {
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, &client_caches) != LUA_TTABLE) {
+    lua_pop(L, 1);
+    lua_newtable(L);
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &client_caches);
+  }
+}
+
+// OR props into the dirty bits of c's cache table at the top of the stack
+static void mark_dirty(lua_State *L, unsigned int props) {
+  lua_Integer dirty;
+
+  lua_getfield(L, -1, "dirty");
+  dirty = lua_tointeger(L, -1);
+  lua_pop(L, 1);
+  lua_pushinteger(L, dirty | props);
+  lua_setfield(L, -2, "dirty");
+}
+
+void lua_client_invalidate(void *c, unsigned int props) {
+  int top;
+
+  if (!L || !props)
+    return;
+  top = lua_gettop(L);
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, &client_caches) == LUA_TTABLE &&
+      lua_rawgetp(L, -1, c) == LUA_TTABLE) {
+    mark_dirty(L, props);
+    cache_invalidations++;
+  }
+  lua_settop(L, top);
+}
+
+// Forget c's cache once it is destroyed; anyone still holding the table
+// sees every property dirty and Some.client_snapshot() returning nil
+static void drop_client_cache(void *c) {
+  if (!L)
+    return;
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, &client_caches) == LUA_TTABLE) {
+    if (lua_rawgetp(L, -1, c) == LUA_TTABLE)
+      mark_dirty(L, ClientPropAll);
+    lua_pop(L, 1);
+    lua_pushnil(L);
+    lua_rawsetp(L, -2, c);
+  }
+  lua_pop(L, 1);
+}
+
+// Some.client_cache(c) -> the cache table of c, the same for every handle of
+// the same client, or nil if c is gone. A new cache has every bit dirty.
+static int l_client_cache(lua_State *L) {
+  void *c = lua_get_safe_client(L, 1, __func__);
+
+  if (!c) {
+    lua_pushnil(L);
+    return 1;
+  }
+  push_client_caches(L);
+  if (lua_rawgetp(L, -1, c) != LUA_TTABLE) {
+    lua_pop(L, 1);
+    lua_createtable(L, 0, 14);
+    lua_pushinteger(L, ClientPropAll);
+    lua_setfield(L, -2, "dirty");
+    lua_pushvalue(L, -1);
+    lua_rawsetp(L, -3, c);
+  }
+  return 1;
+}
+
+// Some.client_cache_stats() -> {caches = n, invalidations = n}
+static int l_client_cache_stats(lua_State *L) {
+  lua_Integer n = 0;
+
+  lua_createtable(L, 0, 2);
+  push_client_caches(L);
+  lua_pushnil(L);
+  while (lua_next(L, -2)) {
+    lua_pop(L, 1);
+    n++;
+  }
+  lua_pop(L, 1);
+  lua_pushinteger(L, n);
+  lua_setfield(L, -2, "caches");
+  lua_pushinteger(L, (lua_Integer)cache_invalidations);
+  lua_setfield(L, -2, "invalidations");
+  return 1;
+}
+
 // Client API functions
 static int l_client_get_all(lua_State *L) {
-  int count = lua_get_client_count();
+  int i = 0;
   lua_newtable(L);
   
-  for (int i = 0; i < count; i++) {
-    void *c = lua_get_client_by_index(i);
-    if (c) {
-      lua_push_client_userdata(L, c);
-      lua_rawseti(L, -2, i + 1);  // Lua arrays are 1-indexed
-    }
+  for (void *c = lua_get_next_client(NULL); c; c = lua_get_next_client(c)) {
+    lua_push_client_userdata(L, c);
+    lua_rawseti(L, -2, ++i);  // Lua arrays are 1-indexed
   }
   
   return 1;
 }
 
+// Some.client_find{appid = s, title = s, pid = n, tags = mask, monitor = m}
+// -> array of matching clients, all keys optional. Evaluated against the
+// C-side indexes, so only the matches cross into Lua.
+static int l_client_find(lua_State *L) {
+  ClientQuery q = {0};
+  void *stackbuf[64], **out = stackbuf;
+  size_t n;
+
+  luaL_checktype(L, 1, LUA_TTABLE);
+  lua_getfield(L, 1, "appid");
+  q.appid = lua_tostring(L, -1);
+  lua_getfield(L, 1, "title");
+  q.title = lua_tostring(L, -1);
+  lua_getfield(L, 1, "pid");
+  q.pid = (int)luaL_optinteger(L, -1, 0);
+  lua_getfield(L, 1, "tags");
+  q.tags = (uint32_t)luaL_optinteger(L, -1, 0);
+  lua_getfield(L, 1, "monitor");
+  q.monitor = lua_touserdata(L, -1);
+
+  n = lua_find_clients(&q, out, LENGTH(stackbuf));
+  if (n > LENGTH(stackbuf)) {
+    out = ecalloc(n, sizeof(*out));
+    n = lua_find_clients(&q, out, n);
+  }
+  lua_createtable(L, (int)n, 0);
+  for (size_t i = 0; i < n; i++) {
+    lua_push_client_userdata(L, out[i]);
+    lua_rawseti(L, -2, (lua_Integer)i + 1);
+  }
+  if (out != stackbuf) free(out);
+  return 1;
+}
+
 static int l_client_get_focused(lua_State *L) {
   void *c = lua_get_focused_client();
   lua_push_client_userdata(L, c);
@@ -801,6 +838,210 @@ static int l_client_get_fullscreen(lua_State *L) {
   return 1;
 }
 
+// Fill the table at idx with one client's fields. Fields that are unknown are
+// set to nil explicitly so a reused table does not keep stale values.
+static void set_client_snapshot(lua_State *L, int idx, const LuaClientSnapshot *s) {
+  idx = lua_absindex(L, idx);
+  lua_pushstring(L, s->title);
+  lua_setfield(L, idx, "title");
+  lua_pushstring(L, s->appid);
+  lua_setfield(L, idx, "appid");
+  if (s->pid > 0) {
+    lua_pushinteger(L, s->pid);
+  } else {
+    lua_pushnil(L);
+  }
+  lua_setfield(L, idx, "pid");
+  lua_pushinteger(L, s->x);
+  lua_setfield(L, idx, "x");
+  lua_pushinteger(L, s->y);
+  lua_setfield(L, idx, "y");
+  lua_pushinteger(L, s->width);
+  lua_setfield(L, idx, "width");
+  lua_pushinteger(L, s->height);
+  lua_setfield(L, idx, "height");
+  lua_pushinteger(L, s->tags);
+  lua_setfield(L, idx, "tags");
+  lua_pushboolean(L, s->floating);
+  lua_setfield(L, idx, "floating");
+  lua_pushboolean(L, s->fullscreen);
+  lua_setfield(L, idx, "fullscreen");
+  lua_pushboolean(L, s->urgent);
+  lua_setfield(L, idx, "urgent");
+  lua_pushboolean(L, s->visible);
+  lua_setfield(L, idx, "visible");
+  if (s->monitor) {
+    lua_pushlightuserdata(L, s->monitor);
+  } else {
+    lua_pushnil(L);
+  }
+  lua_setfield(L, idx, "monitor");
+}
+
+// Some.client_snapshot(c [, reuse]) -> table with every client property, or
+// nil if c is gone. If reuse is a table it is filled and returned instead of
+// allocating a new one.
+static int l_client_snapshot(lua_State *L) {
+  void *c = lua_get_safe_client(L, 1, __func__);
+  LuaClientSnapshot s;
+
+  if (!c) {
+    lua_pushnil(L);
+    return 1;
+  }
+  lua_get_client_snapshot(c, &s);
+  if (lua_istable(L, 2)) {
+    lua_settop(L, 2);
+  } else {
+    lua_createtable(L, 0, 13);
+  }
+  set_client_snapshot(L, -1, &s);
+  return 1;
+}
+
+// Columns of the table returned by Some.clients_snapshot(). Each is an array
+// indexed by the client's position in the result; unknown titles, app_ids,
+// pids and monitors are false rather than nil so the arrays have no holes.
+enum {
+  COL_CLIENT, COL_TITLE, COL_APPID, COL_PID, COL_X, COL_Y, COL_WIDTH,
+  COL_HEIGHT, COL_TAGS, COL_FLOATING, COL_FULLSCREEN, COL_URGENT,
+  COL_VISIBLE, COL_MONITOR, COL_COUNT
+};
+
+static const char *const snapshot_columns[COL_COUNT] = {
+  "client", "title", "appid", "pid", "x", "y", "width", "height", "tags",
+  "floating", "fullscreen", "urgent", "visible", "monitor",
+};
+
+typedef struct {
+  uint32_t tags;        // 0 = any
+  void *monitor;        // NULL = any
+  int floating;         // -1 = any
+  int visible;          // -1 = any
+} SnapshotFilter;
+
+static void read_snapshot_filter(lua_State *L, int idx, SnapshotFilter *f) {
+  f->tags = 0;
+  f->monitor = NULL;
+  f->floating = -1;
+  f->visible = -1;
+  if (!lua_istable(L, idx)) return;
+
+  lua_getfield(L, idx, "tags");
+  if (lua_isinteger(L, -1)) f->tags = (uint32_t)lua_tointeger(L, -1);
+  lua_getfield(L, idx, "monitor");
+  f->monitor = lua_touserdata(L, -1);
+  lua_getfield(L, idx, "floating");
+  if (lua_isboolean(L, -1)) f->floating = lua_toboolean(L, -1);
+  lua_getfield(L, idx, "visible");
+  if (lua_isboolean(L, -1)) f->visible = lua_toboolean(L, -1);
+  lua_pop(L, 4);
+}
+
+static int snapshot_filter_match(const SnapshotFilter *f, const LuaClientSnapshot *s) {
+  return (!f->tags || (s->tags & f->tags))
+      && (!f->monitor || s->monitor == f->monitor)
+      && (f->floating < 0 || !s->floating == !f->floating)
+      && (f->visible < 0 || !s->visible == !f->visible);
+}
+
+// Some.clients_snapshot([filter [, reuse]]) -> {n = count, client = {...},
+// title = {...}, ...} for every client matching filter ({tags = mask,
+// monitor = m, floating = bool, visible = bool}, all optional), in one call.
+// Passing the previous result as reuse refills its column tables in place.
+static int l_clients_snapshot(lua_State *L) {
+  SnapshotFilter filter;
+  LuaClientSnapshot s;
+  lua_Integer n = 0, old_n = 0;
+  int result, col0;
+
+  read_snapshot_filter(L, 1, &filter);
+  luaL_checkstack(L, COL_COUNT + 4, __func__);
+  if (lua_istable(L, 2)) {
+    lua_settop(L, 2);
+    lua_getfield(L, 2, "n");
+    old_n = lua_isinteger(L, -1) ? lua_tointeger(L, -1) : 0;
+    lua_pop(L, 1);
+  } else {
+    lua_settop(L, 1);
+    lua_createtable(L, 0, COL_COUNT + 1);
+  }
+  result = lua_gettop(L);
+
+  col0 = result + 1;
+  for (int i = 0; i < COL_COUNT; i++) {
+    if (lua_getfield(L, result, snapshot_columns[i]) != LUA_TTABLE) {
+      lua_pop(L, 1);
+      lua_createtable(L, lua_get_client_count(), 0);
+      lua_pushvalue(L, -1);
+      lua_setfield(L, result, snapshot_columns[i]);
+    }
+  }
+
+  for (void *c = lua_get_next_client(NULL); c; c = lua_get_next_client(c)) {
+    lua_get_client_snapshot(c, &s);
+    if (!snapshot_filter_match(&filter, &s)) continue;
+    n++;
+    lua_push_client_userdata(L, c);
+    lua_rawseti(L, col0 + COL_CLIENT, n);
+    if (s.title) {
+      lua_pushstring(L, s.title);
+    } else {
+      lua_pushboolean(L, 0);
+    }
+    lua_rawseti(L, col0 + COL_TITLE, n);
+    if (s.appid) {
+      lua_pushstring(L, s.appid);
+    } else {
+      lua_pushboolean(L, 0);
+    }
+    lua_rawseti(L, col0 + COL_APPID, n);
+    if (s.pid > 0) {
+      lua_pushinteger(L, s.pid);
+    } else {
+      lua_pushboolean(L, 0);
+    }
+    lua_rawseti(L, col0 + COL_PID, n);
+    lua_pushinteger(L, s.x);
+    lua_rawseti(L, col0 + COL_X, n);
+    lua_pushinteger(L, s.y);
+    lua_rawseti(L, col0 + COL_Y, n);
+    lua_pushinteger(L, s.width);
+    lua_rawseti(L, col0 + COL_WIDTH, n);
+    lua_pushinteger(L, s.height);
+    lua_rawseti(L, col0 + COL_HEIGHT, n);
+    lua_pushinteger(L, s.tags);
+    lua_rawseti(L, col0 + COL_TAGS, n);
+    lua_pushboolean(L, s.floating);
+    lua_rawseti(L, col0 + COL_FLOATING, n);
+    lua_pushboolean(L, s.fullscreen);
+    lua_rawseti(L, col0 + COL_FULLSCREEN, n);
+    lua_pushboolean(L, s.urgent);
+    lua_rawseti(L, col0 + COL_URGENT, n);
+    lua_pushboolean(L, s.visible);
+    lua_rawseti(L, col0 + COL_VISIBLE, n);
+    if (s.monitor) {
+      lua_pushlightuserdata(L, s.monitor);
+    } else {
+      lua_pushboolean(L, 0);
+    }
+    lua_rawseti(L, col0 + COL_MONITOR, n);
+  }
+
+  // Drop rows left over from a larger previous result
+  for (lua_Integer i = n + 1; i <= old_n; i++) {
+    for (int col = 0; col < COL_COUNT; col++) {
+      lua_pushnil(L);
+      lua_rawseti(L, col0 + col, i);
+    }
+  }
+
+  lua_settop(L, result);
+  lua_pushinteger(L, n);
+  lua_setfield(L, result, "n");
+  return 1;
+}
+
 // Client manipulation functions
 static int l_client_focus(lua_State *L) {
   void *c = lua_get_safe_client(L, 1, __func__);
@@ -869,77 +1110,54 @@ static int l_client_set_tags(lua_State *L) {
   return 0;
 }
 
-// Event system Lua bridge functions
-static int l_client_connect_signal(lua_State *L) {
-  const char *signal_name = luaL_checkstring(L, 1);
-  luaL_checktype(L, 2, LUA_TFUNCTION);
-  
-  // Map signal names to event types
-  LuaEventType event_type;
-  if (strcmp(signal_name, "map") == 0) {
-    event_type = LUA_EVENT_CLIENT_MAP;
-  } else if (strcmp(signal_name, "unmap") == 0) {
-    event_type = LUA_EVENT_CLIENT_UNMAP;
-  } else if (strcmp(signal_name, "focus") == 0) {
-    event_type = LUA_EVENT_CLIENT_FOCUS;
-  } else if (strcmp(signal_name, "unfocus") == 0) {
-    event_type = LUA_EVENT_CLIENT_UNFOCUS;
-  } else if (strcmp(signal_name, "title_change") == 0) {
-    event_type = LUA_EVENT_CLIENT_TITLE_CHANGE;
-  } else if (strcmp(signal_name, "fullscreen") == 0) {
-    event_type = LUA_EVENT_CLIENT_FULLSCREEN;
-  } else if (strcmp(signal_name, "floating") == 0) {
-    event_type = LUA_EVENT_CLIENT_FLOATING;
-  } else {
-    lua_pushstring(L, "Unknown signal name");
-    lua_error(L);
+// Some.client_set_max_fps(c, focused, unfocused): frame
+// callback caps in frames per second, 0 for none
+static int l_client_set_max_fps(lua_State *L) {
+  void *c = lua_get_safe_client(L, 1, __func__);
+  unsigned int fps[FpsLast];
+  if (!c) {
     return 0;
   }
-  
-  // Store the callback function in the registry
-  lua_pushvalue(L, 2);  // Copy the function to top of stack
-  int callback_ref = luaL_ref(L, LUA_REGISTRYINDEX);
-  
-  // Connect the callback
-  int result = lua_event_connect(event_type, callback_ref);
-  if (result < 0) {
-    luaL_unref(L, LUA_REGISTRYINDEX, callback_ref);
-    lua_pushstring(L, "Failed to connect signal - too many callbacks");
-    lua_error(L);
-    return 0;
+
+  for (int i = 0; i < FpsLast; i++) {
+    lua_Integer n = luaL_optinteger(L, i + 2, 0);
+    luaL_argcheck(L, n >= 0 && n <= 1000, i + 2, "out of range");
+    fps[i] = (unsigned int)n;
   }
-  
+  lua_client_set_max_fps(c, fps);
   return 0;
 }
 
-static int l_client_disconnect_signal(lua_State *L) {
-  const char *signal_name = luaL_checkstring(L, 1);
-  int callback_ref = luaL_checkinteger(L, 2);
-  
-  // Map signal names to event types (same as above)
-  LuaEventType event_type;
-  if (strcmp(signal_name, "map") == 0) {
-    event_type = LUA_EVENT_CLIENT_MAP;
-  } else if (strcmp(signal_name, "unmap") == 0) {
-    event_type = LUA_EVENT_CLIENT_UNMAP;
-  } else if (strcmp(signal_name, "focus") == 0) {
-    event_type = LUA_EVENT_CLIENT_FOCUS;
-  } else if (strcmp(signal_name, "unfocus") == 0) {
-    event_type = LUA_EVENT_CLIENT_UNFOCUS;
-  } else if (strcmp(signal_name, "title_change") == 0) {
-    event_type = LUA_EVENT_CLIENT_TITLE_CHANGE;
-  } else if (strcmp(signal_name, "fullscreen") == 0) {
-    event_type = LUA_EVENT_CLIENT_FULLSCREEN;
-  } else if (strcmp(signal_name, "floating") == 0) {
-    event_type = LUA_EVENT_CLIENT_FLOATING;
-  } else {
-    lua_pushstring(L, "Unknown signal name");
-    lua_error(L);
+// Some.client_get_max_fps(c) -> focused, unfocused
+static int l_client_get_max_fps(lua_State *L) {
+  void *c = lua_get_safe_client(L, 1, __func__);
+  unsigned int fps[FpsLast] = {0};
+  if (c) {
+    lua_client_get_max_fps(c, fps);
+  }
+  for (int i = 0; i < FpsLast; i++) {
+    lua_pushinteger(L, fps[i]);
+  }
+  return FpsLast;
+}
+
+// Some.client_get_commit_stats(c) -> {commits, rate, frames_held}
+static int l_client_get_commit_stats(lua_State *L) {
+  void *c = lua_get_safe_client(L, 1, __func__);
+  LuaCommitStats cs = {0};
+  if (!c) {
     return 0;
   }
-  
-  lua_event_disconnect(event_type, callback_ref);
-  return 0;
+
+  lua_get_client_commit_stats(c, &cs);
+  lua_createtable(L, 0, 3);
+  lua_pushinteger(L, (lua_Integer)cs.commits);
+  lua_setfield(L, -2, "commits");
+  lua_pushnumber(L, cs.rate);
+  lua_setfield(L, -2, "rate");
+  lua_pushinteger(L, (lua_Integer)cs.frames_held);
+  lua_setfield(L, -2, "frames_held");
+  return 1;
 }
 
 // Monitor API bridge functions
@@ -1081,6 +1299,130 @@ static int l_monitor_set_master_count(lua_State *L) {
   return 0;
 }
 
+static void pushperfstat(lua_State *L, const PerfStat *st) {
+  lua_createtable(L, 0, 5);
+  lua_pushinteger(L, (lua_Integer)st->count);
+  lua_setfield(L, -2, "count");
+  lua_pushnumber(L, st->count ? (double)st->total / 1e6 / (double)st->count
+                              : 0.0);
+  lua_setfield(L, -2, "avg_ms");
+  lua_pushnumber(L, (double)perfstat_percentile(st, 50) / 1e6);
+  lua_setfield(L, -2, "p50_ms");
+  lua_pushnumber(L, (double)perfstat_percentile(st, 99) / 1e6);
+  lua_setfield(L, -2, "p99_ms");
+  lua_pushnumber(L, (double)st->max / 1e6);
+  lua_setfield(L, -2, "max_ms");
+}
+
+// Some.client_get_responsiveness(c) -> {responsive, missed, latency =
+//   {count, avg_ms, p50_ms, p99_ms, max_ms}}
+static int l_client_get_responsiveness(lua_State *L) {
+  void *c = lua_get_safe_client(L, 1, __func__);
+  LuaPingStats ps;
+  if (!c) {
+    return 0;
+  }
+
+  lua_get_client_ping_stats(c, &ps);
+  lua_createtable(L, 0, 3);
+  lua_pushboolean(L, ps.responsive);
+  lua_setfield(L, -2, "responsive");
+  lua_pushinteger(L, (lua_Integer)ps.missed);
+  lua_setfield(L, -2, "missed");
+  pushperfstat(L, &ps.latency);
+  lua_setfield(L, -2, "latency");
+  return 1;
+}
+
+// Some.monitor_get_frame_stats(m [, reset]) -> {render, commit, interval =
+//   {count, avg_ms, p50_ms, p99_ms, max_ms}, frames, committed, idle, failed,
+//   missed, skipped = {resize, gamma}, damage_px, last_damage_px,
+//   avg_damage_px, refresh_hz, width, height, delayed, render_cost_ms,
+//   render_margin_ms, occluded}, or nil for no monitor
+static int l_monitor_get_frame_stats(lua_State *L) {
+  void *m = lua_touserdata(L, 1);
+  FrameStats fs;
+
+  if (!lua_get_monitor_frame_stats(m, &fs)) {
+    lua_pushnil(L);
+    return 1;
+  }
+  if (lua_toboolean(L, 2))
+    lua_reset_monitor_frame_stats(m);
+  lua_createtable(L, 0, 16);
+  pushperfstat(L, &fs.render);
+  lua_setfield(L, -2, "render");
+  pushperfstat(L, &fs.commit);
+  lua_setfield(L, -2, "commit");
+  pushperfstat(L, &fs.interval);
+  lua_setfield(L, -2, "interval");
+  lua_pushinteger(L, (lua_Integer)fs.frames);
+  lua_setfield(L, -2, "frames");
+  lua_pushinteger(L, (lua_Integer)fs.committed);
+  lua_setfield(L, -2, "committed");
+  lua_pushinteger(L, (lua_Integer)fs.idle);
+  lua_setfield(L, -2, "idle");
+  lua_pushinteger(L, (lua_Integer)fs.failed);
+  lua_setfield(L, -2, "failed");
+  lua_pushinteger(L, (lua_Integer)fs.missed);
+  lua_setfield(L, -2, "missed");
+  lua_createtable(L, 0, 2);
+  lua_pushinteger(L, (lua_Integer)fs.skipped_resize);
+  lua_setfield(L, -2, "resize");
+  lua_pushinteger(L, (lua_Integer)fs.skipped_gamma);
+  lua_setfield(L, -2, "gamma");
+  lua_setfield(L, -2, "skipped");
+  lua_pushinteger(L, (lua_Integer)fs.damage_px);
+  lua_setfield(L, -2, "damage_px");
+  lua_pushinteger(L, (lua_Integer)fs.last_damage_px);
+  lua_setfield(L, -2, "last_damage_px");
+  lua_pushnumber(L, fs.committed ? (double)fs.damage_px / (double)fs.committed
+                                 : 0.0);
+  lua_setfield(L, -2, "avg_damage_px");
+  lua_pushnumber(L, fs.refresh_mhz / 1000.0);
+  lua_setfield(L, -2, "refresh_hz");
+  lua_pushinteger(L, fs.width);
+  lua_setfield(L, -2, "width");
+  lua_pushinteger(L, fs.height);
+  lua_setfield(L, -2, "height");
+  lua_pushinteger(L, (lua_Integer)fs.delayed);
+  lua_setfield(L, -2, "delayed");
+  lua_pushnumber(L, (double)fs.render_cost_ns / 1e6);
+  lua_setfield(L, -2, "render_cost_ms");
+  lua_pushnumber(L, (double)fs.render_margin_ns / 1e6);
+  lua_setfield(L, -2, "render_margin_ms");
+  lua_pushinteger(L, fs.occluded);
+  lua_setfield(L, -2, "occluded");
+  return 1;
+}
+
+// Some.monitor_set_frame_overlay(m, on): the frame interval graph
+static int l_monitor_set_frame_overlay(lua_State *L) {
+  void *m = lua_touserdata(L, 1);
+  lua_set_monitor_frame_overlay(m, lua_toboolean(L, 2));
+  return 0;
+}
+
+static int l_monitor_get_frame_overlay(lua_State *L) {
+  lua_pushboolean(L, lua_get_monitor_frame_overlay(lua_touserdata(L, 1)));
+  return 1;
+}
+
+// Some.monitor_set_max_render_time(m, ms): ms before vblank, -1 for
+// adaptive, 0 to render as soon as the frame event arrives
+static int l_monitor_set_max_render_time(lua_State *L) {
+  void *m = lua_touserdata(L, 1);
+  lua_Integer ms = luaL_checkinteger(L, 2);
+  luaL_argcheck(L, ms >= -1 && ms <= 1000, 2, "out of range");
+  lua_set_monitor_max_render_time(m, (int)ms);
+  return 0;
+}
+
+static int l_monitor_get_max_render_time(lua_State *L) {
+  lua_pushinteger(L, lua_get_monitor_max_render_time(lua_touserdata(L, 1)));
+  return 1;
+}
+
 // Tag API bridge functions
 static int l_tag_get_count(lua_State *L) {
   int count = lua_get_tag_count();
@@ -1142,6 +1484,91 @@ static int l_gc_collect(lua_State *L) {
   return 0;
 }
 
+// Event loop tracing, see trace.h
+// Some.trace_start([spans]): record up to spans spans per thread
+static int l_trace_start(lua_State *L) {
+  lua_Integer spans = luaL_optinteger(L, 1, 0);
+  luaL_argcheck(L, spans >= 0, 1, "negative span count");
+  trace_start((size_t)spans);
+  return 0;
+}
+
+static int l_trace_stop(lua_State *L) {
+  trace_stop();
+  return 0;
+}
+
+static int l_trace_active(lua_State *L) {
+  lua_pushboolean(L, tracing & TRACE_RECORD);
+  return 1;
+}
+
+// Some.trace_dump([path]) -> path written, or nil and an error message
+static int l_trace_dump(lua_State *L) {
+  const char *path = luaL_optstring(L, 1, NULL);
+
+  if (!path)
+    path = trace_default_path();
+  if (trace_dump(path) < 0)
+    return luaL_fileresult(L, 0, path);
+  lua_pushstring(L, path);
+  return 1;
+}
+
+// Event loop stalls, see watchdog.h
+// Some.stall_stats() -> {threshold_ms, count, total_ms, avg_ms, p50_ms,
+//   p99_ms, max_ms, last_ms, last_culprit, buckets = {{le_ms, count}, ...}}
+static int l_stall_stats(lua_State *L) {
+  WatchdogStats st;
+  int i;
+
+  watchdog_stats(&st);
+  pushperfstat(L, &st.stat);
+  lua_pushinteger(L, st.threshold_ms);
+  lua_setfield(L, -2, "threshold_ms");
+  lua_pushnumber(L, (double)st.stat.total / 1e6);
+  lua_setfield(L, -2, "total_ms");
+  lua_pushnumber(L, (double)st.last_ns / 1e6);
+  lua_setfield(L, -2, "last_ms");
+  if (st.stat.count) {
+    lua_pushstring(L, st.last_culprit);
+    lua_setfield(L, -2, "last_culprit");
+  }
+  lua_createtable(L, WATCHDOG_BUCKETS, 0);
+  for (i = 0; i < WATCHDOG_BUCKETS; i++) {
+    lua_createtable(L, 0, 2);
+    if (i < WATCHDOG_BUCKETS - 1)
+      lua_pushinteger(L, watchdog_bucket_ms[i]);
+    else
+      lua_pushnumber(L, HUGE_VAL);
+    lua_setfield(L, -2, "le_ms");
+    lua_pushinteger(L, (lua_Integer)st.buckets[i]);
+    lua_setfield(L, -2, "count");
+    lua_rawseti(L, -2, i + 1);
+  }
+  lua_setfield(L, -2, "buckets");
+  return 1;
+}
+
+static int l_stall_reset(lua_State *L) {
+  watchdog_reset();
+  return 0;
+}
+
+// Some.stall_threshold([ms]) -> previous threshold; 0 disables detection
+static int l_stall_threshold(lua_State *L) {
+  WatchdogStats st;
+
+  watchdog_stats(&st);
+  if (!lua_isnoneornil(L, 1)) {
+    lua_Integer ms = luaL_checkinteger(L, 1);
+    luaL_argcheck(L, ms >= 0 && ms <= 60000, 1, "out of range");
+    watchdog_set_threshold((unsigned int)ms);
+  }
+  lua_pushinteger(L, st.threshold_ms);
+  return 1;
+}
+
 static const struct luaL_Reg somelib[] = {{"hello_world", l_hello_world},
                                           {"spawn", l_spawn},
                                           {"restart", l_restart},
@@ -1162,6 +1589,11 @@ static const struct luaL_Reg somelib[] = {{"hello_world", l_hello_world},
                                           {"client_get_tags", l_client_get_tags},
                                           {"client_get_floating", l_client_get_floating},
                                           {"client_get_fullscreen", l_client_get_fullscreen},
+                                          {"client_find", l_client_find},
+                                          {"client_snapshot", l_client_snapshot},
+                                          {"clients_snapshot", l_clients_snapshot},
+                                          {"client_cache", l_client_cache},
+                                          {"client_cache_stats", l_client_cache_stats},
                                           {"client_focus", l_client_focus},
                                           {"client_close", l_client_close},
                                           {"client_kill", l_client_kill},
@@ -1169,8 +1601,10 @@ static const struct luaL_Reg somelib[] = {{"hello_world", l_hello_world},
                                           {"client_set_fullscreen", l_client_set_fullscreen},
                                           {"client_set_geometry", l_client_set_geometry},
                                           {"client_set_tags", l_client_set_tags},
-                                          {"client_connect_signal", l_client_connect_signal},
-                                          {"client_disconnect_signal", l_client_disconnect_signal},
+                                          {"client_set_max_fps", l_client_set_max_fps},
+                                          {"client_get_max_fps", l_client_get_max_fps},
+                                          {"client_get_commit_stats", l_client_get_commit_stats},
+                                          {"client_get_responsiveness", l_client_get_responsiveness},
                                           // Monitor API
                                           {"monitor_get_all", l_monitor_get_all},
                                           {"monitor_get_focused", l_monitor_get_focused},
@@ -1186,6 +1620,11 @@ static const struct luaL_Reg somelib[] = {{"hello_world", l_hello_world},
                                           {"monitor_set_tags", l_monitor_set_tags},
                                           {"monitor_set_master_factor", l_monitor_set_master_factor},
                                           {"monitor_set_master_count", l_monitor_set_master_count},
+                                          {"monitor_get_frame_stats", l_monitor_get_frame_stats},
+                                          {"monitor_set_frame_overlay", l_monitor_set_frame_overlay},
+                                          {"monitor_get_frame_overlay", l_monitor_get_frame_overlay},
+                                          {"monitor_set_max_render_time", l_monitor_set_max_render_time},
+                                          {"monitor_get_max_render_time", l_monitor_get_max_render_time},
                                           // Tag API
                                           {"tag_get_count", l_tag_get_count},
                                           {"tag_get_current", l_tag_get_current},
@@ -1198,10 +1637,37 @@ static const struct luaL_Reg somelib[] = {{"hello_world", l_hello_world},
                                           {"client_refs_get_count", l_client_refs_get_count},
                                           {"client_refs_get_total_refs", l_client_refs_get_total_refs},
                                           {"gc_collect", l_gc_collect},
+                                          // Tracing
+                                          {"trace_start", l_trace_start},
+                                          {"trace_stop", l_trace_stop},
+                                          {"trace_active", l_trace_active},
+                                          {"trace_dump", l_trace_dump},
+                                          {"stall_stats", l_stall_stats},
+                                          {"stall_reset", l_stall_reset},
+                                          {"stall_threshold", l_stall_threshold},
                                           {NULL, NULL}};
 
 static int luaopen_some(lua_State *lua) {
   luaL_newlib(L, somelib);
+  luasignal_register(L);
+  luaobject_register(L);
+  // Bits of the "dirty" field of Some.client_cache() tables
+  lua_createtable(L, 0, 7);
+  lua_pushinteger(L, ClientPropTitle);
+  lua_setfield(L, -2, "title");
+  lua_pushinteger(L, ClientPropAppid);
+  lua_setfield(L, -2, "appid");
+  lua_pushinteger(L, ClientPropGeometry);
+  lua_setfield(L, -2, "geometry");
+  lua_pushinteger(L, ClientPropTags);
+  lua_setfield(L, -2, "tags");
+  lua_pushinteger(L, ClientPropFloating);
+  lua_setfield(L, -2, "floating");
+  lua_pushinteger(L, ClientPropFullscreen);
+  lua_setfield(L, -2, "fullscreen");
+  lua_pushinteger(L, ClientPropAll);
+  lua_setfield(L, -2, "all");
+  lua_setfield(L, -2, "client_props");
   return 1;
 }
 
@@ -1261,7 +1727,7 @@ int get_config_bool(const char *key, int default_value) {
 void cleanup_lua(void) {
   if (L != NULL) {
     // Cleanup systems before closing Lua state
-    lua_event_cleanup();
+    luasignal_cleanup();
     lua_client_refs_cleanup();
     lua_close(L);
     L = NULL;
@@ -1345,7 +1811,7 @@ size_t num_lua_keys = 0;
 
 // Forward declarations will be added when needed
 
-void init_lua(void) {
+int init_lua_env(void) {
   const char *lua_path = "./lua/?.lua;./lua/?/init.lua;";
   if (L != NULL) {
     lua_close(L);
@@ -1355,20 +1821,20 @@ void init_lua(void) {
   L = luaL_newstate();
   if (L == NULL) {
     fprintf(stderr, "Failed to create Lua state\n");
-    return;
+    return -1;
   }
 
   luaL_openlibs(L);
   
   // Initialize systems
   lua_client_refs_init();
-  lua_event_init();
+  luasignal_init();
 
   if (set_lua_path(L, lua_path)) {
     fprintf(stderr, "Failed to set lua path, exiting\n");
     lua_close(L);
     L = NULL;
-    return;
+    return -1;
   }
 
   register_libraries(L);
@@ -1379,7 +1845,13 @@ void init_lua(void) {
   lua_setglobal(L, "register_key_binding");
   lua_pushcfunction(L, l_get_keysym);
   lua_setglobal(L, "get_keysym_native");
-  
+  return 0;
+}
+
+void init_lua(void) {
+  if (init_lua_env())
+    return;
+
   // Widget initialization happens on demand
 
   fprintf(stderr, "Loading rc.lua...\n");
@@ -8,6 +8,8 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "include/common.h"
+#include "clientindex.h"
+#include "perfstat.h"
 
 // StackInsertMode is now defined in include/common.h
 
@@ -26,6 +28,9 @@ extern lua_State *L;
 int get_config_bool(const char *key, int default_value);
 
 void init_lua(void);
+// Everything init_lua() does except loading rc.lua: creates L with the Some
+// library and ./lua on the module path. Returns 0, or -1 with L left NULL.
+int init_lua_env(void);
 void cleanup_lua(void);
 
 // Add to existing get_config functions
@@ -43,6 +48,24 @@ uint32_t lua_get_client_tags(void *c);
 int lua_get_client_floating(void *c);
 int lua_get_client_fullscreen(void *c);
 void *lua_get_client_by_index(int index);
+// Iterate clients in list order: NULL gives the first client, NULL ends
+void *lua_get_next_client(void *prev);
+
+// Everything the Lua client properties expose, filled in one call
+typedef struct {
+    const char *title;
+    const char *appid;
+    int pid;              // <= 0 if unknown
+    int x, y, width, height;
+    uint32_t tags;
+    int floating, fullscreen, urgent;
+    int visible;          // on the selected tags of its monitor
+    void *monitor;
+} LuaClientSnapshot;
+void lua_get_client_snapshot(void *c, LuaClientSnapshot *out);
+// Clients matching q, answered from the indexes kept by dwl.c; see
+// clientindex_find()
+size_t lua_find_clients(const ClientQuery *q, void **out, size_t max);
 
 // Client manipulation wrapper functions (implemented in dwl.c)
 void lua_client_focus(void *c);
@@ -53,6 +76,31 @@ void lua_client_set_fullscreen(void *c, int fullscreen);
 void lua_client_set_geometry(void *c, int x, int y, int w, int h);
 void lua_client_set_tags(void *c, uint32_t tags);
 
+// Frame callback caps of a client, in frames per second (0 for none), for
+// when it is focused and when it is visible but unfocused. Hidden and
+// covered clients get no frame callbacks at all, so they need no cap. Caps
+// are kept while a client is unmapped and apply again when it is mapped.
+enum { FpsFocused, FpsUnfocused, FpsLast };
+void lua_client_set_max_fps(void *c, const unsigned int fps[FpsLast]);
+void lua_client_get_max_fps(void *c, unsigned int fps[FpsLast]);
+// Surface commits of a client since it was mapped, the commit rate over
+// the last second, and the frame callbacks held back by its max_fps.
+// Only Wayland clients are counted.
+typedef struct {
+    uint64_t commits, frames_held;
+    double rate;
+} LuaCommitStats;
+void lua_get_client_commit_stats(void *c, LuaCommitStats *out);
+// Answers to the xdg_wm_base (or _NET_WM_PING) pings sent every
+// pinginterval while the client is visible; a client is unresponsive while
+// a ping goes unanswered for longer than pingtimeout
+typedef struct {
+    int responsive;
+    uint64_t missed;      // pings that timed out entirely
+    PerfStat latency;     // ping to pong
+} LuaPingStats;
+void lua_get_client_ping_stats(void *c, LuaPingStats *out);
+
 // Monitor wrapper functions (implemented in dwl.c)
 int lua_get_monitor_count(void);
 void *lua_get_focused_monitor(void);
@@ -70,6 +118,41 @@ void lua_set_monitor_tags(void *monitor, uint32_t tags);
 void lua_set_monitor_master_factor(void *monitor, float factor);
 void lua_set_monitor_master_count(void *monitor, int count);
 
+// Frame timing of a monitor, kept by rendermon() since the last reset. A
+// frame event either commits a new frame, finds nothing changed (idle) or
+// is skipped; "interval" runs from one committed frame's event to the next
+// event, so it measures how steadily the output is kept busy.
+typedef struct {
+    PerfStat render;          // all of rendermon()
+    PerfStat commit;          // building and committing a new frame
+    PerfStat interval;
+    uint64_t frames;          // frame events
+    uint64_t committed, idle, failed;
+    uint64_t missed;          // intervals over 1.5 refresh periods
+    uint64_t skipped_resize;  // a tiled client had a resize outstanding
+    uint64_t skipped_gamma;   // only a gamma change was committed
+    uint64_t damage_px;       // damaged pixels, summed over the commits
+    uint64_t last_damage_px;
+    uint64_t last_frame;      // perf_now() of the last committed frame's event
+    uint64_t delayed;         // frames rendered late, for max_render_time
+    uint64_t render_cost_ns;  // what rendering late budgets for: the cost
+    uint64_t render_margin_ns;  // and the margin on top of it
+    int refresh_mhz;          // 0 if the output has no fixed refresh rate
+    int width, height;        // of the output's buffers
+    int occluded;             // clients on visible tags covered entirely,
+                              // as of the last frame
+} FrameStats;
+// returns 0 and leaves out alone if monitor is NULL
+int lua_get_monitor_frame_stats(void *monitor, FrameStats *out);
+void lua_reset_monitor_frame_stats(void *monitor);
+// a graph of the recent frame intervals in the monitor's corner
+void lua_set_monitor_frame_overlay(void *monitor, int on);
+int lua_get_monitor_frame_overlay(void *monitor);
+// render ms before the next vblank rather than right after the last one;
+// -1 budgets the measured render time plus an adaptive margin, 0 is off
+void lua_set_monitor_max_render_time(void *monitor, int ms);
+int lua_get_monitor_max_render_time(void *monitor);
+
 // Tag wrapper functions (implemented in dwl.c)
 int lua_get_tag_count(void);
 uint32_t lua_get_current_tags(void);
@@ -80,17 +163,20 @@ uint32_t lua_get_occupied_tags(void);
 uint32_t lua_get_monitor_occupied_tags(void *monitor);
 uint32_t lua_get_urgent_tags(void);
 
-// Event system types and functions
-typedef enum {
-    LUA_EVENT_CLIENT_MAP = 0,
-    LUA_EVENT_CLIENT_UNMAP,
-    LUA_EVENT_CLIENT_FOCUS,
-    LUA_EVENT_CLIENT_UNFOCUS,
-    LUA_EVENT_CLIENT_TITLE_CHANGE,
-    LUA_EVENT_CLIENT_FULLSCREEN,
-    LUA_EVENT_CLIENT_FLOATING,
-    LUA_EVENT_COUNT  // Must be last
-} LuaEventType;
+// Client properties cached by core.client. dwl.c reports every change with
+// lua_client_invalidate(); the bits are ORed into the "dirty" field of the
+// client's cache table (see Some.client_cache), so Lua only crosses into C
+// to refresh a property after it changed.
+enum {
+    ClientPropTitle = 1 << 0,
+    ClientPropAppid = 1 << 1,
+    ClientPropGeometry = 1 << 2,
+    ClientPropTags = 1 << 3,
+    ClientPropFloating = 1 << 4,
+    ClientPropFullscreen = 1 << 5,
+    ClientPropAll = (1 << 6) - 1
+};
+void lua_client_invalidate(void *c, unsigned int props);
 
 // Client reference tracking for memory safety
 typedef struct ClientRef {
@@ -129,13 +215,6 @@ typedef struct {
 void lua_push_client_userdata(lua_State *L, void *client_ptr);
 void *lua_check_client_userdata(lua_State *L, int index);
 
-// Event callback management
-void lua_event_init(void);
-void lua_event_cleanup(void);
-int lua_event_connect(LuaEventType event_type, int callback_ref);
-void lua_event_disconnect(LuaEventType event_type, int callback_ref);
-void lua_event_emit(LuaEventType event_type, void *client, void *data);
-
 // Layer surface wrapper functions (implemented in dwl.c)
 void *lua_create_layer_surface(int width, int height, int layer, int exclusive_zone, uint32_t anchor);
 void lua_destroy_layer_surface(void *layer_surface);
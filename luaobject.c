@@ -0,0 +1,419 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdio.h>
+
+#include <lauxlib.h>
+#include <lua.h>
+
+#include "luaobject.h"
+
+/* upvalues of the __index and __newindex closures */
+#define ACC lua_upvalueindex(1)
+#define PROPMT lua_upvalueindex(2)
+#define NAMES lua_upvalueindex(3)
+
+/* user values of an object */
+enum { PrivateValue = 1, SignalsValue };
+
+/* registry keys */
+static const char propkey, nameskey;
+
+static int makeclass(lua_State *l, int acc);
+
+/* Push acc[key]; returns 1 and leaves the property record if it is one */
+static int getacc(lua_State *l, int acc, int key, int propmt) {
+  int isprop;
+
+  if (lua_pushvalue(l, key), lua_rawget(l, acc) != LUA_TTABLE)
+    return 0;
+  if (!lua_getmetatable(l, -1))
+    return 0;
+  isprop = lua_rawequal(l, -1, propmt);
+  lua_pop(l, 1);
+  return isprop;
+}
+
+static int isobject(lua_State *l, int idx) {
+  int ok;
+
+  if (lua_type(l, idx) != LUA_TUSERDATA || !lua_getmetatable(l, idx))
+    return 0;
+  ok = lua_getfield(l, -1, "__acc") == LUA_TTABLE;
+  lua_pop(l, 2);
+  return ok;
+}
+
+static void checkobject(lua_State *l, int idx) {
+  if (!isobject(l, idx))
+    luaL_typeerror(l, idx, "object");
+}
+
+/* Call every callback connected to the signal named at index name on the
+ * object at index self with the nargs values starting at index base.
+ * Callbacks disconnected during the emission are skipped. */
+static int emit(lua_State *l, int self, int name, int base, int nargs) {
+  int i, j, n, ok = 0;
+
+  if (lua_getiuservalue(l, self, SignalsValue) != LUA_TTABLE) {
+    lua_pop(l, 1);
+    return 0;
+  }
+  if (lua_pushvalue(l, name), lua_rawget(l, -2) != LUA_TTABLE) {
+    lua_pop(l, 2);
+    return 0;
+  }
+  luaL_checkstack(l, nargs + 2, NULL);
+  n = (int)lua_rawlen(l, -1);
+  for (i = 1; i <= n; i++) {
+    if (lua_rawgeti(l, -1, i) != LUA_TFUNCTION) {
+      lua_pop(l, 1);
+      continue;
+    }
+    lua_pushvalue(l, self);
+    for (j = 0; j < nargs; j++)
+      lua_pushvalue(l, base + j);
+    if (lua_pcall(l, nargs + 1, 0, 0) != LUA_OK) {
+      fprintf(stderr, "Error in signal callback for %s: %s\n",
+              lua_tostring(l, name), lua_tostring(l, -1));
+      lua_pop(l, 1);
+    } else {
+      ok++;
+    }
+  }
+  lua_pop(l, 2);
+  return ok;
+}
+
+/* Emit "property::<key>" with the new and old value at top - 1 and top, but
+ * only build the name if the object has callbacks at all */
+static void emitchange(lua_State *l, int self, int key, int names) {
+  int top = lua_gettop(l);
+
+  if (lua_type(l, key) != LUA_TSTRING)
+    return;
+  if (lua_getiuservalue(l, self, SignalsValue) != LUA_TTABLE) {
+    lua_pop(l, 1);
+    return;
+  }
+  lua_pop(l, 1);
+  if (lua_pushvalue(l, key), lua_rawget(l, names) != LUA_TSTRING) {
+    lua_pop(l, 1);
+    lua_pushfstring(l, "property::%s", lua_tostring(l, key));
+    lua_pushvalue(l, key);
+    lua_pushvalue(l, -2);
+    lua_rawset(l, names);
+  }
+  emit(l, self, top + 1, top - 1, 2);
+  lua_settop(l, top);
+}
+
+/* Give the object at index self a class of its own, copied from its current
+ * one, and push that class's accessor table */
+static void ownclass(lua_State *l, int self) {
+  int mt, acc;
+
+  lua_getmetatable(l, self);
+  mt = lua_gettop(l);
+  lua_getfield(l, mt, "__acc");
+  if (lua_getfield(l, mt, "__owner"), lua_rawequal(l, -1, self)) {
+    lua_pop(l, 1);
+    lua_replace(l, mt);
+    return;
+  }
+  lua_pop(l, 1);
+  lua_newtable(l);
+  acc = lua_gettop(l);
+  lua_pushnil(l);
+  while (lua_next(l, acc - 1)) {
+    lua_pushvalue(l, -2);
+    lua_insert(l, -2);
+    lua_rawset(l, acc);
+  }
+  makeclass(l, acc);
+  lua_pushvalue(l, self);
+  lua_setfield(l, -2, "__owner");
+  lua_setmetatable(l, self);
+  lua_replace(l, mt);
+  lua_settop(l, mt);
+}
+
+static int objindex(lua_State *l) {
+  if (getacc(l, ACC, 2, PROPMT)) {
+    if (lua_rawgeti(l, -1, 1) != LUA_TNIL) {
+      lua_pushvalue(l, 1);
+      lua_call(l, 1, 1);
+      return 1;
+    }
+  } else if (!lua_isnil(l, -1)) {
+    return 1;
+  }
+  lua_getiuservalue(l, 1, PrivateValue);
+  lua_pushvalue(l, 2);
+  lua_rawget(l, -2);
+  return 1;
+}
+
+static int objnewindex(lua_State *l) {
+  if (getacc(l, ACC, 2, PROPMT)) {
+    if (lua_rawgeti(l, -1, 2) != LUA_TNIL) {
+      lua_pushvalue(l, 1);
+      lua_pushvalue(l, 3);
+      lua_call(l, 2, 0);
+      return 0;
+    }
+  } else if (!lua_isnil(l, -1)) {
+    /* overriding a method: only for this object */
+    lua_settop(l, 3);
+    ownclass(l, 1);
+    lua_pushvalue(l, 2);
+    lua_pushvalue(l, 3);
+    lua_rawset(l, -3);
+    return 0;
+  }
+  lua_settop(l, 3);
+  lua_getiuservalue(l, 1, PrivateValue);
+  lua_pushvalue(l, 2);
+  lua_rawget(l, 4);
+  lua_pushvalue(l, 2);
+  lua_pushvalue(l, 3);
+  lua_rawset(l, 4);
+  if (!lua_rawequal(l, 3, 5)) {
+    lua_pushvalue(l, 3);
+    lua_pushvalue(l, 5);
+    emitchange(l, 1, 2, NAMES);
+  }
+  return 0;
+}
+
+/* connect_signal(name, fn) */
+static int l_connect_signal(lua_State *l) {
+  checkobject(l, 1);
+  luaL_checkany(l, 2);
+  if (lua_type(l, 3) != LUA_TFUNCTION)
+    return luaL_error(l, "Callback must be a function");
+  if (lua_getiuservalue(l, 1, SignalsValue) != LUA_TTABLE) {
+    lua_pop(l, 1);
+    lua_newtable(l);
+    lua_pushvalue(l, -1);
+    lua_setiuservalue(l, 1, SignalsValue);
+  }
+  if (lua_pushvalue(l, 2), lua_rawget(l, -2) != LUA_TTABLE) {
+    lua_pop(l, 1);
+    lua_newtable(l);
+    lua_pushvalue(l, 2);
+    lua_pushvalue(l, -2);
+    lua_rawset(l, -4);
+  }
+  lua_pushvalue(l, 3);
+  lua_rawseti(l, -2, (lua_Integer)lua_rawlen(l, -2) + 1);
+  return 0;
+}
+
+/* disconnect_signal(name, fn); the callbacks after fn move down */
+static int l_disconnect_signal(lua_State *l) {
+  lua_Integer i, n;
+  int found = 0;
+
+  checkobject(l, 1);
+  lua_settop(l, 3);
+  if (lua_getiuservalue(l, 1, SignalsValue) != LUA_TTABLE)
+    return 0;
+  if (lua_pushvalue(l, 2), lua_rawget(l, 4) != LUA_TTABLE)
+    return 0;
+  n = (lua_Integer)lua_rawlen(l, 5);
+  for (i = 1; i <= n; i++) {
+    lua_rawgeti(l, 5, i);
+    if (found) {
+      lua_rawseti(l, 5, i - 1);
+      continue;
+    }
+    found = lua_rawequal(l, -1, 3);
+    lua_pop(l, 1);
+  }
+  if (found) {
+    lua_pushnil(l);
+    lua_rawseti(l, 5, n);
+  }
+  return 0;
+}
+
+/* emit_signal(name, ...); returns the number of callbacks that ran */
+static int l_emit_signal(lua_State *l) {
+  checkobject(l, 1);
+  luaL_checkany(l, 2);
+  lua_pushinteger(l, emit(l, 1, 2, 3, lua_gettop(l) - 2));
+  return 1;
+}
+
+/* add_property(name, {getter = fn, setter = fn}) for this object only */
+static int l_add_property(lua_State *l) {
+  checkobject(l, 1);
+  luaL_checkany(l, 2);
+  lua_settop(l, 3);
+  ownclass(l, 1);
+  lua_pushvalue(l, 2);
+  lua_createtable(l, 2, 0);
+  if (lua_istable(l, 3)) {
+    lua_getfield(l, 3, "getter");
+    lua_rawseti(l, -2, 1);
+    lua_getfield(l, 3, "setter");
+    lua_rawseti(l, -2, 2);
+  }
+  lua_rawgetp(l, LUA_REGISTRYINDEX, &propkey);
+  lua_setmetatable(l, -2);
+  lua_rawset(l, 4);
+  return 0;
+}
+
+static int l_get_private(lua_State *l) {
+  checkobject(l, 1);
+  lua_getiuservalue(l, 1, PrivateValue);
+  return 1;
+}
+
+/* set_private(key, value) stores without emitting anything */
+static int l_set_private(lua_State *l) {
+  checkobject(l, 1);
+  luaL_checkany(l, 2);
+  lua_settop(l, 3);
+  lua_getiuservalue(l, 1, PrivateValue);
+  lua_insert(l, 2);
+  lua_rawset(l, 2);
+  return 0;
+}
+
+static int l_has_signal(lua_State *l) {
+  checkobject(l, 1);
+  luaL_checkany(l, 2);
+  if (lua_getiuservalue(l, 1, SignalsValue) == LUA_TTABLE &&
+      (lua_pushvalue(l, 2), lua_rawget(l, -2) == LUA_TTABLE))
+    lua_pushboolean(l, lua_rawlen(l, -1) > 0);
+  else
+    lua_pushboolean(l, 0);
+  return 1;
+}
+
+/* table of signal name -> number of callbacks */
+static int l_get_signals(lua_State *l) {
+  checkobject(l, 1);
+  lua_settop(l, 1);
+  lua_newtable(l);
+  if (lua_getiuservalue(l, 1, SignalsValue) != LUA_TTABLE) {
+    lua_pop(l, 1);
+    return 1;
+  }
+  lua_pushnil(l);
+  while (lua_next(l, 3)) {
+    if (lua_istable(l, -1) && lua_rawlen(l, -1) > 0) {
+      lua_pushvalue(l, -2);
+      lua_pushinteger(l, (lua_Integer)lua_rawlen(l, -2));
+      lua_rawset(l, 2);
+    }
+    lua_pop(l, 1);
+  }
+  lua_pop(l, 1);
+  return 1;
+}
+
+/* drop every callback and the private data */
+static int l_destroy(lua_State *l) {
+  checkobject(l, 1);
+  lua_pushnil(l);
+  lua_setiuservalue(l, 1, SignalsValue);
+  lua_newtable(l);
+  lua_setiuservalue(l, 1, PrivateValue);
+  return 0;
+}
+
+static const luaL_Reg methods[] = {
+    {"connect_signal", l_connect_signal},
+    {"disconnect_signal", l_disconnect_signal},
+    {"emit_signal", l_emit_signal},
+    {"add_property", l_add_property},
+    {"get_private", l_get_private},
+    {"set_private", l_set_private},
+    {"has_signal", l_has_signal},
+    {"get_signals", l_get_signals},
+    {"destroy", l_destroy},
+    {NULL, NULL},
+};
+
+/* Push a new class metatable over the accessor table at index acc, adding
+ * the methods above where acc does not override them */
+static int makeclass(lua_State *l, int acc) {
+  const luaL_Reg *r;
+
+  acc = lua_absindex(l, acc);
+  for (r = methods; r->name; r++) {
+    if (lua_getfield(l, acc, r->name) == LUA_TNIL) {
+      lua_pushcfunction(l, r->func);
+      lua_setfield(l, acc, r->name);
+    }
+    lua_pop(l, 1);
+  }
+  lua_createtable(l, 0, 4);
+  lua_pushvalue(l, acc);
+  lua_rawgetp(l, LUA_REGISTRYINDEX, &propkey);
+  lua_rawgetp(l, LUA_REGISTRYINDEX, &nameskey);
+  lua_pushvalue(l, -3);
+  lua_pushvalue(l, -3);
+  lua_pushvalue(l, -3);
+  lua_pushcclosure(l, objindex, 3);
+  lua_setfield(l, -5, "__index");
+  lua_pushcclosure(l, objnewindex, 3);
+  lua_setfield(l, -2, "__newindex");
+  lua_pushvalue(l, acc);
+  lua_setfield(l, -2, "__acc");
+  lua_pushliteral(l, "object");
+  lua_setfield(l, -2, "__name");
+  return 1;
+}
+
+/* Some.object_class(acc) -> metatable for objects of the class */
+static int l_object_class(lua_State *l) {
+  luaL_checktype(l, 1, LUA_TTABLE);
+  return makeclass(l, 1);
+}
+
+/* Some.object_new(class) -> object with an empty private table */
+static int l_object_new(lua_State *l) {
+  luaL_checktype(l, 1, LUA_TTABLE);
+  lua_newuserdatauv(l, 0, 2);
+  lua_newtable(l);
+  lua_setiuservalue(l, -2, PrivateValue);
+  lua_pushvalue(l, 1);
+  lua_setmetatable(l, -2);
+  return 1;
+}
+
+/* Some.object_property(getter, setter) -> accessor table entry */
+static int l_object_property(lua_State *l) {
+  lua_settop(l, 2);
+  lua_createtable(l, 2, 0);
+  lua_insert(l, 1);
+  lua_rawseti(l, 1, 2);
+  lua_rawseti(l, 1, 1);
+  lua_rawgetp(l, LUA_REGISTRYINDEX, &propkey);
+  lua_setmetatable(l, 1);
+  return 1;
+}
+
+static int l_object_is(lua_State *l) {
+  lua_pushboolean(l, isobject(l, 1));
+  return 1;
+}
+
+static const luaL_Reg objectlib[] = {
+    {"object_class", l_object_class},
+    {"object_new", l_object_new},
+    {"object_property", l_object_property},
+    {"object_is", l_object_is},
+    {NULL, NULL},
+};
+
+void luaobject_register(lua_State *l) {
+  lua_newtable(l);
+  lua_rawsetp(l, LUA_REGISTRYINDEX, &propkey);
+  lua_newtable(l);
+  lua_rawsetp(l, LUA_REGISTRYINDEX, &nameskey);
+  luaL_setfuncs(l, objectlib, 0);
+}
@@ -0,0 +1,30 @@
+/*
+ * Objects with properties and per-object signals, backing base.object.
+ *
+ * An object is a userdata whose metatable belongs to its class.  Every class
+ * has one accessor table mapping a key either to a property record (getter
+ * and setter) or to a plain value such as a method; the class's __index and
+ * __newindex are C closures over that table, so reading a property or
+ * looking up a method is a single raw table lookup plus, for properties,
+ * the getter call.  Keys the class does not know live in the object's
+ * private table (its first user value).
+ *
+ * Assigning a key without a setter stores it in the private table and emits
+ * "property::<key>" with the new and old value if it changed.  The signal
+ * names are built once per key and cached, and nothing is built or called
+ * unless the object has callbacks for that name.  Per-object callbacks live
+ * in the object's second user value, created on the first connect_signal().
+ *
+ * Adding a property to, or overriding a method of, a single object gives it a
+ * private copy of its class first, so other objects of the class are not
+ * affected.
+ */
+#ifndef LUAOBJECT_H
+#define LUAOBJECT_H
+
+#include <lua.h>
+
+/* add the Some.object_* functions to the table at the top of the stack */
+void luaobject_register(lua_State *l);
+
+#endif
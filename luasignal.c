@@ -0,0 +1,636 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "luaa.h"
+#include "luasignal.h"
+#include "trace.h"
+#include "util.h"
+
+typedef struct {
+  char *name;
+  int *refs; /* registry refs; LUA_NOREF once disconnected mid-emission */
+  int n, cap;
+  int emitting; /* depth of emissions in progress */
+  int holes;    /* LUA_NOREF entries, compacted when emitting drops to 0 */
+} Signal;
+
+static const char *const builtins[SigBuiltinLast] = {
+    [SigClientMap] = "client::map",
+    [SigClientUnmap] = "client::unmap",
+    [SigClientDestroy] = "client::destroy",
+    [SigClientFocus] = "client::focus",
+    [SigClientUnfocus] = "client::unfocus",
+    [SigClientTitle] = "client::title_change",
+    [SigClientFullscreen] = "client::fullscreen",
+    [SigClientFloating] = "client::floating",
+    [SigClientGeometry] = "client::geometry",
+    [SigClientUnresponsive] = "client::unresponsive",
+    [SigMonitorAdded] = "monitor::added",
+    [SigMonitorRemoved] = "monitor::removed",
+    [SigMonitorGeometry] = "monitor::geometry",
+    [SigMonitorLayout] = "monitor::layout",
+    [SigTagView] = "tag::view_changed",
+};
+
+/* A queued emission in deferred mode; strings in args are owned copies */
+#define MAXARGS 3
+typedef struct {
+  int id; /* -1 once merged away */
+  int nargs;
+  SigArg args[MAXARGS];
+} Pending;
+
+#define BIT(id) (1u << (id))
+/* signals whose payload is (object, old, new) and that merge per object */
+#define MERGED                                                                 \
+  (BIT(SigClientGeometry) | BIT(SigMonitorGeometry) | BIT(SigMonitorLayout) |  \
+   BIT(SigTagView))
+
+static Signal *sigs;
+static int nsigs, sigcap;
+static int *slots; /* open addressing over sigs: id + 1, 0 if empty */
+static size_t nslots;
+static SignalObserver observer;
+
+static Pending *queue; /* ring buffer of qcap entries */
+static size_t qhead, qlen, qcap;
+static struct wl_event_loop *loop;
+static struct wl_event_source *idle;
+static int deferred;
+static struct {
+  unsigned long queued, merged, delivered;
+} qstats;
+
+static void *erealloc(void *p, size_t size) {
+  if (!(p = realloc(p, size)))
+    die("realloc:");
+  return p;
+}
+
+static uint32_t hashstr(const char *s) {
+  uint32_t h = 2166136261u;
+
+  for (; *s; s++)
+    h = (h ^ (unsigned char)*s) * 16777619u;
+  return h;
+}
+
+static int *slotof(const char *name) {
+  size_t i = hashstr(name) & (nslots - 1);
+
+  while (slots[i] && strcmp(sigs[slots[i] - 1].name, name))
+    i = (i + 1) & (nslots - 1);
+  return &slots[i];
+}
+
+static void rehash(size_t n) {
+  int id;
+
+  free(slots);
+  nslots = n;
+  slots = ecalloc(nslots, sizeof(*slots));
+  for (id = 0; id < nsigs; id++)
+    *slotof(sigs[id].name) = id + 1;
+}
+
+static int intern(const char *name) {
+  int *slot = slotof(name);
+  Signal *s;
+
+  if (*slot)
+    return *slot - 1;
+  if (nsigs == sigcap) {
+    sigcap = sigcap ? 2 * sigcap : 32;
+    sigs = erealloc(sigs, sigcap * sizeof(*sigs));
+  }
+  s = &sigs[nsigs];
+  memset(s, 0, sizeof(*s));
+  if (!(s->name = strdup(name)))
+    die("strdup:");
+  *slot = ++nsigs;
+  if (2 * (size_t)nsigs > nslots)
+    rehash(2 * nslots);
+  return nsigs - 1;
+}
+
+void luasignal_init(void) {
+  int id;
+
+  if (nslots)
+    return;
+  rehash(64);
+  for (id = 0; id < SigBuiltinLast; id++)
+    intern(builtins[id]);
+}
+
+int luasignal_intern(const char *name) {
+  if (!name)
+    return -1;
+  luasignal_init();
+  return intern(name);
+}
+
+const char *luasignal_name(int id) {
+  luasignal_init();
+  return id >= 0 && id < nsigs ? sigs[id].name : NULL;
+}
+
+int luasignal_connected(int id) {
+  return id >= 0 && id < nsigs && sigs[id].n > sigs[id].holes;
+}
+
+void luasignal_set_observer(SignalObserver o) {
+  observer = o;
+}
+
+static void compact(Signal *s) {
+  int i, j;
+
+  for (i = j = 0; i < s->n; i++)
+    if (s->refs[i] != LUA_NOREF)
+      s->refs[j++] = s->refs[i];
+  s->n = j;
+  s->holes = 0;
+}
+
+static void dropref(Signal *s, int i) {
+  if (L)
+    luaL_unref(L, LUA_REGISTRYINDEX, s->refs[i]);
+  if (s->emitting) {
+    s->refs[i] = LUA_NOREF;
+    s->holes++;
+  } else {
+    memmove(&s->refs[i], &s->refs[i + 1], (s->n - i - 1) * sizeof(int));
+    s->n--;
+  }
+}
+
+static void dropall(Signal *s) {
+  int i;
+
+  for (i = s->n - 1; i >= 0; i--)
+    if (s->refs[i] != LUA_NOREF)
+      dropref(s, i);
+}
+
+static void freeargs(Pending *e) {
+  int i;
+
+  for (i = 0; i < e->nargs; i++)
+    if (e->args[i].type == SigString)
+      free((char *)e->args[i].v.s);
+  e->nargs = 0;
+}
+
+static void dropqueue(void) {
+  for (; qlen; qlen--, qhead = (qhead + 1) & (qcap - 1))
+    freeargs(&queue[qhead]);
+  if (idle)
+    wl_event_source_remove(idle);
+  idle = NULL;
+}
+
+void luasignal_cleanup(void) {
+  int id;
+
+  dropqueue();
+
+  for (id = 0; id < nsigs; id++) {
+    dropall(&sigs[id]);
+    if (!sigs[id].emitting) {
+      free(sigs[id].refs);
+      sigs[id].refs = NULL;
+      sigs[id].cap = 0;
+    }
+  }
+}
+
+/* Call every callback of id with the nargs values starting at stack index
+ * base; returns the number of callbacks that did not raise an error */
+static int dispatch(int id, int base, int nargs) {
+  TRACE_SCOPE(sigs[id].name);
+  Signal *s;
+  int i, j, n = sigs[id].n, ok = 0, rc;
+
+  if (!lua_checkstack(L, nargs + 1))
+    return 0;
+  sigs[id].emitting++;
+  /* sigs and refs may move if a callback interns or connects */
+  for (i = 0; i < n; i++) {
+    if (sigs[id].refs[i] == LUA_NOREF)
+      continue;
+    lua_rawgeti(L, LUA_REGISTRYINDEX, sigs[id].refs[i]);
+    for (j = 0; j < nargs; j++)
+      lua_pushvalue(L, base + j);
+    TRACE_BEGIN("lua_callback");
+    rc = lua_pcall(L, nargs, 0, 0);
+    TRACE_END();
+    if (rc != LUA_OK) {
+      fprintf(stderr, "Error in signal callback for %s: %s\n", sigs[id].name,
+              lua_tostring(L, -1));
+      lua_pop(L, 1);
+    } else {
+      ok++;
+    }
+  }
+  s = &sigs[id];
+  if (!--s->emitting && s->holes)
+    compact(s);
+  return ok;
+}
+
+static void pusharg(lua_State *l, const SigArg *a) {
+  switch (a->type) {
+  case SigBool:
+    lua_pushboolean(l, a->v.b);
+    break;
+  case SigInt:
+    lua_pushinteger(l, a->v.i);
+    break;
+  case SigString:
+    if (a->v.s)
+      lua_pushstring(l, a->v.s);
+    else
+      lua_pushnil(l);
+    break;
+  case SigClient:
+    if (a->v.p)
+      lua_push_client_userdata(l, a->v.p);
+    else
+      lua_pushnil(l);
+    break;
+  case SigMonitor:
+    if (a->v.p)
+      lua_pushlightuserdata(l, a->v.p);
+    else
+      lua_pushnil(l);
+    break;
+  case SigBox:
+    lua_createtable(l, 0, 4);
+    lua_pushinteger(l, a->v.box.x);
+    lua_setfield(l, -2, "x");
+    lua_pushinteger(l, a->v.box.y);
+    lua_setfield(l, -2, "y");
+    lua_pushinteger(l, a->v.box.width);
+    lua_setfield(l, -2, "width");
+    lua_pushinteger(l, a->v.box.height);
+    lua_setfield(l, -2, "height");
+    break;
+  default:
+    lua_pushnil(l);
+    break;
+  }
+}
+
+static void deliver(int id, const SigArg *args, int nargs) {
+  int base, i;
+
+  if (!luasignal_connected(id) || !lua_checkstack(L, nargs))
+    return;
+  base = lua_gettop(L) + 1;
+  for (i = 0; i < nargs; i++)
+    pusharg(L, &args[i]);
+  dispatch(id, base, nargs);
+  lua_settop(L, base - 1);
+}
+
+/* Deliver at most n queued signals; those queued meanwhile wait for the
+ * next drain unless n is the whole queue */
+static void drain(size_t n) {
+  Pending e;
+
+  while (n-- && qlen) {
+    e = queue[qhead];
+    qhead = (qhead + 1) & (qcap - 1);
+    qlen--;
+    if (e.id >= 0) {
+      qstats.delivered++;
+      deliver(e.id, e.args, e.nargs);
+    }
+    freeargs(&e);
+  }
+}
+
+static void drainidle(void *data) {
+  idle = NULL;
+  drain(qlen);
+  if (qlen && loop)
+    idle = wl_event_loop_add_idle(loop, drainidle, NULL);
+}
+
+void luasignal_flush(void) {
+  while (qlen && L)
+    drain(qlen);
+}
+
+/* Latest live queued entry of one of the signals in mask about object p */
+static Pending *lastfor(unsigned int mask, const void *p) {
+  Pending *e;
+  size_t i;
+
+  for (i = qlen; i-- > 0;) {
+    e = &queue[(qhead + i) & (qcap - 1)];
+    if (e->id >= 0 && e->id < SigBuiltinLast && mask & BIT(e->id) &&
+        e->nargs && e->args[0].v.p == p)
+      return e;
+  }
+  return NULL;
+}
+
+static void cancel(Pending *e) {
+  freeargs(e);
+  e->id = -1;
+  qstats.merged++;
+}
+
+static int sameargs(const SigArg *a, const SigArg *b) {
+  if (a->type != b->type)
+    return 0;
+  switch (a->type) {
+  case SigInt:
+    return a->v.i == b->v.i;
+  case SigString:
+    return !a->v.s == !b->v.s && (!a->v.s || !strcmp(a->v.s, b->v.s));
+  case SigBox:
+    return !memcmp(&a->v.box, &b->v.box, sizeof(a->v.box));
+  default:
+    return a->v.p == b->v.p;
+  }
+}
+
+/* Queue the emission, merging it with what is already queued; returns 0 if
+ * it has to be delivered synchronously instead */
+static int enqueue(int id, const SigArg *args, int nargs) {
+  Pending *e, *prev;
+  SigArg old = {SigNil, NULL, {0}};
+  void *p = nargs ? args[0].v.p : NULL;
+  int i, merge = 0;
+
+  if (id == SigMonitorRemoved || nargs > MAXARGS)
+    return 0;
+  qstats.queued++;
+
+  switch (id) {
+  case SigClientTitle:
+    if ((prev = lastfor(BIT(SigClientTitle), p)))
+      cancel(prev);
+    break;
+  case SigClientFocus:
+  case SigClientUnfocus:
+    if ((prev = lastfor(BIT(SigClientFocus) | BIT(SigClientUnfocus), p)) &&
+        prev->id != id) {
+      cancel(prev);
+      qstats.merged++;
+      return 1;
+    }
+    break;
+  case SigClientUnmap:
+    while ((prev = lastfor(BIT(SigClientTitle) | BIT(SigClientGeometry), p)))
+      cancel(prev);
+    if (lastfor(BIT(SigClientUnmap), p)) {
+      qstats.merged++;
+      return 1;
+    }
+    break;
+  default:
+    /* keep the oldest "old" value of the one being replaced */
+    if (id < SigBuiltinLast && MERGED & BIT(id) && nargs == 3 &&
+        (prev = lastfor(BIT(id), p))) {
+      old = prev->args[1];
+      prev->args[1].type = SigNil;
+      cancel(prev);
+      merge = 1;
+    }
+    break;
+  }
+
+  if (!luasignal_connected(id)) {
+    if (old.type == SigString)
+      free((char *)old.v.s);
+    return 1;
+  }
+  if (qlen == qcap) {
+    /* unwrap into a buffer twice as large */
+    e = ecalloc(qcap ? 2 * qcap : 64, sizeof(*e));
+    for (i = 0; (size_t)i < qlen; i++)
+      e[i] = queue[(qhead + i) & (qcap - 1)];
+    free(queue);
+    queue = e;
+    qhead = 0;
+    qcap = qcap ? 2 * qcap : 64;
+  }
+  e = &queue[(qhead + qlen++) & (qcap - 1)];
+  e->id = id;
+  e->nargs = nargs;
+  memcpy(e->args, args, nargs * sizeof(*args));
+  for (i = 0; i < nargs; i++)
+    if (e->args[i].type == SigString && e->args[i].v.s &&
+        !(e->args[i].v.s = strdup(e->args[i].v.s)))
+      die("strdup:");
+
+  if (merge) {
+    /* drop the merged change altogether if it ends where it started */
+    if (e->args[1].type == SigString)
+      free((char *)e->args[1].v.s);
+    e->args[1] = old;
+    if (sameargs(&e->args[1], &e->args[2]))
+      cancel(e);
+  }
+
+  if (!idle && loop)
+    idle = wl_event_loop_add_idle(loop, drainidle, NULL);
+  return 1;
+}
+
+void luasignal_emit(int id, const SigArg *args, int nargs) {
+  if (observer)
+    observer(id, args, nargs);
+  if (!L || id < 0 || id >= nsigs)
+    return;
+  if (deferred && loop && enqueue(id, args, nargs))
+    return;
+  luasignal_flush();
+  deliver(id, args, nargs);
+}
+
+void luasignal_set_loop(struct wl_event_loop *l) {
+  if (!(loop = l))
+    luasignal_set_deferred(0);
+}
+
+void luasignal_set_deferred(int on) {
+  deferred = on;
+  if (!on) {
+    luasignal_flush();
+    if (idle)
+      wl_event_source_remove(idle);
+    idle = NULL;
+  }
+}
+
+/* Lua API.  Signals are given by name or by the id Some.signal_intern()
+ * returned for it. */
+
+static int checksignal(lua_State *l, int arg) {
+  lua_Integer id;
+
+  if (lua_type(l, arg) == LUA_TNUMBER) {
+    id = luaL_checkinteger(l, arg);
+    luaL_argcheck(l, id >= 0 && id < nsigs, arg, "unknown signal id");
+    return (int)id;
+  }
+  return luasignal_intern(luaL_checkstring(l, arg));
+}
+
+static int addcallback(lua_State *l, int id, int fn) {
+  Signal *s = &sigs[id];
+
+  luaL_checktype(l, fn, LUA_TFUNCTION);
+  if (s->n == s->cap) {
+    s->cap = s->cap ? 2 * s->cap : 4;
+    s->refs = erealloc(s->refs, s->cap * sizeof(*s->refs));
+  }
+  lua_pushvalue(l, fn);
+  s->refs[s->n++] = luaL_ref(l, LUA_REGISTRYINDEX);
+  return 0;
+}
+
+static int delcallback(lua_State *l, int id, int fn) {
+  Signal *s = &sigs[id];
+  int i, found;
+
+  for (i = 0; i < s->n; i++) {
+    if (s->refs[i] == LUA_NOREF)
+      continue;
+    lua_rawgeti(l, LUA_REGISTRYINDEX, s->refs[i]);
+    found = lua_rawequal(l, -1, fn);
+    lua_pop(l, 1);
+    if (found) {
+      dropref(s, i);
+      lua_pushboolean(l, 1);
+      return 1;
+    }
+  }
+  lua_pushboolean(l, 0);
+  return 1;
+}
+
+static int l_signal_intern(lua_State *l) {
+  lua_pushinteger(l, luasignal_intern(luaL_checkstring(l, 1)));
+  return 1;
+}
+
+static int l_signal_connect(lua_State *l) {
+  return addcallback(l, checksignal(l, 1), 2);
+}
+
+static int l_signal_disconnect(lua_State *l) {
+  return delcallback(l, checksignal(l, 1), 2);
+}
+
+static int l_signal_disconnect_all(lua_State *l) {
+  int id = checksignal(l, 1);
+
+  lua_pushboolean(l, luasignal_connected(id));
+  dropall(&sigs[id]);
+  return 1;
+}
+
+static int l_signal_emit(lua_State *l) {
+  int id = checksignal(l, 1);
+
+  if (!luasignal_connected(id)) {
+    lua_pushinteger(l, 0);
+    return 1;
+  }
+  lua_pushinteger(l, dispatch(id, 2, lua_gettop(l) - 1));
+  return 1;
+}
+
+static int l_signal_count(lua_State *l) {
+  int id = checksignal(l, 1);
+
+  lua_pushinteger(l, sigs[id].n - sigs[id].holes);
+  return 1;
+}
+
+/* names of the signals that have callbacks, in interning order */
+static int l_signal_names(lua_State *l) {
+  int id, n = 0;
+
+  lua_newtable(l);
+  for (id = 0; id < nsigs; id++) {
+    if (!luasignal_connected(id))
+      continue;
+    lua_pushstring(l, sigs[id].name);
+    lua_rawseti(l, -2, ++n);
+  }
+  return 1;
+}
+
+static int l_signal_set_deferred(lua_State *l) {
+  luasignal_set_deferred(lua_toboolean(l, 1));
+  return 0;
+}
+
+/* deferred mode state and how much coalescing saved */
+static int l_signal_queue_stats(lua_State *l) {
+  lua_createtable(l, 0, 5);
+  lua_pushboolean(l, deferred && loop);
+  lua_setfield(l, -2, "deferred");
+  lua_pushinteger(l, qlen);
+  lua_setfield(l, -2, "pending");
+  lua_pushinteger(l, qstats.queued);
+  lua_setfield(l, -2, "queued");
+  lua_pushinteger(l, qstats.merged);
+  lua_setfield(l, -2, "merged");
+  lua_pushinteger(l, qstats.delivered);
+  lua_setfield(l, -2, "delivered");
+  return 1;
+}
+
+static int l_signal_clear(lua_State *l) {
+  int id;
+
+  for (id = 0; id < nsigs; id++)
+    dropall(&sigs[id]);
+  return 0;
+}
+
+/* Some.client_connect_signal("focus", fn) is "client::focus" on the bus */
+static int clientsignal(lua_State *l) {
+  return luasignal_intern(
+      lua_pushfstring(l, "client::%s", luaL_checkstring(l, 1)));
+}
+
+static int l_client_connect_signal(lua_State *l) {
+  return addcallback(l, clientsignal(l), 2);
+}
+
+static int l_client_disconnect_signal(lua_State *l) {
+  return delcallback(l, clientsignal(l), 2);
+}
+
+static const luaL_Reg signallib[] = {
+    {"signal_intern", l_signal_intern},
+    {"signal_connect", l_signal_connect},
+    {"signal_disconnect", l_signal_disconnect},
+    {"signal_disconnect_all", l_signal_disconnect_all},
+    {"signal_emit", l_signal_emit},
+    {"signal_count", l_signal_count},
+    {"signal_names", l_signal_names},
+    {"signal_clear", l_signal_clear},
+    {"signal_set_deferred", l_signal_set_deferred},
+    {"signal_queue_stats", l_signal_queue_stats},
+    {"client_connect_signal", l_client_connect_signal},
+    {"client_disconnect_signal", l_client_disconnect_signal},
+    {NULL, NULL},
+};
+
+void luasignal_register(lua_State *l) {
+  luasignal_init();
+  luaL_setfuncs(l, signallib, 0);
+}
@@ -0,0 +1,125 @@
+/*
+ * Signal bus shared by the compositor and Lua.
+ *
+ * Signals are named like "client::focus" and interned once into small
+ * integer ids; the signals the compositor emits itself are interned first, so
+ * C code emits them by constant id without any lookup.  Each signal keeps a
+ * growable array of Lua callbacks (registry references).  Emitting pushes the
+ * payload once and hands the same stack slots to every callback, so neither
+ * side builds an argument table per emission.
+ *
+ * Payloads are typed: a SigArg carries a boolean, integer, string, client,
+ * monitor or box (pushed to Lua as a {x, y, width, height} table) together
+ * with a key naming it, which non-Lua consumers such as IPC use as the field
+ * name.
+ *
+ * Callbacks run in connection order.  Callbacks connected while a signal is
+ * being emitted are first called on its next emission; callbacks
+ * disconnected during an emission are not called for the rest of it.
+ *
+ * By default signals emitted from C reach Lua synchronously, from inside the
+ * handler that emitted them.  In deferred mode they are queued instead and
+ * delivered from an idle callback once the current event loop dispatch is
+ * done, with redundant ones merged:
+ *
+ *  - only the last client::title_change of a client is kept;
+ *  - client::focus and client::unfocus of the same client cancel out, so
+ *    focus -> unfocus -> focus is delivered as a single focus;
+ *  - client::unmap drops the client's pending title and geometry changes and
+ *    repeated unmaps;
+ *  - geometry, layout and tag view changes of one object merge into one,
+ *    with the oldest "old" and the newest "new" value, and vanish if those
+ *    are equal.
+ *
+ * Ordering guarantees in deferred mode: signals are delivered in the order
+ * they were emitted, except that a merged signal takes the place of its last
+ * occurrence.  Callbacks observe the state at delivery time, not at emission
+ * time; only the payload values are kept.  monitor::removed and client
+ * destruction deliver everything queued before them immediately, so no
+ * callback sees a freed client or monitor.  The observer and signals emitted
+ * from Lua are never deferred.
+ */
+#ifndef LUASIGNAL_H
+#define LUASIGNAL_H
+
+#include <lua.h>
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+/* signals emitted by the compositor, with their payload */
+enum {
+  SigClientMap,        /* client */
+  SigClientUnmap,      /* client */
+  SigClientDestroy,    /* client, about to be freed */
+  SigClientFocus,      /* client */
+  SigClientUnfocus,    /* client */
+  SigClientTitle,      /* client */
+  SigClientFullscreen, /* client, state */
+  SigClientFloating,   /* client, state */
+  SigClientGeometry,   /* client, old box, new box */
+  SigClientUnresponsive, /* client, state */
+  SigMonitorAdded,     /* monitor */
+  SigMonitorRemoved,   /* monitor */
+  SigMonitorGeometry,  /* monitor, old box, new box */
+  SigMonitorLayout,    /* monitor, old symbol, new symbol */
+  SigTagView,          /* monitor, old tagset, new tagset */
+  SigBuiltinLast
+};
+
+enum { SigNil, SigBool, SigInt, SigString, SigClient, SigMonitor, SigBox };
+
+typedef struct {
+  int type;
+  const char *key;
+  union {
+    int b;
+    long long i;
+    const char *s;
+    void *p;
+    struct {
+      int x, y, width, height;
+    } box;
+  } v;
+} SigArg;
+
+#define ARGBOOL(k, x) ((SigArg){SigBool, (k), {.b = !!(x)}})
+#define ARGINT(k, x) ((SigArg){SigInt, (k), {.i = (x)}})
+#define ARGSTRING(k, x) ((SigArg){SigString, (k), {.s = (x)}})
+#define ARGCLIENT(x) ((SigArg){SigClient, "client", {.p = (x)}})
+#define ARGMONITOR(x) ((SigArg){SigMonitor, "monitor", {.p = (x)}})
+#define ARGBOX(k, g)                                                           \
+  ((SigArg){SigBox, (k), {.box = {(g).x, (g).y, (g).width, (g).height}}})
+
+/* emit signal id with the SigArg values given after it */
+#define SIGEMIT(id, ...)                                                       \
+  luasignal_emit((id), (const SigArg[]){__VA_ARGS__},                         \
+                 sizeof((const SigArg[]){__VA_ARGS__}) / sizeof(SigArg))
+
+/*
+ * Called for every emission from C before the Lua callbacks, even when no Lua
+ * state exists; dwl.c uses it to forward signals to IPC subscribers.
+ */
+typedef void (*SignalObserver)(int id, const SigArg *args, int nargs);
+
+void luasignal_init(void);
+/* drop every callback; must be called before the Lua state is closed */
+void luasignal_cleanup(void);
+/* id of name, interning it if needed; returns -1 only if name is NULL */
+int luasignal_intern(const char *name);
+const char *luasignal_name(int id);
+/* nonzero if id has Lua callbacks, so emitters can skip building payloads */
+int luasignal_connected(int id);
+void luasignal_emit(int id, const SigArg *args, int nargs);
+void luasignal_set_observer(SignalObserver observer);
+
+/* event loop used for deferred delivery; NULL turns deferred mode off */
+void luasignal_set_loop(struct wl_event_loop *loop);
+/* turn deferred mode on or off; turning it off flushes the queue */
+void luasignal_set_deferred(int on);
+/* deliver every queued signal now */
+void luasignal_flush(void);
+
+/* add the Some.signal_* functions to the table at the top of the stack */
+void luasignal_register(lua_State *L);
+
+#endif
@@ -0,0 +1,94 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "perfstat.h"
+
+uint64_t perf_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* Four buckets per power of two: the top three bits of ns pick one */
+static unsigned int bucket(uint64_t ns) {
+  unsigned int octave;
+
+  if (ns < 4)
+    return (unsigned int)ns;
+  octave = 63 - (unsigned int)__builtin_clzll(ns);
+  return (octave - 1) * 4 + (unsigned int)(ns >> (octave - 2) & 3);
+}
+
+/* Middle of bucket i */
+static uint64_t bucketmid(unsigned int i) {
+  unsigned int octave;
+
+  if (i < 4)
+    return i;
+  octave = i / 4 + 1;
+  return ((uint64_t)(4 + i % 4) << (octave - 2)) +
+         ((uint64_t)1 << (octave - 2)) / 2;
+}
+
+void perfstat_add(PerfStat *s, uint64_t ns) {
+  if (!s->count || ns < s->min)
+    s->min = ns;
+  if (ns > s->max)
+    s->max = ns;
+  s->count++;
+  s->total += ns;
+  s->hist[bucket(ns)]++;
+}
+
+void perfstat_since(PerfStat *s, uint64_t start) {
+  perfstat_add(s, perf_now() - start);
+}
+
+void perfstat_reset(PerfStat *s) { memset(s, 0, sizeof(*s)); }
+
+uint64_t perfstat_percentile(const PerfStat *s, double p) {
+  uint64_t want, seen = 0, v;
+  unsigned int i;
+
+  if (!s->count)
+    return 0;
+  want = (uint64_t)(p / 100 * (double)s->count + 0.5);
+  if (want < 1)
+    want = 1;
+  for (i = 0; i < PERF_BUCKETS; i++) {
+    if ((seen += s->hist[i]) >= want)
+      break;
+  }
+  v = bucketmid(i < PERF_BUCKETS ? i : PERF_BUCKETS - 1);
+  return v < s->min ? s->min : v > s->max ? s->max : v;
+}
+
+void perfstat_json(IpcBuf *b, const PerfStat *s) {
+  ipcbuf_printf(b,
+                "{\"count\":%llu,\"avg_us\":%.1f,\"min_us\":%.1f"
+                ",\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}",
+                (unsigned long long)s->count,
+                s->count ? (double)s->total / (double)s->count / 1e3 : 0.0,
+                (double)s->min / 1e3,
+                (double)perfstat_percentile(s, 50) / 1e3,
+                (double)perfstat_percentile(s, 99) / 1e3,
+                (double)s->max / 1e3);
+}
+
+long perf_rss_kb(void) {
+  FILE *f = fopen("/proc/self/statm", "r");
+  long size, resident;
+  int n;
+
+  if (!f)
+    return -1;
+  n = fscanf(f, "%ld %ld", &size, &resident);
+  fclose(f);
+  if (n != 2)
+    return -1;
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
@@ -0,0 +1,42 @@
+/*
+ * Timing accumulators for the compositor's own performance statistics.
+ *
+ * A PerfStat keeps the count, sum, minimum and maximum of the durations
+ * added to it, plus a histogram with four buckets per power of two from
+ * which percentiles are estimated to within about 20%.  Adding a sample
+ * costs a few arithmetic instructions and never allocates, so stats can be
+ * updated on every frame.
+ *
+ * dwl.c serves them over IPC ("get_stats", "reset_stats"), which is what
+ * "make bench" reads.
+ */
+#ifndef PERFSTAT_H
+#define PERFSTAT_H
+
+#include <stdint.h>
+
+#include "ipc.h"
+
+#define PERF_BUCKETS 256
+
+typedef struct {
+  uint64_t count, total, min, max; /* nanoseconds */
+  uint32_t hist[PERF_BUCKETS];
+} PerfStat;
+
+/* CLOCK_MONOTONIC in nanoseconds */
+uint64_t perf_now(void);
+void perfstat_add(PerfStat *s, uint64_t ns);
+/* add the time elapsed since start, a perf_now() value */
+void perfstat_since(PerfStat *s, uint64_t start);
+void perfstat_reset(PerfStat *s);
+/* estimated p-th percentile (0..100) in nanoseconds; 0 if s is empty */
+uint64_t perfstat_percentile(const PerfStat *s, double p);
+/* append {"count":..,"avg_us":..,"min_us":..,"p50_us":..,"p99_us":..,
+ * "max_us":..} */
+void perfstat_json(IpcBuf *b, const PerfStat *s);
+
+/* resident set size of this process in KiB, -1 if unknown */
+long perf_rss_kb(void);
+
+#endif
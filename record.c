@@ -0,0 +1,157 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "record.h"
+
+const char *const recordfmt[RecLast] = {
+    [RecKey] = "uu",          [RecModifiers] = "uuuu",
+    [RecMotion] = "ii",       [RecButton] = "uu",
+    [RecAxis] = "uiiu",       [RecOutputAdd] = "siiii",
+    [RecOutputRemove] = "s",  [RecClientMap] = "ussii",
+    [RecClientCommit] = "uii", [RecClientTitle] = "us",
+    [RecClientUnmap] = "u",
+};
+
+const char *const recordnames[RecLast] = {
+    [RecKey] = "key",
+    [RecModifiers] = "modifiers",
+    [RecMotion] = "motion",
+    [RecButton] = "button",
+    [RecAxis] = "axis",
+    [RecOutputAdd] = "output_add",
+    [RecOutputRemove] = "output_remove",
+    [RecClientMap] = "client_map",
+    [RecClientCommit] = "client_commit",
+    [RecClientTitle] = "client_title",
+    [RecClientUnmap] = "client_unmap",
+};
+
+FILE *recordfile;
+static uint64_t lasttime; /* microseconds, CLOCK_MONOTONIC */
+static uint64_t elapsed;  /* time of the last record read */
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void putvarint(uint64_t v) {
+  while (v >= 0x80) {
+    putc((int)(v & 0x7f) | 0x80, recordfile);
+    v >>= 7;
+  }
+  putc((int)v, recordfile);
+}
+
+int record_open(const char *path) {
+  if (!(recordfile = fopen(path, "wb")))
+    return -1;
+  /* records are small and frequent; keep them off the write(2) path */
+  setvbuf(recordfile, NULL, _IOFBF, 1 << 16);
+  fwrite(RECORD_MAGIC, 1, 8, recordfile);
+  lasttime = 0;
+  return 0;
+}
+
+void record_close(void) {
+  if (recordfile)
+    fclose(recordfile);
+  recordfile = NULL;
+}
+
+void record_write(int type, ...) {
+  uint64_t t = now_us();
+  const char *f, *s;
+  va_list ap;
+  size_t len;
+  int i;
+
+  if (!recordfile)
+    return;
+  putc(type, recordfile);
+  putvarint(lasttime ? t - lasttime : 0);
+  lasttime = t;
+  va_start(ap, type);
+  for (f = recordfmt[type]; *f; f++) {
+    switch (*f) {
+    case 'u':
+      putvarint(va_arg(ap, unsigned int));
+      break;
+    case 'i':
+      i = va_arg(ap, int);
+      putvarint(i < 0 ? ((uint64_t)-(int64_t)i << 1) - 1 : (uint64_t)i << 1);
+      break;
+    case 's':
+      s = va_arg(ap, const char *);
+      len = s ? strlen(s) : 0;
+      if (len > RECORD_MAXSTRING) {
+        /* cut at a UTF-8 character boundary */
+        len = RECORD_MAXSTRING;
+        while (len && ((unsigned char)s[len] & 0xc0) == 0x80)
+          len--;
+      }
+      putvarint(len);
+      fwrite(s ? s : "", 1, len, recordfile);
+      break;
+    }
+  }
+  va_end(ap);
+}
+
+static int getvarint(FILE *f, uint64_t *v) {
+  unsigned int shift = 0;
+  int c;
+
+  *v = 0;
+  do {
+    if ((c = getc(f)) == EOF || shift > 63)
+      return -1;
+    *v |= (uint64_t)(c & 0x7f) << shift;
+    shift += 7;
+  } while (c & 0x80);
+  return 0;
+}
+
+int record_check(FILE *f) {
+  char magic[8];
+
+  elapsed = 0;
+  return fread(magic, 1, 8, f) == 8 && !memcmp(magic, RECORD_MAGIC, 8) ? 0
+                                                                       : -1;
+}
+
+int record_read(FILE *f, RecordEvent *ev) {
+  const char *fmt;
+  int c, nnum = 0, nstr = 0;
+  uint64_t v;
+
+  free(ev->str[0]);
+  free(ev->str[1]);
+  ev->str[0] = ev->str[1] = NULL;
+  if ((c = getc(f)) == EOF)
+    return 0;
+  if (c >= RecLast || getvarint(f, &v))
+    return -1;
+  ev->type = c;
+  ev->time = elapsed += v;
+  for (fmt = recordfmt[c]; *fmt; fmt++) {
+    if (getvarint(f, &v))
+      return -1;
+    if (*fmt == 'u') {
+      ev->num[nnum++] = (int64_t)v;
+    } else if (*fmt == 'i') {
+      ev->num[nnum++] = v & 1 ? -(int64_t)(v >> 1) - 1 : (int64_t)(v >> 1);
+    } else {
+      if (v > RECORD_MAXSTRING || !(ev->str[nstr] = malloc(v + 1)) ||
+          fread(ev->str[nstr], 1, v, f) != v)
+        return -1;
+      ev->str[nstr++][v] = '\0';
+    }
+  }
+  return 1;
+}
@@ -0,0 +1,64 @@
+/*
+ * Session recordings for reproducing performance problems.
+ *
+ * dwl -r <file> appends every input event, output hotplug and client map,
+ * commit, title change and unmap to a compact binary file; tools/replay
+ * feeds it back into a headless session with stub clients (see
+ * tools/replay.sh).
+ *
+ * The file starts with the 8 bytes "SOMEWMR1".  Each record follows as a
+ * type byte, the microseconds since the previous record, and the fields
+ * listed for its type in recordfmt[]: 'u' is an unsigned and 'i' a signed
+ * (zigzag) LEB128 varint, 's' a varint length followed by that many bytes.
+ * Coordinates and axis deltas are in 1/256 pixel.
+ */
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define RECORD_MAGIC "SOMEWMR1"
+#define RECORD_MAXFIELDS 6
+#define RECORD_MAXSTRING 4096 /* bytes; longer strings are cut when written */
+
+enum {
+  RecKey,          /* keycode state */
+  RecModifiers,    /* depressed latched locked group */
+  RecMotion,       /* x y, absolute in the layout */
+  RecButton,       /* button state */
+  RecAxis,         /* orientation delta discrete source */
+  RecOutputAdd,    /* name x y width height */
+  RecOutputRemove, /* name */
+  RecClientMap,    /* id appid title width height */
+  RecClientCommit, /* id width height, the surface size */
+  RecClientTitle,  /* id title */
+  RecClientUnmap,  /* id */
+  RecLast
+};
+
+extern const char *const recordfmt[RecLast];
+extern const char *const recordnames[RecLast];
+
+typedef struct {
+  int type;
+  uint64_t time;                   /* microseconds since the first record */
+  int64_t num[RECORD_MAXFIELDS];   /* the 'u' and 'i' fields in order */
+  char *str[2];                    /* the 's' fields in order */
+} RecordEvent;
+
+/* Writing: nothing is recorded until record_open() succeeded */
+extern FILE *recordfile;
+int record_open(const char *path);
+void record_close(void);
+/* append a record; the variadic arguments follow recordfmt[type], with
+ * unsigned int for 'u', int for 'i' and const char * for 's' */
+void record_write(int type, ...);
+
+/* Reading: record_check() consumes and verifies the magic.  record_read()
+ * returns 1 for a record, 0 at the end of the file and -1 if it is damaged;
+ * ev must start zeroed, and its strings stay valid until the next call. */
+int record_check(FILE *f);
+int record_read(FILE *f, RecordEvent *ev);
+
+#endif
@@ -0,0 +1,287 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rulematch.h"
+#include "util.h"
+
+/* distinct app_ids remembered before the cache is flushed */
+#define APPID_CACHE_MAX 256
+
+typedef struct {
+  uint32_t child;   /* first child, 0 if none */
+  uint32_t sibling; /* next child of the same parent */
+  uint32_t fail;    /* longest proper suffix that is also a trie node */
+  uint32_t dict;    /* nearest node on the fail chain with outputs */
+  uint32_t out;     /* first index into AcTrie.outs */
+  uint32_t nout;    /* number of rules ending at this node */
+  unsigned char byte;
+} AcNode;
+
+typedef struct {
+  AcNode *nodes;
+  uint32_t nnodes, cap;
+  uint32_t *outs; /* rule indices, grouped per node, ascending */
+} AcTrie;
+
+typedef struct {
+  char *key; /* NULL if the slot is free */
+  uint32_t hash;
+} AppidSlot;
+
+struct RuleMatcher {
+  size_t nrules, nwords;
+  AcTrie ids, titles;
+  uint64_t *idany;    /* rules without an app_id pattern */
+  uint64_t *titleany; /* rules without a title pattern */
+  uint64_t *titled;   /* rules with a title pattern */
+  uint64_t *scratch;
+
+  /* exact app_id -> app_id half of the match */
+  AppidSlot *slots;
+  uint64_t *slotbits; /* nwords per slot */
+  size_t nslots, used;
+};
+
+static void *erealloc(void *p, size_t size) {
+  if (!(p = realloc(p, size)))
+    die("realloc:");
+  return p;
+}
+
+static uint32_t acgoto(const AcTrie *t, uint32_t n, unsigned char b) {
+  uint32_t c;
+
+  for (c = t->nodes[n].child; c; c = t->nodes[c].sibling)
+    if (t->nodes[c].byte == b)
+      return c;
+  return 0;
+}
+
+static uint32_t acinsert(AcTrie *t, const char *pat) {
+  const unsigned char *s;
+  uint32_t n = 0, c;
+
+  for (s = (const unsigned char *)pat; *s; s++) {
+    if ((c = acgoto(t, n, *s))) {
+      n = c;
+      continue;
+    }
+    if (t->nnodes == t->cap) {
+      t->cap *= 2;
+      t->nodes = erealloc(t->nodes, t->cap * sizeof(*t->nodes));
+    }
+    c = t->nnodes++;
+    memset(&t->nodes[c], 0, sizeof(t->nodes[c]));
+    t->nodes[c].byte = *s;
+    t->nodes[c].sibling = t->nodes[n].child;
+    t->nodes[n].child = c;
+    n = c;
+  }
+  return n;
+}
+
+static void acbuild(AcTrie *t, const char *const *pats, size_t npats) {
+  uint32_t *term, *queue, *fill;
+  uint32_t head = 0, tail = 0, u, v, f, total = 0;
+  size_t i;
+
+  t->cap = 64;
+  t->nnodes = 1;
+  t->nodes = ecalloc(t->cap, sizeof(*t->nodes));
+
+  /* empty patterns behave like NULL and are handled by the *any masks */
+  term = ecalloc(npats ? npats : 1, sizeof(*term));
+  for (i = 0; i < npats; i++)
+    term[i] = pats[i] && *pats[i] ? acinsert(t, pats[i]) : 0;
+
+  /* lay out outputs per node, keeping rules[] order inside each group */
+  for (i = 0; i < npats; i++)
+    if (term[i])
+      t->nodes[term[i]].nout++;
+  for (u = 0; u < t->nnodes; u++) {
+    t->nodes[u].out = total;
+    total += t->nodes[u].nout;
+  }
+  t->outs = ecalloc(total ? total : 1, sizeof(*t->outs));
+  fill = ecalloc(t->nnodes, sizeof(*fill));
+  for (i = 0; i < npats; i++)
+    if ((u = term[i]))
+      t->outs[t->nodes[u].out + fill[u]++] = (uint32_t)i;
+  free(fill);
+  free(term);
+
+  /* breadth-first fail and dictionary links */
+  queue = ecalloc(t->nnodes, sizeof(*queue));
+  queue[tail++] = 0;
+  while (head < tail) {
+    u = queue[head++];
+    for (v = t->nodes[u].child; v; v = t->nodes[v].sibling) {
+      f = 0;
+      if (u) {
+        for (f = t->nodes[u].fail; f && !acgoto(t, f, t->nodes[v].byte);)
+          f = t->nodes[f].fail;
+        f = acgoto(t, f, t->nodes[v].byte);
+      }
+      t->nodes[v].fail = f;
+      t->nodes[v].dict = t->nodes[f].nout ? f : t->nodes[f].dict;
+      queue[tail++] = v;
+    }
+  }
+  free(queue);
+}
+
+static void acscan(const AcTrie *t, const char *str, uint64_t *bits) {
+  const unsigned char *s;
+  const AcNode *x;
+  uint32_t n = 0, c = 0, k;
+
+  for (s = (const unsigned char *)str; *s; s++) {
+    while (n && !(c = acgoto(t, n, *s)))
+      n = t->nodes[n].fail;
+    if (!n)
+      c = acgoto(t, 0, *s);
+    n = c;
+    for (k = t->nodes[n].nout ? n : t->nodes[n].dict; k; k = x->dict) {
+      uint32_t o;
+
+      x = &t->nodes[k];
+      for (o = x->out; o < x->out + x->nout; o++)
+        bits[t->outs[o] / 64] |= UINT64_C(1) << (t->outs[o] % 64);
+    }
+  }
+}
+
+static uint32_t hashstr(const char *s) {
+  uint32_t h = 2166136261u;
+
+  for (; *s; s++)
+    h = (h ^ (unsigned char)*s) * 16777619u;
+  return h;
+}
+
+static void cacheflush(RuleMatcher *rm) {
+  size_t i;
+
+  for (i = 0; i < rm->nslots; i++) {
+    free(rm->slots[i].key);
+    rm->slots[i].key = NULL;
+  }
+  rm->used = 0;
+}
+
+/* returns the app_id bitset for appid, computing and caching it on a miss */
+static const uint64_t *idmatch(RuleMatcher *rm, const char *appid) {
+  uint32_t h = hashstr(appid);
+  size_t i = h & (rm->nslots - 1), w;
+  uint64_t *bits;
+
+  for (; rm->slots[i].key; i = (i + 1) & (rm->nslots - 1))
+    if (rm->slots[i].hash == h && !strcmp(rm->slots[i].key, appid))
+      return &rm->slotbits[i * rm->nwords];
+
+  if (rm->used == APPID_CACHE_MAX) {
+    cacheflush(rm);
+    i = h & (rm->nslots - 1);
+  }
+  rm->used++;
+  rm->slots[i].hash = h;
+  if (!(rm->slots[i].key = strdup(appid)))
+    die("strdup:");
+  bits = &rm->slotbits[i * rm->nwords];
+  for (w = 0; w < rm->nwords; w++)
+    bits[w] = rm->idany[w];
+  acscan(&rm->ids, appid, bits);
+  return bits;
+}
+
+RuleMatcher *rulematcher_create(const char *const *ids,
+                                const char *const *titles, size_t nrules) {
+  RuleMatcher *rm = ecalloc(1, sizeof(*rm));
+  size_t i, nw;
+
+  rm->nrules = nrules;
+  rm->nwords = nw = (nrules + 63) / 64;
+  rm->idany = ecalloc(nw ? nw : 1, sizeof(uint64_t));
+  rm->titleany = ecalloc(nw ? nw : 1, sizeof(uint64_t));
+  rm->titled = ecalloc(nw ? nw : 1, sizeof(uint64_t));
+  rm->scratch = ecalloc(nw ? nw : 1, sizeof(uint64_t));
+  for (i = 0; i < nrules; i++) {
+    if (!ids[i] || !*ids[i])
+      rm->idany[i / 64] |= UINT64_C(1) << (i % 64);
+    if (!titles[i] || !*titles[i])
+      rm->titleany[i / 64] |= UINT64_C(1) << (i % 64);
+    else
+      rm->titled[i / 64] |= UINT64_C(1) << (i % 64);
+  }
+  acbuild(&rm->ids, ids, nrules);
+  acbuild(&rm->titles, titles, nrules);
+
+  /* load factor stays at or below one half */
+  rm->nslots = 2 * APPID_CACHE_MAX;
+  rm->slots = ecalloc(rm->nslots, sizeof(*rm->slots));
+  rm->slotbits = ecalloc(rm->nslots * (nw ? nw : 1), sizeof(uint64_t));
+  return rm;
+}
+
+void rulematcher_destroy(RuleMatcher *rm) {
+  if (!rm)
+    return;
+  cacheflush(rm);
+  free(rm->slots);
+  free(rm->slotbits);
+  free(rm->ids.nodes);
+  free(rm->ids.outs);
+  free(rm->titles.nodes);
+  free(rm->titles.outs);
+  free(rm->idany);
+  free(rm->titleany);
+  free(rm->titled);
+  free(rm->scratch);
+  free(rm);
+}
+
+size_t rulematcher_words(const RuleMatcher *rm) { return rm->nwords; }
+
+void rulematcher_match(RuleMatcher *rm, const char *appid, const char *title,
+                       uint64_t *out) {
+  const uint64_t *idbits;
+  size_t w;
+
+  if (!rm->nwords)
+    return;
+  idbits = idmatch(rm, appid);
+  for (w = 0; w < rm->nwords; w++)
+    rm->scratch[w] = rm->titleany[w];
+  acscan(&rm->titles, title, rm->scratch);
+  for (w = 0; w < rm->nwords; w++)
+    out[w] = idbits[w] & rm->scratch[w];
+}
+
+int rulematcher_titledep(RuleMatcher *rm, const char *appid) {
+  const uint64_t *idbits;
+  size_t w;
+
+  if (!rm->nwords)
+    return 0;
+  idbits = idmatch(rm, appid);
+  for (w = 0; w < rm->nwords; w++)
+    if (idbits[w] & rm->titled[w])
+      return 1;
+  return 0;
+}
+
+int rulematcher_next(const RuleMatcher *rm, const uint64_t *set, int from) {
+  size_t w = (size_t)from / 64;
+  uint64_t word;
+
+  if (from < 0 || (size_t)from >= rm->nrules)
+    return -1;
+  for (word = set[w] & (~UINT64_C(0) << (from % 64)); !word;) {
+    if (++w == rm->nwords)
+      return -1;
+    word = set[w];
+  }
+  return (int)(w * 64 + (size_t)__builtin_ctzll(word));
+}
@@ -0,0 +1,39 @@
+/*
+ * Compiled matcher for the rules[] table.
+ *
+ * A rule matches a client when every non-NULL pattern of the rule is a
+ * substring of the corresponding client string.  Instead of running strstr()
+ * for every rule, all app_id and title patterns are compiled into two
+ * Aho-Corasick automata at startup, so each string is scanned exactly once.
+ * The app_id half of the result is additionally cached in a hash map keyed by
+ * the exact app_id, since most clients share a handful of app_ids.
+ *
+ * Results are returned as a bitset with one bit per rule, in rules[] order.
+ */
+#ifndef RULEMATCH_H
+#define RULEMATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct RuleMatcher RuleMatcher;
+
+/* ids[i] and titles[i] are the patterns of rule i, NULL meaning "any" */
+RuleMatcher *rulematcher_create(const char *const *ids,
+                                const char *const *titles, size_t nrules);
+void rulematcher_destroy(RuleMatcher *rm);
+
+/* number of uint64_t words in a result bitset */
+size_t rulematcher_words(const RuleMatcher *rm);
+
+/* fill out (rulematcher_words() long) with the set of rules matching */
+void rulematcher_match(RuleMatcher *rm, const char *appid, const char *title,
+                       uint64_t *out);
+
+/* whether any rule whose app_id pattern matches appid also tests the title */
+int rulematcher_titledep(RuleMatcher *rm, const char *appid);
+
+/* iterate a result bitset: returns the next set rule index >= from, or -1 */
+int rulematcher_next(const RuleMatcher *rm, const uint64_t *set, int from);
+
+#endif
@@ -0,0 +1,117 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "statuspage.h"
+
+/* reads spinning on an odd seq before yielding the CPU */
+#define SPIN_TRIES 64
+
+SomewmStatusPage *statuspage_create(const char *path) {
+  SomewmStatusPage *page;
+  int fd;
+
+  if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0) {
+    perror("statuspage: open");
+    return NULL;
+  }
+  if (ftruncate(fd, sizeof(*page)) < 0) {
+    perror("statuspage: ftruncate");
+    close(fd);
+    unlink(path);
+    return NULL;
+  }
+  page = mmap(NULL, sizeof(*page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (page == MAP_FAILED) {
+    perror("statuspage: mmap");
+    unlink(path);
+    return NULL;
+  }
+
+  page->version = SOMEWM_STATUS_VERSION;
+  page->size = sizeof(*page);
+  /* Publish magic last so readers never see a half initialised header */
+  __atomic_store_n(&page->magic, SOMEWM_STATUS_MAGIC, __ATOMIC_RELEASE);
+  return page;
+}
+
+void statuspage_begin(SomewmStatusPage *page) {
+  __atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void statuspage_end(SomewmStatusPage *page) {
+  page->updates++;
+  __atomic_store_n(&page->seq, page->seq + 1, __ATOMIC_RELEASE);
+}
+
+void statuspage_destroy(SomewmStatusPage *page, const char *path) {
+  if (!page)
+    return;
+  munmap(page, sizeof(*page));
+  unlink(path);
+}
+
+const SomewmStatusPage *somewm_status_open(const char *path) {
+  const SomewmStatusPage *page;
+  struct stat st;
+  int fd;
+
+  if (!path && !(path = getenv("SOMEWM_STATUS")))
+    return NULL;
+  if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+    return NULL;
+  if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*page)) {
+    close(fd);
+    return NULL;
+  }
+  page = mmap(NULL, sizeof(*page), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (page == MAP_FAILED)
+    return NULL;
+  if (__atomic_load_n(&page->magic, __ATOMIC_ACQUIRE) != SOMEWM_STATUS_MAGIC ||
+      page->version != SOMEWM_STATUS_VERSION) {
+    munmap((void *)page, sizeof(*page));
+    return NULL;
+  }
+  return page;
+}
+
+void somewm_status_close(const SomewmStatusPage *page) {
+  if (page)
+    munmap((void *)page, sizeof(*page));
+}
+
+uint32_t somewm_status_seq(const SomewmStatusPage *page) {
+  return __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+}
+
+uint32_t somewm_status_read(const SomewmStatusPage *page,
+                            SomewmStatusPage *out) {
+  uint32_t before, after;
+  int tries = 0;
+
+  for (;;) {
+    before = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+    if (!(before & 1)) {
+      memcpy(out, page, sizeof(*out));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      after = __atomic_load_n(&page->seq, __ATOMIC_RELAXED);
+      if (before == after) {
+        out->seq = before;
+        return before;
+      }
+    }
+    /* The writer is never preempted for long, but do not burn a core if the
+     * compositor was stopped in the middle of an update */
+    if (++tries % SPIN_TRIES == 0)
+      sched_yield();
+  }
+}
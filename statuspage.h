@@ -0,0 +1,65 @@
+/*
+ * Shared-memory status page.
+ *
+ * The compositor publishes the same information as printstatus() into a
+ * fixed-layout page in a file under $XDG_RUNTIME_DIR (exported to children
+ * as SOMEWM_STATUS).  Readers mmap the file read-only and take consistent
+ * snapshots without any syscall and without waking the compositor.
+ *
+ * Consistency is provided by a seqlock: the writer makes seq odd, updates
+ * the page, then makes seq even again.  A reader copies the page and retries
+ * if seq was odd or changed while copying.  Comparing seq against the last
+ * value seen is a cheap way to poll for changes.
+ *
+ * The layout only grows at the end; readers must check magic and version,
+ * and size tells how many bytes the writer's page has.
+ */
+#ifndef STATUSPAGE_H
+#define STATUSPAGE_H
+
+#include <stdint.h>
+
+#define SOMEWM_STATUS_MAGIC 0x534d5753u /* "SWMS" */
+#define SOMEWM_STATUS_VERSION 1
+#define SOMEWM_STATUS_MONITORS 8
+
+typedef struct {
+  char name[32];
+  char layout[16];
+  char title[256];   /* focused client, empty if none */
+  char appid[128];   /* focused client, empty if none */
+  uint32_t selected; /* this is the selected monitor */
+  uint32_t tagset;   /* visible tags */
+  uint32_t occupied; /* tags with at least one client */
+  uint32_t urgent;   /* tags with an urgent client */
+  uint32_t seltags;  /* tags of the focused client */
+  uint32_t nclients;
+  uint32_t fullscreen, floating; /* focused client state */
+} SomewmStatusMonitor;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t seq; /* odd while an update is in progress */
+  uint64_t updates;
+  uint32_t nmonitors; /* entries used in mons */
+  uint32_t nclients;
+  SomewmStatusMonitor mons[SOMEWM_STATUS_MONITORS];
+} SomewmStatusPage;
+
+/* Writer side, used by the compositor */
+SomewmStatusPage *statuspage_create(const char *path);
+void statuspage_begin(SomewmStatusPage *page);
+void statuspage_end(SomewmStatusPage *page);
+void statuspage_destroy(SomewmStatusPage *page, const char *path);
+
+/* Reader side. path may be NULL to use $SOMEWM_STATUS. */
+const SomewmStatusPage *somewm_status_open(const char *path);
+void somewm_status_close(const SomewmStatusPage *page);
+/* current sequence number, without copying the page */
+uint32_t somewm_status_seq(const SomewmStatusPage *page);
+/* copy a consistent snapshot into out and return its sequence number */
+uint32_t somewm_status_read(const SomewmStatusPage *page, SomewmStatusPage *out);
+
+#endif
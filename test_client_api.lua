@@ -49,4 +49,19 @@ else
   somewm.base.logger.info("No terminals found")
 end
 
-somewm.base.logger.info("Client API test completed")
\ No newline at end of file
+-- Test batch snapshots: all properties of one client, and columns for all
+if focused then
+  local snap = Some.client_snapshot(Some.client_get_focused())
+  somewm.base.logger.info("Snapshot: " .. tostring(snap.title) .. " tags=" .. snap.tags ..
+    " visible=" .. tostring(snap.visible))
+end
+
+local columns = Some.clients_snapshot()
+for i = 1, columns.n do
+  somewm.base.logger.info(string.format("Row %d: %s (%s) %dx%d", i,
+    tostring(columns.title[i]), tostring(columns.appid[i]), columns.width[i], columns.height[i]))
+end
+columns = Some.clients_snapshot({ visible = true }, columns)
+somewm.base.logger.info("Visible clients: " .. columns.n)
+
+somewm.base.logger.info("Client API test completed")
@@ -62,7 +62,34 @@ end)
 -- Emit test signal
 somewm.base.signal.emit("test_signal", "Hello from test!")
 
--- Test 3: UI automation events (if available)
+-- Test 3: Compositor signals on the same bus
+somewm.core.monitor.on_added(function(m)
+  somewm.base.logger.info("EVENT: Monitor added - " .. tostring(Some.monitor_get_name(m)))
+end)
+
+somewm.base.signal.connect("tag::view_changed", function(m, old, new)
+  somewm.base.logger.info(string.format("EVENT: Tags viewed %d -> %d", old, new))
+end)
+
+somewm.base.signal.connect("monitor::layout", function(m, old, new)
+  somewm.base.logger.info("EVENT: Layout " .. old .. " -> " .. new)
+end)
+
+somewm.core.client.connect_signal("geometry", function(c, old, new)
+  somewm.base.logger.info(string.format("EVENT: %s moved to %dx%d+%d+%d",
+    c.title or "Untitled", new.width, new.height, new.x, new.y))
+end)
+
+local fired = 0
+local counter = function() fired = fired + 1 end
+for _ = 1, 40 do
+  somewm.base.signal.connect("test_many", counter)
+end
+assert(somewm.base.signal.emit("test_many") == 40 and fired == 40,
+  "more than 32 callbacks per signal")
+somewm.base.signal.disconnect_all("test_many")
+
+-- Test 4: UI automation events (if available)
 if somewm.ui.automation then
   -- Add a test automation rule
   somewm.ui.automation.add_rule({
@@ -87,6 +114,7 @@ somewm.base.logger.info("Now try:")
 somewm.base.logger.info("  - Opening a new window (manage event)")
 somewm.base.logger.info("  - Closing a window (unmanage event)")
 somewm.base.logger.info("  - Switching focus between windows (focus/unfocus events)")
+somewm.base.logger.info("  - Switching tags or layouts (tag::view_changed, monitor::layout events)")
 somewm.base.logger.info("  - Changing window titles (property::title event)")
 somewm.base.logger.info("  - Toggling fullscreen with Super+f (property::fullscreen event)")
 somewm.base.logger.info("  - Toggling floating with Super+Shift+Space (property::floating event)")
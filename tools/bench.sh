@@ -0,0 +1,43 @@
+#!/bin/sh
+# End-to-end benchmark, run by "make bench": starts dwl on the wlroots
+# headless backend with the pixman renderer, drives it with benchclient and
+# inputbench and appends their JSON lines (one per client count, then one
+# with input latencies) to $BENCH_OUT, tagged with the commit that was
+# measured so results can be compared across commits.
+#
+#   BENCH_OUT      results file (default bench-results.jsonl)
+#   BENCH_OUTPUTS  number of virtual outputs (default 2)
+#   BENCH_CLIENTS  client counts (default "10 100 1000")
+#   BENCH_ROUNDS   injections per input kind (default 100)
+set -eu
+cd "$(dirname "$0")/.."
+
+out=${BENCH_OUT:-bench-results.jsonl}
+outputs=${BENCH_OUTPUTS:-2}
+clients=${BENCH_CLIENTS:-10 100 1000}
+rounds=${BENCH_ROUNDS:-100}
+rev=$(git describe --always --dirty 2>/dev/null || echo unknown)
+date=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT INT TERM
+
+if [ -z "${XDG_RUNTIME_DIR:-}" ]; then
+	XDG_RUNTIME_DIR=$tmp
+	export XDG_RUNTIME_DIR
+fi
+
+# the clients run as children of dwl, so they inherit WAYLAND_DISPLAY and
+# SOMEWM_SOCK; dwl is stopped once they are done
+env -u DISPLAY -u WAYLAND_DISPLAY WLR_BACKENDS=headless WLR_RENDERER=pixman \
+	WLR_HEADLESS_OUTPUTS="$outputs" WLR_LIBINPUT_NO_DEVICES=1 \
+	./dwl -s "{ ./benchclient $clients && ./inputbench -n $rounds; } \
+		>'$tmp/results' 2>'$tmp/log'; echo \$? >'$tmp/status'; kill \$PPID" \
+	>"$tmp/dwl.log" 2>&1 || :
+
+if [ "$(cat "$tmp/status" 2>/dev/null)" != 0 ]; then
+	echo "bench: benchmark client failed" >&2
+	cat "$tmp/log" "$tmp/dwl.log" >&2 2>/dev/null || :
+	exit 1
+fi
+sed "s/^{/{\"rev\":\"$rev\",\"date\":\"$date\",\"outputs\":$outputs,/" \
+	"$tmp/results" | tee -a "$out"
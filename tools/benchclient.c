@@ -0,0 +1,110 @@
+/*
+ * Client half of "make bench": drives a running dwl with synthetic
+ * xdg-shell windows and reads back the compositor's own timings over IPC.
+ *
+ *   benchclient [n...]   for each n (default 10, 100 and 1000): reset the
+ *                        compositor stats, map n windows, retitle, resize
+ *                        and switch tags, wait for frames, print one JSON
+ *                        line, then destroy the windows again
+ *
+ * Needs WAYLAND_DISPLAY and SOMEWM_SOCK, which dwl sets for programs it
+ * starts.  Each output line looks like
+ *
+ *   {"clients":n,"client":{"map_ms":..,"retitle_ms":..,"resize_ms":..,
+ *    "tag_switch_ms":..,"destroy_ms":..,"frames":..,"frame_ms":..},
+ *    "compositor":<result of the "get_stats" IPC request>}
+ *
+ * where the "client" times are wall-clock time for the whole phase as seen
+ * from here, up to the compositor acknowledging it with a roundtrip.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchwl.h"
+
+#define TAG_SWITCHES 20
+#define FRAMES 60
+#define FRAME_TIMEOUT_MS 2000
+
+static void run(size_t n) {
+  double t, map, retitle, resize, tagswitch, destroy, frame;
+  BenchWindow *windows;
+  char title[64], *stats;
+  int frames = 0, i;
+  size_t j;
+
+  free(bench_ipc("view", 1));
+  free(bench_ipc("reset_stats", 0));
+  if (!(windows = calloc(n, sizeof(*windows))))
+    bench_die("out of memory");
+
+  t = bench_now_ms();
+  for (j = 0; j < n; j++) {
+    snprintf(title, sizeof(title), "bench %zu", j);
+    bench_window_create(&windows[j], NULL, title);
+  }
+  bench_window_wait(n);
+  map = bench_now_ms() - t;
+
+  t = bench_now_ms();
+  for (j = 0; j < n; j++) {
+    snprintf(title, sizeof(title), "bench %zu (renamed)", j);
+    xdg_toplevel_set_title(windows[j].toplevel, title);
+  }
+  wl_display_roundtrip(bench_dpy);
+  retitle = bench_now_ms() - t;
+
+  t = bench_now_ms();
+  for (j = 0; j < n; j++)
+    bench_window_present(&windows[j], bench_large);
+  wl_display_roundtrip(bench_dpy);
+  resize = bench_now_ms() - t;
+
+  t = bench_now_ms();
+  for (i = 0; i < TAG_SWITCHES; i++) {
+    free(bench_ipc("view", 2));
+    free(bench_ipc("view", 1));
+  }
+  tagswitch = (bench_now_ms() - t) / (2 * TAG_SWITCHES);
+
+  /* redraw the first window every frame; stop early if it is never shown */
+  t = bench_now_ms();
+  for (i = 0; n && i < FRAMES; i++) {
+    if (!bench_window_frame(&windows[0], i % 2 ? bench_small : bench_large,
+                            FRAME_TIMEOUT_MS))
+      break;
+    frames++;
+  }
+  frame = frames ? (bench_now_ms() - t) / frames : 0;
+
+  stats = bench_ipc("get_stats", 0);
+
+  t = bench_now_ms();
+  for (j = 0; j < n; j++)
+    bench_window_destroy(&windows[j]);
+  wl_display_roundtrip(bench_dpy);
+  destroy = bench_now_ms() - t;
+
+  printf("{\"clients\":%zu,\"client\":{\"map_ms\":%.2f,\"retitle_ms\":%.2f"
+         ",\"resize_ms\":%.2f,\"tag_switch_ms\":%.3f,\"destroy_ms\":%.2f"
+         ",\"frames\":%d,\"frame_ms\":%.2f},\"compositor\":%s}\n",
+         n, map, retitle, resize, tagswitch, destroy, frames, frame, stats);
+  fflush(stdout);
+  free(stats);
+  free(windows);
+}
+
+int main(int argc, char *argv[]) {
+  static const size_t defaults[] = {10, 100, 1000};
+  size_t i;
+
+  bench_connect(NULL, 0);
+  if (argc > 1)
+    for (i = 1; i < (size_t)argc; i++)
+      run(strtoul(argv[i], NULL, 10));
+  else
+    for (i = 0; i < sizeof(defaults) / sizeof(*defaults); i++)
+      run(defaults[i]);
+  bench_disconnect();
+  return 0;
+}
@@ -0,0 +1,54 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "benchinput.h"
+
+struct zwp_virtual_keyboard_manager_v1 *bench_kbdmgr;
+struct zwlr_virtual_pointer_manager_v1 *bench_ptrmgr;
+
+const BenchGlobal bench_input_globals[2] = {
+    {&zwp_virtual_keyboard_manager_v1_interface, 1, (void **)&bench_kbdmgr},
+    {&zwlr_virtual_pointer_manager_v1_interface, 2, (void **)&bench_ptrmgr},
+};
+
+struct zwp_virtual_keyboard_v1 *bench_keyboard(struct xkb_keymap **keymap) {
+  struct xkb_context *ctx = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+  char path[] = "/tmp/somewm-keymap-XXXXXX", *s;
+  struct zwp_virtual_keyboard_v1 *kbd;
+  size_t len;
+  int fd;
+
+  if (!bench_kbdmgr || !bench_seat)
+    bench_die("compositor lacks the virtual keyboard protocol");
+  if (!ctx || !(*keymap = xkb_keymap_new_from_names(
+                    ctx, NULL, XKB_KEYMAP_COMPILE_NO_FLAGS)))
+    bench_die("cannot compile a keymap");
+
+  s = xkb_keymap_get_as_string(*keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
+  len = strlen(s) + 1;
+  if ((fd = mkstemp(path)) < 0 || write(fd, s, len) != (ssize_t)len)
+    bench_die("cannot write the keymap");
+  unlink(path);
+  free(s);
+
+  kbd = zwp_virtual_keyboard_manager_v1_create_virtual_keyboard(bench_kbdmgr,
+                                                                bench_seat);
+  zwp_virtual_keyboard_v1_keymap(kbd, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, fd,
+                                 (uint32_t)len);
+  close(fd);
+  xkb_context_unref(ctx);
+  return kbd;
+}
+
+struct zwlr_virtual_pointer_v1 *bench_pointer(int onoutput) {
+  if (!bench_ptrmgr)
+    bench_die("compositor lacks the virtual pointer protocol");
+  if (onoutput && bench_output &&
+      zwlr_virtual_pointer_manager_v1_get_version(bench_ptrmgr) >= 2)
+    return zwlr_virtual_pointer_manager_v1_create_virtual_pointer_with_output(
+        bench_ptrmgr, bench_seat, bench_output);
+  return zwlr_virtual_pointer_manager_v1_create_virtual_pointer(bench_ptrmgr,
+                                                                bench_seat);
+}
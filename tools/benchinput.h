@@ -0,0 +1,26 @@
+/*
+ * Virtual input devices for the benchmark tools that inject input
+ * (inputbench, replay), on top of benchwl.h.
+ */
+#ifndef BENCHINPUT_H
+#define BENCHINPUT_H
+
+#include <xkbcommon/xkbcommon.h>
+
+#include "benchwl.h"
+#include "virtual-keyboard-unstable-v1-client-protocol.h"
+#include "wlr-virtual-pointer-unstable-v1-client-protocol.h"
+
+/* pass to bench_connect() to bind both managers */
+extern const BenchGlobal bench_input_globals[2];
+extern struct zwp_virtual_keyboard_manager_v1 *bench_kbdmgr;
+extern struct zwlr_virtual_pointer_manager_v1 *bench_ptrmgr;
+
+/* a virtual keyboard using the default xkb keymap, which is returned in
+ * *keymap for looking up keycodes and modifier masks */
+struct zwp_virtual_keyboard_v1 *bench_keyboard(struct xkb_keymap **keymap);
+/* a virtual pointer whose absolute motion spans the first output if
+ * onoutput is set, the whole layout otherwise */
+struct zwlr_virtual_pointer_v1 *bench_pointer(int onoutput);
+
+#endif
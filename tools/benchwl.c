@@ -0,0 +1,325 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "benchwl.h"
+
+struct wl_display *bench_dpy;
+struct wl_compositor *bench_compositor;
+struct wl_seat *bench_seat;
+struct wl_output *bench_output;
+struct wl_buffer *bench_small, *bench_large;
+size_t bench_nconfigured;
+
+typedef struct SizedBuffer {
+  struct SizedBuffer *next;
+  struct wl_buffer *buffer;
+  int width, height;
+} SizedBuffer;
+
+static struct wl_shm *shm;
+static struct xdg_wm_base *wmbase;
+static SizedBuffer *buffers;
+static const BenchGlobal *extras;
+static size_t nextras;
+static int ipcfd = -1;
+
+void bench_die(const char *msg) {
+  fprintf(stderr, "bench: %s\n", msg);
+  exit(1);
+}
+
+double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void wmbase_ping(void *data, struct xdg_wm_base *b, uint32_t serial) {
+  xdg_wm_base_pong(b, serial);
+}
+
+static const struct xdg_wm_base_listener wmbase_listener = {
+    .ping = wmbase_ping,
+};
+
+static void registry_global(void *data, struct wl_registry *r, uint32_t name,
+                            const char *iface, uint32_t version) {
+  size_t i;
+
+  if (!strcmp(iface, wl_compositor_interface.name))
+    bench_compositor = wl_registry_bind(r, name, &wl_compositor_interface, 4);
+  else if (!strcmp(iface, wl_shm_interface.name))
+    shm = wl_registry_bind(r, name, &wl_shm_interface, 1);
+  else if (!strcmp(iface, wl_seat_interface.name) && !bench_seat)
+    bench_seat = wl_registry_bind(r, name, &wl_seat_interface, 1);
+  else if (!strcmp(iface, wl_output_interface.name) && !bench_output)
+    bench_output = wl_registry_bind(r, name, &wl_output_interface, 1);
+  else if (!strcmp(iface, xdg_wm_base_interface.name)) {
+    wmbase = wl_registry_bind(r, name, &xdg_wm_base_interface, 1);
+    xdg_wm_base_add_listener(wmbase, &wmbase_listener, NULL);
+  }
+  for (i = 0; i < nextras; i++)
+    if (!strcmp(iface, extras[i].iface->name) && !*extras[i].proxy)
+      *extras[i].proxy = wl_registry_bind(
+          r, name, extras[i].iface,
+          version < extras[i].version ? version : extras[i].version);
+}
+
+static void registry_global_remove(void *data, struct wl_registry *r,
+                                   uint32_t name) {}
+
+static const struct wl_registry_listener registry_listener = {
+    .global = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+/* Buffers are never written after creation, so any number of surfaces may
+ * show the same one at once */
+struct wl_buffer *bench_buffer(int width, int height) {
+  size_t size = (size_t)width * (size_t)height * 4;
+  char path[] = "/tmp/somewm-bench-XXXXXX";
+  struct wl_shm_pool *pool;
+  SizedBuffer *b;
+  void *data;
+  int fd;
+
+  for (b = buffers; b; b = b->next)
+    if (b->width == width && b->height == height)
+      return b->buffer;
+  if (width <= 0 || height <= 0 || size > INT32_MAX)
+    bench_die("bad buffer size");
+
+  if ((fd = mkstemp(path)) < 0)
+    bench_die("mkstemp");
+  unlink(path);
+  if (ftruncate(fd, (off_t)size) < 0)
+    bench_die("ftruncate");
+  if ((data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) ==
+      MAP_FAILED)
+    bench_die("mmap");
+  memset(data, 0x80, size);
+  munmap(data, size);
+
+  if (!(b = calloc(1, sizeof(*b))))
+    bench_die("out of memory");
+  pool = wl_shm_create_pool(shm, fd, (int32_t)size);
+  b->buffer = wl_shm_pool_create_buffer(pool, 0, width, height, width * 4,
+                                        WL_SHM_FORMAT_XRGB8888);
+  b->width = width;
+  b->height = height;
+  b->next = buffers;
+  buffers = b;
+  wl_shm_pool_destroy(pool);
+  close(fd);
+  return b->buffer;
+}
+
+static void ipc_connect(void) {
+  struct sockaddr_un addr = {.sun_family = AF_UNIX};
+  const char *path = getenv("SOMEWM_SOCK");
+
+  if (!path || strlen(path) >= sizeof(addr.sun_path))
+    bench_die("SOMEWM_SOCK is not set");
+  strcpy(addr.sun_path, path);
+  if ((ipcfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+      connect(ipcfd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    bench_die("cannot connect to SOMEWM_SOCK");
+}
+
+void bench_connect(const BenchGlobal *extra, size_t nextra) {
+  struct wl_registry *registry;
+
+  extras = extra;
+  nextras = nextra;
+  if (!(bench_dpy = wl_display_connect(NULL)))
+    bench_die("cannot connect to the Wayland display");
+  registry = wl_display_get_registry(bench_dpy);
+  wl_registry_add_listener(registry, &registry_listener, NULL);
+  wl_display_roundtrip(bench_dpy);
+  if (!bench_compositor || !shm || !wmbase)
+    bench_die("compositor lacks wl_compositor, wl_shm or xdg_wm_base");
+  bench_small = bench_buffer(BENCH_SMALL_W, BENCH_SMALL_H);
+  bench_large = bench_buffer(BENCH_LARGE_W, BENCH_LARGE_H);
+  ipc_connect();
+}
+
+void bench_disconnect(void) {
+  close(ipcfd);
+  wl_display_disconnect(bench_dpy);
+}
+
+void bench_window_present(BenchWindow *w, struct wl_buffer *buf) {
+  wl_surface_attach(w->surface, buf, 0, 0);
+  wl_surface_damage_buffer(w->surface, 0, 0, INT32_MAX, INT32_MAX);
+  wl_surface_commit(w->surface);
+}
+
+static void xdgsurface_configure(void *data, struct xdg_surface *s,
+                                 uint32_t serial) {
+  BenchWindow *w = data;
+
+  xdg_surface_ack_configure(s, serial);
+  if (!w->configured) {
+    /* the first buffer maps the window */
+    w->configured = 1;
+    bench_nconfigured++;
+    bench_window_present(w, w->buffer ? w->buffer : bench_small);
+  }
+}
+
+static const struct xdg_surface_listener xdgsurface_listener = {
+    .configure = xdgsurface_configure,
+};
+
+static void toplevel_configure(void *data, struct xdg_toplevel *t, int32_t w,
+                               int32_t h, struct wl_array *states) {}
+
+static void toplevel_close(void *data, struct xdg_toplevel *t) {}
+
+static const struct xdg_toplevel_listener toplevel_listener = {
+    .configure = toplevel_configure,
+    .close = toplevel_close,
+};
+
+void bench_window_create(BenchWindow *w, const char *appid,
+                         const char *title) {
+  w->configured = 0;
+  w->surface = wl_compositor_create_surface(bench_compositor);
+  w->xdg = xdg_wm_base_get_xdg_surface(wmbase, w->surface);
+  xdg_surface_add_listener(w->xdg, &xdgsurface_listener, w);
+  w->toplevel = xdg_surface_get_toplevel(w->xdg);
+  xdg_toplevel_add_listener(w->toplevel, &toplevel_listener, w);
+  xdg_toplevel_set_title(w->toplevel, title);
+  xdg_toplevel_set_app_id(w->toplevel, appid ? appid : "somewm-bench");
+  wl_surface_commit(w->surface);
+}
+
+void bench_window_wait(size_t n) {
+  while (bench_nconfigured < n)
+    if (wl_display_dispatch(bench_dpy) < 0)
+      bench_die("lost the compositor");
+  wl_display_roundtrip(bench_dpy);
+}
+
+void bench_window_destroy(BenchWindow *w) {
+  xdg_toplevel_destroy(w->toplevel);
+  xdg_surface_destroy(w->xdg);
+  wl_surface_destroy(w->surface);
+  if (w->configured)
+    bench_nconfigured--;
+}
+
+static void frame_done(void *data, struct wl_callback *cb, uint32_t time) {
+  wl_callback_destroy(cb);
+  *(int *)data = 1;
+}
+
+static const struct wl_callback_listener frame_listener = {
+    .done = frame_done,
+};
+
+int bench_window_frame(BenchWindow *w, struct wl_buffer *buf,
+                       int timeout_ms) {
+  static int done;
+  struct wl_callback *cb;
+
+  /* a callback left over from a timed-out frame may end this wait early */
+  done = 0;
+  cb = wl_surface_frame(w->surface);
+  wl_callback_add_listener(cb, &frame_listener, &done);
+  bench_window_present(w, buf);
+  return bench_waitfor(&done, timeout_ms);
+}
+
+int bench_waitfor(const int *flag, int timeout_ms) {
+  double deadline = bench_now_ms() + timeout_ms;
+  struct pollfd pfd = {.fd = wl_display_get_fd(bench_dpy), .events = POLLIN};
+  int left;
+
+  while (!*flag) {
+    while (wl_display_prepare_read(bench_dpy) != 0)
+      wl_display_dispatch_pending(bench_dpy);
+    wl_display_flush(bench_dpy);
+    if ((left = (int)(deadline - bench_now_ms())) <= 0 ||
+        poll(&pfd, 1, left) <= 0) {
+      wl_display_cancel_read(bench_dpy);
+      return *flag;
+    }
+    if (wl_display_read_events(bench_dpy) < 0)
+      bench_die("lost the compositor");
+    wl_display_dispatch_pending(bench_dpy);
+  }
+  return 1;
+}
+
+static void readall(void *buf, size_t n) {
+  char *p = buf;
+  ssize_t r;
+
+  while (n) {
+    if ((r = read(ipcfd, p, n)) < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      bench_die("IPC connection closed");
+    p += r;
+    n -= (size_t)r;
+  }
+}
+
+static void writeall(const void *buf, size_t n) {
+  const char *p = buf;
+  ssize_t r;
+
+  while (n) {
+    if ((r = write(ipcfd, p, n)) < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      bench_die("IPC connection closed");
+    p += r;
+    n -= (size_t)r;
+  }
+}
+
+char *bench_ipc(const char *type, long arg) {
+  char req[128], *reply, *result;
+  unsigned char hdr[4];
+  uint32_t len;
+  int n;
+
+  n = snprintf(req, sizeof(req), "{\"type\":\"%s\",\"arg\":%ld}", type, arg);
+  len = (uint32_t)n;
+  hdr[0] = len & 0xff;
+  hdr[1] = len >> 8 & 0xff;
+  hdr[2] = len >> 16 & 0xff;
+  hdr[3] = len >> 24 & 0xff;
+  writeall(hdr, 4);
+  writeall(req, len);
+
+  readall(hdr, 4);
+  len = (uint32_t)hdr[0] | (uint32_t)hdr[1] << 8 | (uint32_t)hdr[2] << 16 |
+        (uint32_t)hdr[3] << 24;
+  if (!(reply = malloc(len + 1)))
+    bench_die("out of memory");
+  readall(reply, len);
+  reply[len] = '\0';
+  /* {"type":..,"success":true,"result":<json>} */
+  if (!(result = strstr(reply, "\"result\":"))) {
+    fprintf(stderr, "bench: %s failed: %s\n", type, reply);
+    exit(1);
+  }
+  result += strlen("\"result\":");
+  memmove(reply, result, strlen(result) + 1);
+  if (*reply)
+    reply[strlen(reply) - 1] = '\0';
+  return reply;
+}
@@ -0,0 +1,72 @@
+/*
+ * Shared client side of the benchmark tools (benchclient, inputbench).
+ *
+ * bench_connect() binds the globals every tool needs, plus any extra ones
+ * the caller lists, and opens the IPC socket named by SOMEWM_SOCK.  Windows
+ * are xdg toplevels showing one of two shared shm buffers; they map as soon
+ * as their first configure arrives.  bench_ipc() blocks for the reply; the
+ * IPC socket is not ordered against the Wayland one, so do a roundtrip first
+ * if the request depends on Wayland requests just sent.
+ */
+#ifndef BENCHWL_H
+#define BENCHWL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <wayland-client.h>
+
+#include "xdg-shell-client-protocol.h"
+
+#define BENCH_SMALL_W 120
+#define BENCH_SMALL_H 80
+#define BENCH_LARGE_W 240
+#define BENCH_LARGE_H 160
+
+typedef struct {
+  const struct wl_interface *iface;
+  uint32_t version;
+  void **proxy; /* set to the bound global; stays NULL if not advertised */
+} BenchGlobal;
+
+typedef struct {
+  struct wl_surface *surface;
+  struct xdg_surface *xdg;
+  struct xdg_toplevel *toplevel;
+  struct wl_buffer *buffer; /* shown on map; bench_small if NULL */
+  int configured;
+} BenchWindow;
+
+extern struct wl_display *bench_dpy;
+extern struct wl_compositor *bench_compositor;
+extern struct wl_seat *bench_seat;
+extern struct wl_output *bench_output; /* the first output advertised */
+extern struct wl_buffer *bench_small, *bench_large;
+extern size_t bench_nconfigured; /* windows that received a configure */
+
+void bench_die(const char *msg);
+double bench_now_ms(void);
+
+void bench_connect(const BenchGlobal *extra, size_t nextra);
+void bench_disconnect(void);
+
+/* create, name and commit w; it maps once bench_nconfigured counts it.
+ * appid may be NULL for "somewm-bench". */
+void bench_window_create(BenchWindow *w, const char *appid,
+                         const char *title);
+/* wait until bench_nconfigured reaches n and the compositor caught up */
+void bench_window_wait(size_t n);
+void bench_window_present(BenchWindow *w, struct wl_buffer *buf);
+void bench_window_destroy(BenchWindow *w);
+/* present w again and wait for its frame callback; 0 on timeout */
+int bench_window_frame(BenchWindow *w, struct wl_buffer *buf, int timeout_ms);
+
+/* a blank buffer of the given size, created on first use and kept */
+struct wl_buffer *bench_buffer(int width, int height);
+
+/* dispatch events until *flag is set; 0 if timeout_ms passed first */
+int bench_waitfor(const int *flag, int timeout_ms);
+
+/* send {"type": type, "arg": arg} and return the malloc'd "result" JSON */
+char *bench_ipc(const char *type, long arg);
+
+#endif
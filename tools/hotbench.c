@@ -0,0 +1,204 @@
+/*
+ * Microbenchmark for the per-monitor occupancy/visibility scan.
+ *
+ *   hotbench [n...]   time one scan over n synthetic clients (default 100,
+ *                     1000 and 10000) with the current list walk and with
+ *                     each hotstate implementation
+ *   hotbench -c       only check that every implementation agrees with the
+ *                     list walk, for many sizes; exits nonzero on mismatch
+ *
+ * The list walk mimics dwl.c before the packed arrays: clients are large,
+ * individually allocated structs linked in a list whose order does not
+ * follow their addresses, and VISIBLEON() dereferences c->mon for each.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hotstate.h"
+
+typedef struct FakeMon {
+  unsigned int seltags;
+  uint32_t tagset[2];
+  uint32_t id;
+} FakeMon;
+
+typedef struct FakeClient {
+  struct FakeClient *next;
+  char listeners[640]; /* stands in for the wl_listeners and scene pointers */
+  FakeMon *mon;
+  uint32_t tags;
+  int isfloating, isurgent, isfullscreen;
+} FakeClient;
+
+#define NMONS 3
+#define VISIBLEON(C, M)                                                        \
+  ((M) && (C)->mon == (M) && ((C)->tags & (M)->tagset[(M)->seltags]))
+
+static const char *const implnames[] = {"scalar", "sse2", "avx2"};
+static FakeMon mons[NMONS];
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* n clients mirrored into h; *slots is in slot order, the list is shuffled */
+static FakeClient *build(size_t n, HotState *h, FakeClient ***slots) {
+  FakeClient **v = calloc(n ? n : 1, sizeof(*v)), *head = NULL, *c;
+  FakeClient **order = calloc(n ? n : 1, sizeof(*order));
+  size_t i, j;
+
+  for (i = 0; i < n; i++) {
+    c = v[i] = calloc(1, sizeof(*c));
+    c->mon = rand() % 8 ? &mons[rand() % NMONS] : NULL;
+    c->tags = 1u << (rand() % 9);
+    if (rand() % 4 == 0)
+      c->tags |= 1u << (rand() % 9);
+    c->isurgent = rand() % 10 == 0;
+    c->isfloating = rand() % 3 == 0;
+    hotstate_set(h, i, c->tags, c->mon ? c->mon->id : 0,
+                 (c->isurgent ? HotUrgent : 0) |
+                     (c->isfloating ? HotFloating : 0));
+  }
+  memcpy(order, v, n * sizeof(*order));
+  for (i = n; i > 1; i--) {
+    j = rand() % i;
+    c = order[i - 1];
+    order[i - 1] = order[j];
+    order[j] = c;
+  }
+  for (i = 0; i < n; i++) {
+    order[i]->next = head;
+    head = order[i];
+  }
+  free(order);
+  *slots = v;
+  return head;
+}
+
+static void walk(FakeClient *head, FakeMon *m, HotMasks *out) {
+  FakeClient *c;
+
+  memset(out, 0, sizeof(*out));
+  for (c = head; c; c = c->next) {
+    if (c->mon != m)
+      continue;
+    out->nclients++;
+    out->occupied |= c->tags;
+    if (c->isurgent)
+      out->urgent |= c->tags;
+    if (VISIBLEON(c, m)) {
+      out->nvisible++;
+      out->visible |= c->tags;
+      if (c->isurgent)
+        out->visibleurgent |= c->tags;
+    }
+  }
+}
+
+static void freeall(FakeClient **v, size_t n, HotState *h) {
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    free(v[i]);
+  free(v);
+  hotstate_finish(h);
+}
+
+static int check(void) {
+  HotState h = {0};
+  HotMasks want, got;
+  FakeClient *head, **v;
+  uint64_t *visible;
+  size_t n, i;
+  int impl, m, bad = 0;
+
+  for (n = 0; n < 300; n++) {
+    head = build(n, &h, &v);
+    visible = calloc((n + 63) / 64 + 1, sizeof(*visible));
+    for (impl = HotScalar; impl <= HotAVX2; impl++) {
+      if (hotstate_select(impl) != impl)
+        continue;
+      for (m = 0; m < NMONS; m++) {
+        walk(head, &mons[m], &want);
+        hotstate_scan(&h, mons[m].id, mons[m].tagset[mons[m].seltags], &got,
+                      visible);
+        for (i = 0; i < n; i++)
+          if ((visible[i / 64] >> (i % 64) & 1) != !!VISIBLEON(v[i], &mons[m]))
+            break;
+        if (memcmp(&want, &got, sizeof(want)) || i < n) {
+          fprintf(stderr, "%s: mismatch with %zu clients on monitor %d\n",
+                  implnames[impl], n, m);
+          bad = 1;
+        }
+      }
+    }
+    free(visible);
+    freeall(v, n, &h);
+  }
+  puts(bad ? "FAIL" : "ok");
+  return bad;
+}
+
+static void bench(size_t n) {
+  HotState h = {0};
+  HotMasks r;
+  FakeClient *head, **v;
+  uint32_t sink = 0;
+  double t;
+  size_t iters = 2000000 / (n + 1) + 100, i;
+  int impl, m;
+
+  head = build(n, &h, &v);
+  t = now();
+  for (i = 0; i < iters; i++) {
+    for (m = 0; m < NMONS; m++) {
+      walk(head, &mons[m], &r);
+      sink ^= r.occupied ^ r.visible;
+    }
+  }
+  printf("%6zu clients  list walk %10.1f ns/scan\n", n,
+         (now() - t) / (iters * NMONS));
+  for (impl = HotScalar; impl <= HotAVX2; impl++) {
+    if (hotstate_select(impl) != impl)
+      continue;
+    t = now();
+    for (i = 0; i < iters; i++) {
+      for (m = 0; m < NMONS; m++) {
+        hotstate_scan(&h, mons[m].id, mons[m].tagset[mons[m].seltags], &r,
+                      NULL);
+        sink ^= r.occupied ^ r.visible;
+      }
+    }
+    printf("%6zu clients  %-9s %10.1f ns/scan\n", n, implnames[impl],
+           (now() - t) / (iters * NMONS));
+  }
+  freeall(v, n, &h);
+  if (sink == 0xdeadbeef)
+    puts("");
+}
+
+int main(int argc, char *argv[]) {
+  static const size_t defaults[] = {100, 1000, 10000};
+  int i;
+
+  srand(1);
+  for (i = 0; i < NMONS; i++) {
+    mons[i].id = i + 1;
+    mons[i].tagset[0] = 1u << i | 1u << (i + 3);
+  }
+  if (argc > 1 && !strcmp(argv[1], "-c"))
+    return check();
+  if (argc > 1) {
+    for (i = 1; i < argc; i++)
+      bench(strtoul(argv[i], NULL, 10));
+  } else {
+    for (i = 0; i < 3; i++)
+      bench(defaults[i]);
+  }
+  return 0;
+}
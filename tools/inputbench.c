@@ -0,0 +1,203 @@
+/*
+ * Input-to-frame latency benchmark, run by "make bench" after benchclient.
+ *
+ *   inputbench [-n rounds] [-l key] [-k key]
+ *
+ * Maps a few windows, then injects input through the virtual keyboard and
+ * virtual pointer protocols, waiting for a frame after every injection:
+ *
+ *   lua_key  logo+key (-l, default "f", bound in rc.lua to toggle
+ *            fullscreen; sent twice per round so it toggles back)
+ *   c_key    alt+key (-k, default "j", focusstack in config.h keys[])
+ *   focus    pointer motion between the master and a stack window
+ *   move     alt+button drag of a window, one motion per round
+ *
+ * Prints one JSON line
+ *
+ *   {"rounds":n,"client":{"lua_key":{"avg_ms":..,"max_ms":..,"missed":..},
+ *    ...},"compositor":<result of the "get_stats" IPC request>}
+ *
+ * where "client" is the time from sending the input to the frame callback
+ * of the next frame that includes it, and the compositor's "input" member
+ * splits the same path into handling, scene commit and frame-done.
+ */
+#include <linux/input-event-codes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "benchinput.h"
+
+#define NWINDOWS 4
+#define EXTENT 10000 /* motion_absolute resolution */
+#define FRAME_TIMEOUT_MS 1000
+
+enum { KindLuaKey, KindCKey, KindFocus, KindMove, KindLast };
+
+typedef struct {
+  double total, max;
+  int count, missed;
+} Latency;
+
+static const char *const kindnames[KindLast] = {"lua_key", "c_key", "focus",
+                                                "move"};
+static struct zwp_virtual_keyboard_v1 *kbd;
+static struct zwlr_virtual_pointer_v1 *ptr;
+static BenchWindow windows[NWINDOWS];
+static Latency latency[KindLast];
+static struct xkb_keymap *keymap;
+static uint32_t altmask, logomask;
+
+static uint32_t timestamp(void) {
+  /* 0 would make dwl treat pointer motion as internal */
+  return (uint32_t)bench_now_ms() | 1;
+}
+
+/* Wait for the frame that shows the input just sent and account for it */
+static void settle(int kind, double sent) {
+  Latency *l = &latency[kind];
+  double ms;
+
+  if (!bench_window_frame(&windows[0], bench_small, FRAME_TIMEOUT_MS)) {
+    l->missed++;
+    return;
+  }
+  ms = bench_now_ms() - sent;
+  l->total += ms;
+  if (ms > l->max)
+    l->max = ms;
+  l->count++;
+}
+
+static uint32_t keycode(const char *name) {
+  xkb_keysym_t sym = xkb_keysym_from_name(name, XKB_KEYSYM_NO_FLAGS);
+  xkb_keycode_t kc;
+  const xkb_keysym_t *syms;
+  int i, n;
+
+  for (kc = xkb_keymap_min_keycode(keymap); kc <= xkb_keymap_max_keycode(keymap);
+       kc++) {
+    n = xkb_keymap_key_get_syms_by_level(keymap, kc, 0, 0, &syms);
+    for (i = 0; i < n; i++)
+      if (syms[i] == sym)
+        return kc - 8; /* evdev code */
+  }
+  fprintf(stderr, "inputbench: no key for %s\n", name);
+  exit(1);
+}
+
+static void setmods(uint32_t mods) {
+  zwp_virtual_keyboard_v1_modifiers(kbd, mods, 0, 0, 0);
+}
+
+static void press(uint32_t mods, uint32_t code) {
+  setmods(mods);
+  zwp_virtual_keyboard_v1_key(kbd, timestamp(), code,
+                              WL_KEYBOARD_KEY_STATE_PRESSED);
+  zwp_virtual_keyboard_v1_key(kbd, timestamp(), code,
+                              WL_KEYBOARD_KEY_STATE_RELEASED);
+  setmods(0);
+}
+
+/* Move the pointer to (fx, fy), fractions of the first output */
+static void pointerto(double fx, double fy) {
+  zwlr_virtual_pointer_v1_motion_absolute(ptr, timestamp(),
+                                          (uint32_t)(fx * EXTENT),
+                                          (uint32_t)(fy * EXTENT), EXTENT,
+                                          EXTENT);
+  zwlr_virtual_pointer_v1_frame(ptr);
+}
+
+static void button(uint32_t state) {
+  zwlr_virtual_pointer_v1_button(ptr, timestamp(), BTN_LEFT, state);
+  zwlr_virtual_pointer_v1_frame(ptr);
+}
+
+int main(int argc, char *argv[]) {
+  const char *luakey = "f", *ckey = "j";
+  uint32_t luacode, ccode;
+  int rounds = 100, opt, i;
+  char title[32], *stats;
+  double sent;
+
+  while ((opt = getopt(argc, argv, "n:l:k:")) != -1) {
+    if (opt == 'n')
+      rounds = atoi(optarg);
+    else if (opt == 'l')
+      luakey = optarg;
+    else if (opt == 'k')
+      ckey = optarg;
+    else {
+      fprintf(stderr, "usage: inputbench [-n rounds] [-l key] [-k key]\n");
+      return 1;
+    }
+  }
+
+  bench_connect(bench_input_globals, 2);
+  kbd = bench_keyboard(&keymap);
+  ptr = bench_pointer(1);
+  altmask = 1u << xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_ALT);
+  logomask = 1u << xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_LOGO);
+  luacode = keycode(luakey);
+  ccode = keycode(ckey);
+
+  /* select the first output before mapping, so the windows tile there */
+  pointerto(0.5, 0.5);
+  free(bench_ipc("view", 1));
+  for (i = 0; i < NWINDOWS; i++) {
+    snprintf(title, sizeof(title), "input %d", i);
+    bench_window_create(&windows[i], NULL, title);
+  }
+  bench_window_wait(NWINDOWS);
+  wl_display_roundtrip(bench_dpy);
+  free(bench_ipc("reset_stats", 0));
+
+  for (i = 0; i < rounds; i++) {
+    sent = bench_now_ms();
+    press(altmask, ccode);
+    settle(KindCKey, sent);
+  }
+  for (i = 0; i < 2 * (rounds / 2); i++) {
+    sent = bench_now_ms();
+    press(logomask, luacode);
+    settle(KindLuaKey, sent);
+  }
+  /* master on the left half, the stack on the right */
+  for (i = 0; i < rounds; i++) {
+    sent = bench_now_ms();
+    pointerto(i % 2 ? 0.25 : 0.75, 0.5);
+    settle(KindFocus, sent);
+  }
+  pointerto(0.25, 0.5);
+  setmods(altmask);
+  button(WL_POINTER_BUTTON_STATE_PRESSED);
+  for (i = 0; i < rounds; i++) {
+    sent = bench_now_ms();
+    zwlr_virtual_pointer_v1_motion(ptr, timestamp(),
+                                   wl_fixed_from_int(i % 2 ? -8 : 8),
+                                   wl_fixed_from_int(i % 2 ? -4 : 4));
+    zwlr_virtual_pointer_v1_frame(ptr);
+    settle(KindMove, sent);
+  }
+  button(WL_POINTER_BUTTON_STATE_RELEASED);
+  setmods(0);
+
+  wl_display_roundtrip(bench_dpy);
+  stats = bench_ipc("get_stats", 0);
+  printf("{\"rounds\":%d,\"client\":{", rounds);
+  for (i = 0; i < KindLast; i++)
+    printf("%s\"%s\":{\"avg_ms\":%.3f,\"max_ms\":%.3f,\"missed\":%d}",
+           i ? "," : "", kindnames[i],
+           latency[i].count ? latency[i].total / latency[i].count : 0.0,
+           latency[i].max, latency[i].missed);
+  printf("},\"compositor\":%s}\n", stats);
+  free(stats);
+
+  for (i = 0; i < NWINDOWS; i++)
+    bench_window_destroy(&windows[i]);
+  zwlr_virtual_pointer_v1_destroy(ptr);
+  zwp_virtual_keyboard_v1_destroy(kbd);
+  xkb_keymap_unref(keymap);
+  bench_disconnect();
+  return 0;
+}
@@ -0,0 +1,852 @@
+/*
+ * Microbenchmarks of the Lua library without a compositor, and a headless
+ * runner for the test_*.lua scripts.
+ *
+ *   luabench [-n iterations] [-p clients] [case...]
+ *                        time the cases (all, or those whose name starts
+ *                        with one of the arguments; default 200000
+ *                        iterations over 100 clients) and print ops/s and
+ *                        allocations per op
+ *   luabench -c          run every case a few times and check the mock
+ *                        against the library; exits nonzero on failure
+ *   luabench -t script...
+ *                        run Lua scripts such as test_*.lua, each in a
+ *                        fresh state; exits nonzero if any raised an error
+ *
+ * Built from luaa.c, luasignal.c and luaobject.c as dwl links them, with
+ * dwl.c replaced by a mock of the wrapper API it implements for luaa.c
+ * (lua_get_*, lua_client_*, lua_find_clients, ...) over synthetic clients
+ * on two monitors.  The mock indexes clients with clientindex.c, invalidates
+ * client properties and emits signals where dwl.c does, so the caches of
+ * core.client and the signal bus see the same traffic as in a session.  Run
+ * from the source tree: the lua/ tree is loaded from ./lua, rc.lua is not.
+ *
+ * The allocator of the Lua state is wrapped to count new blocks and the
+ * bytes requested (new blocks plus growth); the counts for a case start
+ * after a full collection.
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "luaa.h"
+#include "luasignal.h"
+#include "util.h"
+
+#define NMONITORS 2
+#define NTAGS 9
+#define NAPPIDS 16
+#define CHECK_ITERATIONS 10
+
+typedef struct {
+  const char *name;
+  int x, y, width, height;
+  uint32_t tags;
+  float mfact;
+  int nmaster;
+  FrameStats fstat;
+  int overlay, maxrendertime;
+} MockMonitor;
+
+typedef struct {
+  char title[64], appid[32];
+  int pid, x, y, width, height;
+  uint32_t tags;
+  int floating, fullscreen, urgent;
+  MockMonitor *mon;
+  size_t slot;         /* position in clients[] while open */
+  unsigned int retitles;
+  unsigned int maxfps[FpsLast];
+} MockClient;
+
+typedef struct {
+  lua_Alloc alloc;
+  void *ud;
+  size_t blocks, bytes;
+} AllocCount;
+
+static MockMonitor monitors[NMONITORS];
+static MockMonitor *selmon;
+static MockClient *pool;     /* every client ever created */
+static MockClient **clients; /* open clients in list order */
+static size_t nclients;
+static MockClient *focused;
+static ClientIndex *clientidx;
+static AllocCount counter;
+
+/* Each case runs its body iterations times with these locals in scope:
+ * Some, client (core.client), signal (base.signal), rules (core.rules),
+ * mock (the Mock table), raw and c (the first client's handle and object),
+ * all (every client object), n (#all), snap, query and o (a base.object
+ * with a "size" property); i is the loop counter */
+static const char *const cases[][2] = {
+    {"some.client_get_title", "local x = Some.client_get_title(raw)"},
+    {"some.client_get_geometry", "local x = Some.client_get_geometry(raw)"},
+    {"some.client_snapshot", "Some.client_snapshot(raw, snap)"},
+    {"some.client_find", "local x = Some.client_find(query)"},
+    {"some.client_get_all", "local x = Some.client_get_all()"},
+    {"client.title", "local x = c.title"},
+    {"client.geometry", "local x = c.geometry"},
+    {"client.title, retitled", "mock.retitle(1) local x = c.title"},
+    {"client.get_all", "local x = client.get_all()"},
+    {"object.read property", "local x = o.size"},
+    {"object.write property", "o.size = i"},
+    {"object.write field, 1 cb", "o.m = i"},
+    {"signal.emit, 0 cbs", "signal.emit('bench::none', i)"},
+    {"signal.emit, 1 cb", "signal.emit('bench::one', i)"},
+    {"signal.emit, 10 cbs", "signal.emit('bench::ten', i)"},
+    {"rules.match", "rules.apply_to_client(all[i % n + 1])"},
+};
+
+/* Builds the locals of the cases.  The rules bucket on appid like a typical
+ * config: one per synthetic appid, a few title patterns and a catch-all
+ * predicate, so most clients match two or three of them. */
+static const char setup[] =
+    "local somewm = require('somewm')\n"
+    "local base, core = somewm.base, somewm.core\n"
+    "base.logger.set_level('warn')\n"
+    "local env = {Some = Some, client = core.client, signal = base.signal,\n"
+    "  rules = core.rules, mock = Mock, snap = {},\n"
+    "  query = {appid = 'app1'}}\n"
+    "env.all = core.client.get_all()\n"
+    "env.n = #env.all\n"
+    "env.c = env.all[1]\n"
+    "env.raw = Some.client_get_all()[1]\n"
+    "local cls = base.object.class()\n"
+    "cls:add_property('size', {\n"
+    "  getter = function(self) return self:get_private().size or 0 end,\n"
+    "  setter = function(self, v) self:set_private('size', v) end})\n"
+    "env.o = cls:new()\n"
+    "env.o:connect_signal('property::m', function() end)\n"
+    "base.signal.connect('bench::one', function() end)\n"
+    "for _ = 1, 10 do base.signal.connect('bench::ten', function() end) end\n"
+    "for k = 0, 15 do\n"
+    "  core.rules.add({rule = {appid = 'app' .. k},\n"
+    "    properties = {bench_app = k}})\n"
+    "end\n"
+    "for k = 0, 3 do\n"
+    "  core.rules.add({rule = {title = '^client ' .. k},\n"
+    "    properties = {bench_title = k}})\n"
+    "end\n"
+    "core.rules.add({rule = {floating = true}, properties = {bench_float = true}})\n"
+    "return env\n";
+
+/* Run by -c after the cases: the library must see what the mock holds */
+static const char checks[] =
+    "local env = ...\n"
+    "local c, raw = env.c, env.raw\n"
+    "assert(env.n == #Some.client_get_all())\n"
+    "assert(c.appid == 'app0' and c.title:find('^client 0'))\n"
+    "local title = c.title\n"
+    "env.mock.retitle(1)\n"
+    "assert(c.title ~= title and c.title == Some.client_get_title(raw))\n"
+    "local snap = Some.client_snapshot(raw)\n"
+    "assert(snap.width == c.geometry.width and snap.tags == c.tags)\n"
+    "for _, h in ipairs(Some.client_find(env.query)) do\n"
+    "  assert(Some.client_get_appid(h) == 'app1')\n"
+    "end\n"
+    "assert(#Some.client_find(env.query) == (env.n + 14) // 16)\n"
+    "assert(env.all[2]:get_private().bench_app == 1)\n"
+    "local got\n"
+    "env.client.connect_signal('floating', function(cl, on) got = on end)\n"
+    "c.floating = not c.floating\n"
+    "assert(got == c.floating)\n"
+    "local m = Some.monitor_get_focused()\n"
+    "local fs = Some.monitor_get_frame_stats(m)\n"
+    "assert(fs.refresh_hz == 60 and fs.width == 1920 and fs.skipped.gamma == 0)\n"
+    "Some.monitor_set_frame_overlay(m, true)\n"
+    "assert(Some.monitor_get_frame_overlay(m))\n"
+    "Some.monitor_set_frame_overlay(m, false)\n"
+    "Some.monitor_set_max_render_time(m, -1)\n"
+    "assert(Some.monitor_get_max_render_time(m) == -1)\n"
+    "assert(not pcall(Some.monitor_set_max_render_time, m, -2))\n"
+    "Some.monitor_set_max_render_time(m, 0)\n"
+    "c.max_fps = {focused = 60, visible = 30}\n"
+    "local fps = c.max_fps\n"
+    "assert(fps.focused == 60 and fps.unfocused == 30)\n"
+    "c.max_fps = 0\n"
+    "assert(select('#', Some.client_get_max_fps(raw)) == 2)\n"
+    "assert(not pcall(Some.client_set_max_fps, raw, -1))\n"
+    "assert(Some.client_get_commit_stats(raw).commits == 0)\n"
+    "local ping = Some.client_get_responsiveness(raw)\n"
+    "assert(ping.responsive and ping.latency.count == 0 and c.responsive)\n"
+    "local ruled = 0\n"
+    "env.rules.add({rule = {appid = 'app5'}, properties = {ruled = true},\n"
+    "  callback = function() ruled = ruled + 1 end})\n"
+    "env.mock.remap(6)\n"
+    "env.mock.remap(6)\n"
+    "assert(ruled == 1 and env.all[6]:get_private().ruled)\n"
+    "local tested = 0\n"
+    "env.rules.add({rule = {appid = 'app2'}, stop_processing = true})\n"
+    "env.rules.add({rule = {title = function(t)\n"
+    "  tested = tested + 1 return t:find('%(%d+%)$') ~= nil end},\n"
+    "  properties = {retitled = true}})\n"
+    "env.mock.remap(2)\n"
+    "assert(tested == 1 and not env.all[2]:get_private().retitled)\n"
+    "env.mock.retitle(2)\n"
+    "assert(env.all[2]:get_private().retitled)\n"
+    "env.mock.remap(3)\n"
+    "env.mock.retitle(3)\n"
+    "assert(tested == 2 and not env.all[3]:get_private().retitled)\n"
+    "env.rules.add({rule = {appid = 'app3', floating = false},\n"
+    "  properties = {floating = true}})\n"
+    "env.rules.add({rule = {appid = 'app3', floating = false},\n"
+    "  properties = {still_tiled = true}})\n"
+    "env.mock.remap(4)\n"
+    "assert(env.all[4].floating and not env.all[4]:get_private().still_tiled)\n"
+    "return true\n";
+
+/* Mock of the dwl.c side */
+
+static void reindex(MockClient *c) {
+  clientindex_update(clientidx, c, c->appid, c->title, c->pid, c->tags, c->mon);
+}
+
+static void mock_create(size_t n) {
+  static const char *const names[NMONITORS] = {"HEADLESS-1", "HEADLESS-2"};
+  MockClient *c;
+  size_t i;
+  int m;
+
+  for (m = 0; m < NMONITORS; m++)
+    monitors[m] = (MockMonitor){.name = names[m], .x = 1920 * m, .width = 1920,
+                                .height = 1080, .tags = 1, .mfact = 0.55f,
+                                .nmaster = 1};
+  selmon = &monitors[0];
+  clientidx = clientindex_create();
+  pool = ecalloc(n ? n : 1, sizeof(*pool));
+  clients = ecalloc(n ? n : 1, sizeof(*clients));
+  for (i = 0; i < n; i++) {
+    c = clients[i] = &pool[i];
+    snprintf(c->title, sizeof(c->title), "client %zu", i);
+    snprintf(c->appid, sizeof(c->appid), "app%zu", i % NAPPIDS);
+    c->pid = 1000 + (int)i;
+    c->mon = &monitors[i % NMONITORS];
+    c->tags = 1u << (i / NMONITORS % NTAGS);
+    c->x = c->mon->x + (int)(i % 4) * 480;
+    c->y = (int)(i / 4 % 4) * 270;
+    c->width = 480;
+    c->height = 270;
+    c->floating = i % 5 == 4;
+    c->slot = i;
+    reindex(c);
+  }
+  nclients = n;
+  focused = n ? clients[0] : NULL;
+}
+
+/* Tell a fresh Lua state about the clients, as mapnotify() does */
+static void mock_map(void) {
+  size_t i;
+
+  for (i = 0; i < nclients; i++) {
+    lua_client_mapped(clients[i]);
+    SIGEMIT(SigClientMap, ARGCLIENT(clients[i]));
+  }
+}
+
+static void mock_destroy(void) {
+  clientindex_destroy(clientidx);
+  free(clients);
+  free(pool);
+  clientidx = NULL;
+  clients = NULL;
+  pool = NULL;
+  nclients = 0;
+  focused = NULL;
+}
+
+static int l_mock_retitle(lua_State *l) {
+  lua_Integer i = luaL_checkinteger(l, 1);
+  MockClient *c;
+
+  luaL_argcheck(l, i >= 1 && (size_t)i <= nclients, 1, "no such client");
+  c = clients[i - 1];
+  snprintf(c->title, sizeof(c->title), "client %zu (%u)", c->slot,
+           ++c->retitles);
+  lua_client_invalidate(c, ClientPropTitle);
+  reindex(c);
+  SIGEMIT(SigClientTitle, ARGCLIENT(c));
+  return 0;
+}
+
+/* Hide and show a client again, as dwl unmaps and maps it */
+static int l_mock_remap(lua_State *l) {
+  lua_Integer i = luaL_checkinteger(l, 1);
+
+  luaL_argcheck(l, i >= 1 && (size_t)i <= nclients, 1, "no such client");
+  SIGEMIT(SigClientUnmap, ARGCLIENT(clients[i - 1]));
+  SIGEMIT(SigClientMap, ARGCLIENT(clients[i - 1]));
+  return 0;
+}
+
+int lua_get_client_count(void) {
+  return (int)nclients;
+}
+
+void *lua_get_focused_client(void) {
+  return focused;
+}
+
+const char *lua_get_client_title(void *client) {
+  MockClient *c = client;
+  return c ? c->title : NULL;
+}
+
+const char *lua_get_client_appid(void *client) {
+  MockClient *c = client;
+  return c ? c->appid : NULL;
+}
+
+int lua_get_client_pid(void *client) {
+  MockClient *c = client;
+  return c ? c->pid : -1;
+}
+
+void lua_get_client_geometry(void *client, int *x, int *y, int *w, int *h) {
+  MockClient *c = client;
+  if (!c)
+    return;
+  if (x) *x = c->x;
+  if (y) *y = c->y;
+  if (w) *w = c->width;
+  if (h) *h = c->height;
+}
+
+uint32_t lua_get_client_tags(void *client) {
+  MockClient *c = client;
+  return c ? c->tags : 0;
+}
+
+int lua_get_client_floating(void *client) {
+  MockClient *c = client;
+  return c ? c->floating : 0;
+}
+
+int lua_get_client_fullscreen(void *client) {
+  MockClient *c = client;
+  return c ? c->fullscreen : 0;
+}
+
+void *lua_get_client_by_index(int i) {
+  return i >= 0 && (size_t)i < nclients ? clients[i] : NULL;
+}
+
+void *lua_get_next_client(void *prev) {
+  size_t next = prev ? ((MockClient *)prev)->slot + 1 : 0;
+  return next < nclients ? clients[next] : NULL;
+}
+
+size_t lua_find_clients(const ClientQuery *q, void **out, size_t max) {
+  return clientindex_find(clientidx, q, out, max);
+}
+
+void lua_get_client_snapshot(void *client, LuaClientSnapshot *out) {
+  MockClient *c = client;
+  out->title = c->title;
+  out->appid = c->appid;
+  out->pid = c->pid;
+  out->x = c->x;
+  out->y = c->y;
+  out->width = c->width;
+  out->height = c->height;
+  out->tags = c->tags;
+  out->floating = c->floating;
+  out->fullscreen = c->fullscreen;
+  out->urgent = c->urgent;
+  out->visible = c->mon && (c->tags & c->mon->tags);
+  out->monitor = c->mon;
+}
+
+void lua_client_focus(void *client) {
+  MockClient *c = client;
+  if (!c || c == focused)
+    return;
+  if (focused)
+    SIGEMIT(SigClientUnfocus, ARGCLIENT(focused));
+  focused = c;
+  selmon = c->mon;
+  SIGEMIT(SigClientFocus, ARGCLIENT(c));
+}
+
+/* Closing unmaps at once; the client stays allocated so stale handles in
+ * Lua are caught by the reference tracking rather than reading freed
+ * memory */
+void lua_client_close(void *client) {
+  MockClient *c = client;
+  size_t i;
+
+  if (!c || c->slot >= nclients || clients[c->slot] != c)
+    return;
+  for (i = c->slot; i + 1 < nclients; i++) {
+    clients[i] = clients[i + 1];
+    clients[i]->slot = i;
+  }
+  nclients--;
+  c->slot = (size_t)-1;
+  clientindex_remove(clientidx, c);
+  if (focused == c)
+    focused = nclients ? clients[0] : NULL;
+  /* dwl unmaps a client before destroying it */
+  SIGEMIT(SigClientUnmap, ARGCLIENT(c));
+  lua_client_destroyed(c);
+}
+
+void lua_kill_client(void *client) {
+  lua_client_close(client);
+}
+
+void lua_client_set_floating(void *client, int floating) {
+  MockClient *c = client;
+  if (!c)
+    return;
+  if (c->floating != !!floating) {
+    c->floating = !!floating;
+    lua_client_invalidate(c, ClientPropFloating);
+  }
+  SIGEMIT(SigClientFloating, ARGCLIENT(c), ARGBOOL("state", floating));
+}
+
+void lua_client_set_fullscreen(void *client, int fullscreen) {
+  MockClient *c = client;
+  if (!c)
+    return;
+  if (c->fullscreen != !!fullscreen) {
+    c->fullscreen = !!fullscreen;
+    lua_client_invalidate(c, ClientPropFullscreen);
+  }
+  SIGEMIT(SigClientFullscreen, ARGCLIENT(c), ARGBOOL("state", fullscreen));
+}
+
+void lua_client_set_geometry(void *client, int x, int y, int w, int h) {
+  MockClient *c = client;
+  struct {
+    int x, y, width, height;
+  } old, geom = {x, y, w, h};
+
+  if (!c)
+    return;
+  old.x = c->x, old.y = c->y, old.width = c->width, old.height = c->height;
+  if (!memcmp(&old, &geom, sizeof(old)))
+    return;
+  c->x = x, c->y = y, c->width = w, c->height = h;
+  lua_client_invalidate(c, ClientPropGeometry);
+  SIGEMIT(SigClientGeometry, ARGCLIENT(c), ARGBOX("old", old),
+          ARGBOX("new", geom));
+}
+
+void lua_client_set_tags(void *client, uint32_t tags) {
+  MockClient *c = client;
+  if (!c || !tags || c->tags == tags)
+    return;
+  c->tags = tags;
+  reindex(c);
+  lua_client_invalidate(c, ClientPropTags);
+}
+
+void lua_client_set_max_fps(void *client, const unsigned int fps[FpsLast]) {
+  MockClient *c = client;
+  if (c)
+    memcpy(c->maxfps, fps, sizeof(c->maxfps));
+}
+
+void lua_client_get_max_fps(void *client, unsigned int fps[FpsLast]) {
+  MockClient *c = client;
+  if (c)
+    memcpy(fps, c->maxfps, sizeof(c->maxfps));
+}
+
+void lua_get_client_commit_stats(void *client, LuaCommitStats *out) {
+  /* the mock never commits */
+  memset(out, 0, sizeof(*out));
+}
+
+void lua_get_client_ping_stats(void *client, LuaPingStats *out) {
+  /* the mock always answers */
+  memset(out, 0, sizeof(*out));
+  out->responsive = 1;
+}
+
+int lua_get_monitor_count(void) {
+  return NMONITORS;
+}
+
+void *lua_get_focused_monitor(void) {
+  return selmon;
+}
+
+void *lua_get_monitor_by_index(int i) {
+  return i >= 0 && i < NMONITORS ? &monitors[i] : NULL;
+}
+
+const char *lua_get_monitor_name(void *monitor) {
+  MockMonitor *m = monitor;
+  return m ? m->name : NULL;
+}
+
+void lua_get_monitor_geometry(void *monitor, int *x, int *y, int *width,
+                              int *height) {
+  MockMonitor *m = monitor;
+  if (m) {
+    *x = m->x;
+    *y = m->y;
+    *width = m->width;
+    *height = m->height;
+  }
+}
+
+void lua_get_monitor_workarea(void *monitor, int *x, int *y, int *width,
+                              int *height) {
+  lua_get_monitor_geometry(monitor, x, y, width, height);
+}
+
+const char *lua_get_monitor_layout_symbol(void *monitor) {
+  return monitor ? "[]=" : NULL;
+}
+
+float lua_get_monitor_master_factor(void *monitor) {
+  MockMonitor *m = monitor;
+  return m ? m->mfact : 0.0f;
+}
+
+int lua_get_monitor_master_count(void *monitor) {
+  MockMonitor *m = monitor;
+  return m ? m->nmaster : 0;
+}
+
+uint32_t lua_get_monitor_tags(void *monitor) {
+  MockMonitor *m = monitor;
+  return m ? m->tags : 0;
+}
+
+int lua_get_monitor_enabled(void *monitor) {
+  return monitor != NULL;
+}
+
+void lua_focus_monitor(void *monitor) {
+  if (monitor)
+    selmon = monitor;
+}
+
+void lua_set_monitor_tags(void *monitor, uint32_t tags) {
+  MockMonitor *m = monitor;
+  uint32_t old;
+
+  if (!m || !tags || m->tags == tags)
+    return;
+  old = m->tags;
+  m->tags = tags;
+  SIGEMIT(SigTagView, ARGMONITOR(m), ARGINT("old", old), ARGINT("new", tags));
+}
+
+void lua_set_monitor_master_factor(void *monitor, float factor) {
+  MockMonitor *m = monitor;
+  if (m && factor > 0.0f && factor < 1.0f)
+    m->mfact = factor;
+}
+
+void lua_set_monitor_master_count(void *monitor, int count) {
+  MockMonitor *m = monitor;
+  if (m && count >= 0)
+    m->nmaster = count;
+}
+
+int lua_get_monitor_frame_stats(void *monitor, FrameStats *out) {
+  MockMonitor *m = monitor;
+  if (!m)
+    return 0;
+  *out = m->fstat;
+  out->refresh_mhz = 60000;
+  out->width = m->width;
+  out->height = m->height;
+  return 1;
+}
+
+void lua_reset_monitor_frame_stats(void *monitor) {
+  MockMonitor *m = monitor;
+  if (m)
+    memset(&m->fstat, 0, sizeof(m->fstat));
+}
+
+void lua_set_monitor_frame_overlay(void *monitor, int on) {
+  MockMonitor *m = monitor;
+  if (m)
+    m->overlay = on;
+}
+
+int lua_get_monitor_frame_overlay(void *monitor) {
+  MockMonitor *m = monitor;
+  return m && m->overlay;
+}
+
+void lua_set_monitor_max_render_time(void *monitor, int ms) {
+  MockMonitor *m = monitor;
+  if (m && ms >= -1)
+    m->maxrendertime = ms;
+}
+
+int lua_get_monitor_max_render_time(void *monitor) {
+  MockMonitor *m = monitor;
+  return m ? m->maxrendertime : 0;
+}
+
+int lua_get_tag_count(void) {
+  return NTAGS;
+}
+
+uint32_t lua_get_current_tags(void) {
+  return selmon->tags;
+}
+
+uint32_t lua_get_monitor_current_tags(void *monitor) {
+  return lua_get_monitor_tags(monitor);
+}
+
+void lua_set_current_tags(uint32_t tags) {
+  lua_set_monitor_tags(selmon, tags);
+}
+
+void lua_toggle_tag_view(uint32_t tags) {
+  lua_set_monitor_tags(selmon, selmon->tags ^ tags);
+}
+
+uint32_t lua_get_monitor_occupied_tags(void *monitor) {
+  uint32_t occ = 0;
+  size_t i;
+
+  for (i = 0; i < nclients; i++)
+    if (clients[i]->mon == monitor)
+      occ |= clients[i]->tags;
+  return occ;
+}
+
+uint32_t lua_get_occupied_tags(void) {
+  return lua_get_monitor_occupied_tags(selmon);
+}
+
+uint32_t lua_get_urgent_tags(void) {
+  uint32_t urg = 0;
+  size_t i;
+
+  for (i = 0; i < nclients; i++)
+    if (clients[i]->mon == selmon && clients[i]->urgent)
+      urg |= clients[i]->tags;
+  return urg;
+}
+
+void *lua_create_layer_surface(int width, int height, int layer,
+                               int exclusive_zone, uint32_t anchor) {
+  return NULL; /* nothing to draw on */
+}
+
+void lua_destroy_layer_surface(void *layer_surface) {
+}
+
+/* Harness */
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void *countalloc(void *ud, void *ptr, size_t osize, size_t nsize) {
+  AllocCount *a = ud;
+
+  /* osize is a type tag, not a size, when ptr is NULL */
+  if (nsize && !ptr) {
+    a->blocks++;
+    a->bytes += nsize;
+  } else if (nsize > osize) {
+    a->bytes += nsize - osize;
+  }
+  return a->alloc(a->ud, ptr, osize, nsize);
+}
+
+/* A fresh state over n mock clients, with the allocator counted */
+static int start(size_t n) {
+  mock_create(n);
+  if (init_lua_env())
+    return -1;
+  counter.alloc = lua_getallocf(L, &counter.ud);
+  lua_setallocf(L, countalloc, &counter);
+  lua_newtable(L);
+  lua_pushcfunction(L, l_mock_retitle);
+  lua_setfield(L, -2, "retitle");
+  lua_pushcfunction(L, l_mock_remap);
+  lua_setfield(L, -2, "remap");
+  lua_setglobal(L, "Mock");
+  mock_map();
+  return 0;
+}
+
+static void stop(void) {
+  int fd = dup(2), null = open("/dev/null", O_WRONLY);
+
+  /* cleanup_lua() reports every client handle Lua still holds as a leak;
+   * here they all are, on purpose */
+  if (fd >= 0 && null >= 0)
+    dup2(null, 2);
+  cleanup_lua();
+  if (fd >= 0 && null >= 0)
+    dup2(fd, 2);
+  if (fd >= 0)
+    close(fd);
+  if (null >= 0)
+    close(null);
+  mock_destroy();
+}
+
+/* Run chunk with the value on top of the stack as its argument */
+static int call(const char *chunk, const char *name, int nres) {
+  if (luaL_loadbuffer(L, chunk, strlen(chunk), name) != LUA_OK) {
+    fprintf(stderr, "luabench: %s\n", lua_tostring(L, -1));
+    return -1;
+  }
+  lua_insert(L, -2);
+  if (lua_pcall(L, 1, nres, 0) != LUA_OK) {
+    fprintf(stderr, "luabench: %s: %s\n", name, lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return -1;
+  }
+  return 0;
+}
+
+/* Time case c on the environment at the top of the stack */
+static int runcase(size_t c, long iters, int quiet) {
+  static const char *const locals[] = {
+      "Some", "client", "signal", "rules", "mock", "raw", "c",
+      "all", "n", "snap", "query", "o"};
+  char body[1024];
+  size_t blocks, bytes, i;
+  int len;
+  double t;
+
+  len = snprintf(body, sizeof(body), "local env, iters = ...\n");
+  for (i = 0; i < LENGTH(locals); i++)
+    len += snprintf(body + len, sizeof(body) - (size_t)len,
+                    "local %s = env.%s\n", locals[i], locals[i]);
+  snprintf(body + len, sizeof(body) - (size_t)len,
+           "return function()\n  for i = 1, iters do %s end\nend\n",
+           cases[c][1]);
+
+  lua_pushvalue(L, -1);
+  lua_pushinteger(L, iters);
+  if (luaL_loadbuffer(L, body, strlen(body), cases[c][0]) != LUA_OK ||
+      (lua_insert(L, -3), lua_pcall(L, 2, 1, 0)) != LUA_OK) {
+    fprintf(stderr, "luabench: %s: %s\n", cases[c][0], lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return -1;
+  }
+  lua_gc(L, LUA_GCCOLLECT);
+  blocks = counter.blocks;
+  bytes = counter.bytes;
+  t = now();
+  if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+    fprintf(stderr, "luabench: %s: %s\n", cases[c][0], lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return -1;
+  }
+  t = now() - t;
+  if (!quiet)
+    printf("%-28s%12.0f%12.2f%12.1f\n", cases[c][0], iters / t * 1e9,
+           (double)(counter.blocks - blocks) / iters,
+           (double)(counter.bytes - bytes) / iters);
+  return 0;
+}
+
+static int selected(size_t c, char *names[], int nnames) {
+  int i;
+
+  if (!nnames)
+    return 1;
+  for (i = 0; i < nnames; i++)
+    if (!strncmp(cases[c][0], names[i], strlen(names[i])))
+      return 1;
+  return 0;
+}
+
+static int bench(long iters, size_t n, char *names[], int nnames) {
+  int fail = 0;
+  size_t c;
+
+  if (start(n) || (lua_pushnil(L), call(setup, "setup", 1))) {
+    stop();
+    return 1;
+  }
+  printf("%zu clients, %ld iterations\n", n, iters);
+  printf("%-28s%12s%12s%12s\n", "case", "ops/s", "allocs/op", "bytes/op");
+  for (c = 0; c < LENGTH(cases); c++)
+    if (selected(c, names, nnames))
+      fail |= runcase(c, iters, 0);
+  stop();
+  return fail ? 1 : 0;
+}
+
+/* Run each script in a fresh state; returns the number that failed */
+static int runscripts(char *paths[], int npaths) {
+  int failed = 0, i;
+
+  for (i = 0; i < npaths; i++) {
+    if (start(100) || luaL_dofile(L, paths[i]) != LUA_OK) {
+      fprintf(stderr, "%s: %s\n", paths[i],
+              L ? lua_tostring(L, -1) : "no Lua state");
+      failed++;
+    } else {
+      printf("%s: ok\n", paths[i]);
+    }
+    stop();
+  }
+  return failed;
+}
+
+static int check(void) {
+  int fail = 0;
+  size_t c;
+
+  if (start(100) || (lua_pushnil(L), call(setup, "setup", 1))) {
+    stop();
+    return 1;
+  }
+  for (c = 0; c < LENGTH(cases); c++)
+    fail |= runcase(c, CHECK_ITERATIONS, 1);
+  if (!fail && !call(checks, "checks", 1))
+    puts("mock: ok");
+  else
+    fail = 1;
+  stop();
+  return fail;
+}
+
+int main(int argc, char *argv[]) {
+  long iters = 200000;
+  size_t n = 100;
+  int opt, scripts = 0;
+
+  while ((opt = getopt(argc, argv, "cn:p:t")) != -1) {
+    if (opt == 'c')
+      return check();
+    else if (opt == 'n')
+      iters = strtol(optarg, NULL, 10);
+    else if (opt == 'p')
+      n = strtoul(optarg, NULL, 10);
+    else if (opt == 't')
+      scripts = 1;
+    else
+      goto usage;
+  }
+  if (scripts)
+    return runscripts(argv + optind, argc - optind) != 0;
+  if (iters <= 0 || !n)
+    goto usage;
+  return bench(iters, n, argv + optind, argc - optind);
+
+usage:
+  fprintf(stderr, "usage: luabench [-n iterations] [-p clients] [case...]"
+                  " | luabench -c | luabench -t script...\n");
+  return 1;
+}
@@ -0,0 +1,269 @@
+/*
+ * Microbenchmark and self-test for base.object.
+ *
+ *   objbench [iterations]   time property reads and writes on objects made
+ *                           with the former pure Lua base.object and with the
+ *                           C objects of luaobject.c (default 2000000)
+ *   objbench -c             only check the C objects' behaviour; exits
+ *                           nonzero on failure
+ *
+ * Run from the source tree: lua/base/object.lua is loaded from ./lua.  The
+ * reference implementation below is the former base.object, reduced to the
+ * parts the benchmark touches.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+
+#include "luaobject.h"
+
+static const char reference[] =
+    "local object, data = {}, setmetatable({}, {__mode = 'k'})\n"
+    "function object.new()\n"
+    "  local obj = {}\n"
+    "  data[obj] = {signals = {}, properties = {}, private = {}}\n"
+    "  return setmetatable(obj, {\n"
+    "    __index = function(self, key)\n"
+    "      local d = data[self]\n"
+    "      if not d then return nil end\n"
+    "      if d.properties[key] and d.properties[key].getter then\n"
+    "        return d.properties[key].getter(self)\n"
+    "      end\n"
+    "      if d.private[key] ~= nil then return d.private[key] end\n"
+    "      return object[key]\n"
+    "    end,\n"
+    "    __newindex = function(self, key, value)\n"
+    "      local d = data[self]\n"
+    "      if not d then return end\n"
+    "      if d.properties[key] and d.properties[key].setter then\n"
+    "        d.properties[key].setter(self, value)\n"
+    "        return\n"
+    "      end\n"
+    "      local old = d.private[key]\n"
+    "      d.private[key] = value\n"
+    "      if old ~= value then\n"
+    "        self:emit_signal('property::' .. key, value, old)\n"
+    "      end\n"
+    "    end})\n"
+    "end\n"
+    "function object:connect_signal(name, fn)\n"
+    "  local s = data[self].signals\n"
+    "  s[name] = s[name] or {}\n"
+    "  table.insert(s[name], fn)\n"
+    "end\n"
+    "function object:emit_signal(name, ...)\n"
+    "  local d = data[self]\n"
+    "  if not d or not d.signals[name] then return end\n"
+    "  for _, fn in ipairs(d.signals[name]) do pcall(fn, self, ...) end\n"
+    "end\n"
+    "function object:add_property(name, config)\n"
+    "  data[self].properties[name] = {getter = config.getter,\n"
+    "                                 setter = config.setter}\n"
+    "end\n"
+    "function object:get_private() return data[self].private end\n"
+    "function object:set_private(k, v) data[self].private[k] = v end\n"
+    "return object\n";
+
+/* Each case gets an object o with a "size" property backed by private data,
+ * a method "grow" and a plain field "n"; the body runs ITER times */
+static const char cases[] =
+    "return {\n"
+    "  {'read property', 'local x = o.size'},\n"
+    "  {'read field', 'local x = o.n'},\n"
+    "  {'method lookup', 'local x = o.grow'},\n"
+    "  {'write property', 'o.size = i'},\n"
+    "  {'write field', 'o.n = i'},\n"
+    "  {'write field, 1 cb', 'o.m = i', true},\n"
+    "}\n";
+
+/* makers for the two implementations, returning a fresh o */
+static const char makers[] =
+    "local ref, cur = ...\n"
+    "local function define(o)\n"
+    "  o:add_property('size', {\n"
+    "    getter = function(self) return self:get_private().size or 0 end,\n"
+    "    setter = function(self, v) self:set_private('size', v) end})\n"
+    "end\n"
+    "local cls = cur.class()\n"
+    "define(cls)\n"
+    "function cls.methods:grow() self.size = self.size + 1 end\n"
+    "return {\n"
+    "  {'lua', function()\n"
+    "    local o = ref.new()\n"
+    "    define(o)\n"
+    "    function o:grow() self.size = self.size + 1 end\n"
+    "    return o\n"
+    "  end},\n"
+    "  {'c', function() return cls:new() end},\n"
+    "}\n";
+
+static const char checks[] =
+    "local object = ...\n"
+    "local cls = object.class()\n"
+    "local got = {}\n"
+    "cls:add_property('size', {\n"
+    "  getter = function(self) return self:get_private().size or 1 end,\n"
+    "  setter = function(self, v)\n"
+    "    self:set_private('size', v)\n"
+    "    self:emit_signal('property::size', v)\n"
+    "  end})\n"
+    "cls:add_property('wo', {setter = function(self, v) got.wo = v end})\n"
+    "function cls.methods:double() return self.size * 2 end\n"
+    "local a, b = cls:new(), cls:new()\n"
+    "assert(object.is(a) and not object.is({}) and not object.is(io.stdout))\n"
+    "assert(a.size == 1 and a:double() == 2)\n"
+    "a.size = 5\n"
+    "assert(a.size == 5 and b.size == 1 and a:double() == 10)\n"
+    "a.wo = 3\n"
+    "assert(got.wo == 3 and a.wo == nil)\n"
+    "local function cb(self, new, old) got[#got + 1] = {self, new, old} end\n"
+    "a:connect_signal('property::x', cb)\n"
+    "a.x = 1; a.x = 1; a.x = 2; b.x = 7\n"
+    "assert(#got == 2 and got[1][1] == a and got[2][2] == 2 and got[2][3] == 1)\n"
+    "assert(b.x == 7 and b:get_private().x == 7)\n"
+    "assert(a:has_signal('property::x') and not b:has_signal('property::x'))\n"
+    "assert(a:get_signals()['property::x'] == 1)\n"
+    "a:disconnect_signal('property::x', cb)\n"
+    "a.x = 3\n"
+    "assert(#got == 2 and not a:has_signal('property::x'))\n"
+    "local n = 0\n"
+    "local function once(self) n = n + 1; self:disconnect_signal('e', once) end\n"
+    "a:connect_signal('e', once)\n"
+    "a:connect_signal('e', function() n = n + 10 end)\n"
+    "a:connect_signal('e', function() error('expected') end)\n"
+    "assert(a:emit_signal('e') == 1 and n == 1)\n"
+    "assert(a:emit_signal('e') == 1 and n == 11)\n"
+    "assert(not pcall(a.connect_signal, a, 'e', 1))\n"
+    "assert(not pcall(object.emit_signal, {}, 'e'))\n"
+    "-- per-object overrides leave the class alone\n"
+    "function a:double() return 0 end\n"
+    "a:add_property('extra', {getter = function() return 'x' end})\n"
+    "assert(a:double() == 0 and a.extra == 'x' and a.size == 5)\n"
+    "assert(b:double() == 2 and b.extra == nil)\n"
+    "assert(cls:new():double() == 2)\n"
+    "-- subclasses copy their parent\n"
+    "local sub = object.class(cls)\n"
+    "function sub.methods:double() return -1 end\n"
+    "local s = sub:new()\n"
+    "assert(s.size == 1 and s:double() == -1 and b:double() == 2)\n"
+    "local p = object.new()\n"
+    "p:add_property('v', {getter = function() return 42 end})\n"
+    "assert(p.v == 42 and object.new().v == nil)\n"
+    "a:destroy()\n"
+    "assert(a:get_private().size == nil and not a:has_signal('e'))\n"
+    "return true\n";
+
+static double now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void run(lua_State *l, const char *chunk, const char *name, int nargs,
+                int nres) {
+  if (luaL_loadbuffer(l, chunk, strlen(chunk), name) != LUA_OK) {
+    fprintf(stderr, "%s\n", lua_tostring(l, -1));
+    exit(1);
+  }
+  lua_insert(l, -nargs - 1);
+  if (lua_pcall(l, nargs, nres, 0) != LUA_OK) {
+    fprintf(stderr, "%s\n", lua_tostring(l, -1));
+    exit(1);
+  }
+}
+
+static lua_State *setup(void) {
+  lua_State *l = luaL_newstate();
+
+  luaL_openlibs(l);
+  lua_newtable(l);
+  luaobject_register(l);
+  lua_setglobal(l, "Some");
+  run(l, "package.path = './lua/?.lua;' .. package.path\n"
+         "return require('base.object')",
+      "setup", 0, 1);
+  return l;
+}
+
+static int check(void) {
+  lua_State *l = setup();
+  int ok;
+
+  if (luaL_loadbuffer(l, checks, strlen(checks), "checks") != LUA_OK) {
+    fprintf(stderr, "%s\n", lua_tostring(l, -1));
+    return 1;
+  }
+  lua_insert(l, -2);
+  ok = lua_pcall(l, 1, 1, 0) == LUA_OK;
+  puts(ok ? "ok" : lua_tostring(l, -1));
+  lua_close(l);
+  return !ok;
+}
+
+static void bench(long iters) {
+  lua_State *l = setup();
+  char body[256];
+  double t;
+  int ncases, nimpl, c, m, top;
+
+  run(l, reference, "reference", 0, 1);
+  lua_insert(l, -2);
+  run(l, makers, "makers", 2, 1);
+  run(l, cases, "cases", 0, 1);
+  top = lua_gettop(l);
+  ncases = (int)lua_rawlen(l, top);
+  nimpl = (int)lua_rawlen(l, top - 1);
+  printf("%-20s", "ns/op");
+  for (m = 1; m <= nimpl; m++) {
+    lua_rawgeti(l, top - 1, m);
+    lua_rawgeti(l, -1, 1);
+    printf("%10s", lua_tostring(l, -1));
+    lua_pop(l, 2);
+  }
+  putchar('\n');
+  for (c = 1; c <= ncases; c++) {
+    lua_rawgeti(l, top, c);
+    lua_rawgeti(l, -1, 1);
+    printf("%-20s", lua_tostring(l, -1));
+    lua_rawgeti(l, -2, 2);
+    snprintf(body, sizeof(body),
+             "local o, iters, listen = ...\n"
+             "if listen then o:connect_signal('property::m', function() end) "
+             "end\n"
+             "o.n = 0\n"
+             "for i = 1, iters do %s end\n",
+             lua_tostring(l, -1));
+    lua_rawgeti(l, -3, 3);
+    for (m = 1; m <= nimpl; m++) {
+      if (luaL_loadstring(l, body) != LUA_OK) {
+        fprintf(stderr, "%s\n", lua_tostring(l, -1));
+        exit(1);
+      }
+      lua_rawgeti(l, top - 1, m);
+      lua_rawgeti(l, -1, 2);
+      lua_call(l, 0, 1);
+      lua_replace(l, -2);
+      lua_pushinteger(l, iters);
+      lua_pushvalue(l, -4);
+      t = now();
+      lua_call(l, 3, 0);
+      printf("%10.1f", (now() - t) / iters);
+    }
+    putchar('\n');
+    lua_pop(l, 4);
+  }
+  lua_close(l);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && !strcmp(argv[1], "-c"))
+    return check();
+  bench(argc > 1 ? strtol(argv[1], NULL, 10) : 2000000);
+  return 0;
+}
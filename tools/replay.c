@@ -0,0 +1,258 @@
+/*
+ * Plays a recording made with "dwl -r" back into a running compositor; see
+ * tools/replay.sh, which starts a headless one for it.
+ *
+ *   replay [-s speed] file   replay at speed times the recorded pace
+ *   replay -o file           print how many outputs the recording starts with
+ *
+ * Input is injected through the virtual keyboard and pointer, with pointer
+ * positions mapped from the recorded layout onto the current one.  Every
+ * recorded client becomes a stub window with the same app_id and title,
+ * which commits blank buffers of the recorded sizes at the recorded times.
+ * Outputs added or removed after the start cannot be reproduced by a client
+ * and are only counted.
+ *
+ * Prints one JSON line
+ *
+ *   {"events":n,"duration_ms":..,"max_late_ms":..,"output_changes":n,
+ *    "layout":<"get_clients">,"compositor":<"get_stats">}
+ *
+ * so that replays of the same file can be compared: the tags and geometry
+ * in the layout should not change between them, and the stats show what
+ * the frame timing was.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "benchinput.h"
+#include "record.h"
+
+typedef struct {
+  unsigned int id; /* recorded client id */
+  BenchWindow win;
+} Stub;
+
+static struct zwp_virtual_keyboard_v1 *kbd;
+static struct zwlr_virtual_pointer_v1 *ptr;
+static Stub **stubs;
+static size_t nstubs, stubcap;
+/* recorded layout, in 1/256 pixel */
+static int64_t layoutx, layouty, layoutw = 1, layouth = 1;
+
+static uint32_t timestamp(void) {
+  /* 0 would make dwl treat pointer motion as internal */
+  return (uint32_t)bench_now_ms() | 1;
+}
+
+static Stub *findstub(unsigned int id, size_t *index) {
+  size_t i;
+
+  for (i = 0; i < nstubs; i++) {
+    if (stubs[i]->id == id) {
+      if (index)
+        *index = i;
+      return stubs[i];
+    }
+  }
+  return NULL;
+}
+
+static struct wl_buffer *sizedbuffer(int64_t w, int64_t h) {
+  return bench_buffer(w > 0 ? (int)w : BENCH_SMALL_W,
+                      h > 0 ? (int)h : BENCH_SMALL_H);
+}
+
+static void clientevent(const RecordEvent *ev) {
+  size_t i;
+  Stub *s = findstub((unsigned int)ev->num[0], &i);
+
+  switch (ev->type) {
+  case RecClientMap:
+    if (s)
+      break;
+    if (nstubs == stubcap) {
+      stubcap = stubcap ? stubcap * 2 : 16;
+      if (!(stubs = realloc(stubs, stubcap * sizeof(*stubs))))
+        bench_die("out of memory");
+    }
+    if (!(s = calloc(1, sizeof(*s))))
+      bench_die("out of memory");
+    s->id = (unsigned int)ev->num[0];
+    s->win.buffer = sizedbuffer(ev->num[1], ev->num[2]);
+    bench_window_create(&s->win, ev->str[0], ev->str[1]);
+    stubs[nstubs++] = s;
+    break;
+  case RecClientCommit:
+    if (!s)
+      break;
+    s->win.buffer = sizedbuffer(ev->num[1], ev->num[2]);
+    if (s->win.configured)
+      bench_window_present(&s->win, s->win.buffer);
+    break;
+  case RecClientTitle:
+    if (s)
+      xdg_toplevel_set_title(s->win.toplevel, ev->str[0]);
+    break;
+  case RecClientUnmap:
+    if (!s)
+      break;
+    bench_window_destroy(&s->win);
+    free(s);
+    stubs[i] = stubs[--nstubs];
+    break;
+  }
+}
+
+static void inputevent(const RecordEvent *ev) {
+  switch (ev->type) {
+  case RecKey:
+    zwp_virtual_keyboard_v1_key(kbd, timestamp(), (uint32_t)ev->num[0],
+                                (uint32_t)ev->num[1]);
+    break;
+  case RecModifiers:
+    zwp_virtual_keyboard_v1_modifiers(kbd, (uint32_t)ev->num[0],
+                                      (uint32_t)ev->num[1],
+                                      (uint32_t)ev->num[2],
+                                      (uint32_t)ev->num[3]);
+    break;
+  case RecMotion:
+    zwlr_virtual_pointer_v1_motion_absolute(
+        ptr, timestamp(), (uint32_t)(ev->num[0] - layoutx),
+        (uint32_t)(ev->num[1] - layouty), (uint32_t)layoutw,
+        (uint32_t)layouth);
+    zwlr_virtual_pointer_v1_frame(ptr);
+    break;
+  case RecButton:
+    zwlr_virtual_pointer_v1_button(ptr, timestamp(), (uint32_t)ev->num[0],
+                                   (uint32_t)ev->num[1]);
+    zwlr_virtual_pointer_v1_frame(ptr);
+    break;
+  case RecAxis:
+    zwlr_virtual_pointer_v1_axis_source(ptr, (uint32_t)ev->num[3]);
+    if (ev->num[2])
+      zwlr_virtual_pointer_v1_axis_discrete(
+          ptr, timestamp(), (uint32_t)ev->num[0], (wl_fixed_t)ev->num[1],
+          (int32_t)ev->num[2]);
+    else
+      zwlr_virtual_pointer_v1_axis(ptr, timestamp(), (uint32_t)ev->num[0],
+                                   (wl_fixed_t)ev->num[1]);
+    zwlr_virtual_pointer_v1_frame(ptr);
+    break;
+  }
+}
+
+/* Grow the recorded layout by an output box given in pixels */
+static void addoutput(const RecordEvent *ev) {
+  int64_t x = ev->num[0] * 256, y = ev->num[1] * 256;
+  int64_t w = ev->num[2] * 256, h = ev->num[3] * 256;
+  int64_t right = layoutx + layoutw, bottom = layouty + layouth;
+
+  if (layoutw == 1) {
+    layoutx = x, layouty = y, layoutw = w, layouth = h;
+    return;
+  }
+  if (x < layoutx)
+    layoutx = x;
+  if (y < layouty)
+    layouty = y;
+  layoutw = (x + w > right ? x + w : right) - layoutx;
+  layouth = (y + h > bottom ? y + h : bottom) - layouty;
+}
+
+static FILE *openrecording(const char *path) {
+  FILE *f = fopen(path, "rb");
+
+  if (!f || record_check(f) < 0) {
+    fprintf(stderr, "replay: %s is not a recording\n", path);
+    exit(1);
+  }
+  return f;
+}
+
+/* Outputs recorded before anything else happened */
+static int initialoutputs(const char *path) {
+  FILE *f = openrecording(path);
+  RecordEvent ev = {0};
+  int n = 0;
+
+  while (record_read(f, &ev) == 1 && ev.type == RecOutputAdd)
+    n++;
+  record_read(f, &ev); /* frees the strings */
+  fclose(f);
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  RecordEvent ev = {0};
+  struct xkb_keymap *keymap;
+  double speed = 1, start, late, maxlate = 0;
+  int opt, countonly = 0, r, changes = 0, started = 0, never = 0;
+  char *layout, *stats;
+  size_t events = 0;
+  FILE *f;
+
+  while ((opt = getopt(argc, argv, "s:o")) != -1) {
+    if (opt == 's')
+      speed = atof(optarg);
+    else if (opt == 'o')
+      countonly = 1;
+    else
+      goto usage;
+  }
+  if (optind != argc - 1 || speed <= 0)
+    goto usage;
+  if (countonly) {
+    printf("%d\n", initialoutputs(argv[optind]));
+    return 0;
+  }
+
+  f = openrecording(argv[optind]);
+  bench_connect(bench_input_globals, 2);
+  kbd = bench_keyboard(&keymap);
+  ptr = bench_pointer(0);
+  free(bench_ipc("reset_stats", 0));
+
+  start = bench_now_ms();
+  while ((r = record_read(f, &ev)) == 1) {
+    events++;
+    if (ev.type == RecOutputAdd || ev.type == RecOutputRemove) {
+      if (ev.type == RecOutputAdd)
+        addoutput(&ev);
+      changes += started;
+      continue;
+    }
+    started = 1;
+    /* keep the recorded pace, dispatching events while waiting */
+    late = bench_now_ms() - start - (double)ev.time / 1e3 / speed;
+    if (late < 0)
+      bench_waitfor(&never, (int)-late);
+    else if (late > maxlate)
+      maxlate = late;
+    if (ev.type >= RecClientMap)
+      clientevent(&ev);
+    else
+      inputevent(&ev);
+  }
+  if (r < 0)
+    fprintf(stderr, "replay: recording is truncated after %zu events\n",
+            events);
+  fclose(f);
+
+  wl_display_roundtrip(bench_dpy);
+  layout = bench_ipc("get_clients", 0);
+  stats = bench_ipc("get_stats", 0);
+  printf("{\"events\":%zu,\"duration_ms\":%.1f,\"max_late_ms\":%.1f"
+         ",\"output_changes\":%d,\"layout\":%s,\"compositor\":%s}\n",
+         events, bench_now_ms() - start, maxlate, changes, layout, stats);
+  free(layout);
+  free(stats);
+  xkb_keymap_unref(keymap);
+  bench_disconnect();
+  return 0;
+
+usage:
+  fprintf(stderr, "usage: replay [-s speed] file | replay -o file\n");
+  return 1;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+# Plays back a recording made with "dwl -r file" in a fresh headless
+# session, using as many outputs as the recording started with, and prints
+# the JSON line of tools/replay (see there).
+#
+#   tools/replay.sh file [speed]
+set -eu
+if [ $# -lt 1 ]; then
+	echo "usage: tools/replay.sh recording [speed]" >&2
+	exit 1
+fi
+case $1 in
+/*) rec=$1 ;;
+*) rec=$PWD/$1 ;;
+esac
+speed=${2:-1}
+cd "$(dirname "$0")/.."
+
+outputs=$(./replay -o "$rec")
+[ "$outputs" -gt 0 ] || outputs=1
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT INT TERM
+
+if [ -z "${XDG_RUNTIME_DIR:-}" ]; then
+	XDG_RUNTIME_DIR=$tmp
+	export XDG_RUNTIME_DIR
+fi
+
+env -u DISPLAY -u WAYLAND_DISPLAY WLR_BACKENDS=headless WLR_RENDERER=pixman \
+	WLR_HEADLESS_OUTPUTS="$outputs" WLR_LIBINPUT_NO_DEVICES=1 \
+	./dwl -s "./replay -s $speed '$rec' >'$tmp/result' 2>'$tmp/log';
+		echo \$? >'$tmp/status'; kill \$PPID" >"$tmp/dwl.log" 2>&1 || :
+
+if [ "$(cat "$tmp/status" 2>/dev/null)" != 0 ]; then
+	echo "replay: failed" >&2
+	cat "$tmp/log" "$tmp/dwl.log" >&2 2>/dev/null || :
+	exit 1
+fi
+cat "$tmp/result"
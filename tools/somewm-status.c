@@ -0,0 +1,120 @@
+/*
+ * Test reader for the shared-memory status page.
+ *
+ *   somewm-status [path]      print one snapshot
+ *   somewm-status -w [path]   print a snapshot every time the page changes
+ *   somewm-status -t          seqlock self-test: a forked writer updates a
+ *                             private page while this process checks every
+ *                             snapshot for torn reads
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "statuspage.h"
+
+static void print(const SomewmStatusPage *s) {
+  const SomewmStatusMonitor *m;
+  uint32_t i;
+
+  printf("seq %u updates %llu clients %u\n", s->seq,
+         (unsigned long long)s->updates, s->nclients);
+  for (i = 0; i < s->nmonitors && i < SOMEWM_STATUS_MONITORS; i++) {
+    m = &s->mons[i];
+    printf("%s%s layout %s tags %u %u %u %u clients %u\n", m->name,
+           m->selected ? "*" : "", m->layout, m->occupied, m->tagset,
+           m->seltags, m->urgent, m->nclients);
+    printf("  %s [%s]%s%s\n", m->title, m->appid,
+           m->fullscreen ? " fullscreen" : "", m->floating ? " floating" : "");
+  }
+  fflush(stdout);
+}
+
+static int selftest(void) {
+  char path[] = "/tmp/somewm-status-test.XXXXXX";
+  SomewmStatusPage *w, snap;
+  const SomewmStatusPage *r;
+  uint32_t n, last = 0;
+  unsigned long reads = 0, torn = 0;
+  pid_t pid;
+  int fd;
+
+  if ((fd = mkstemp(path)) < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+  close(fd);
+  if (!(w = statuspage_create(path)) || !(r = somewm_status_open(path))) {
+    fprintf(stderr, "cannot create test page\n");
+    return 1;
+  }
+
+  if ((pid = fork()) == 0) {
+    for (n = 1; n <= 200000; n++) {
+      statuspage_begin(w);
+      w->nmonitors = 1;
+      w->nclients = n;
+      w->mons[0].tagset = w->mons[0].occupied = n;
+      snprintf(w->mons[0].title, sizeof(w->mons[0].title), "title %u", n);
+      statuspage_end(w);
+    }
+    _exit(0);
+  }
+
+  while (waitpid(pid, NULL, WNOHANG) == 0 || last < 200000) {
+    somewm_status_read(r, &snap);
+    reads++;
+    n = snap.nclients;
+    if (n < last || (n && (snap.mons[0].tagset != n ||
+                           snap.mons[0].occupied != n ||
+                           strtoul(snap.mons[0].title + 6, NULL, 10) != n)))
+      torn++;
+    last = n;
+  }
+
+  somewm_status_close(r);
+  statuspage_destroy(w, path);
+  printf("reads %lu torn %lu\n", reads, torn);
+  return torn != 0;
+}
+
+int main(int argc, char *argv[]) {
+  const SomewmStatusPage *page;
+  SomewmStatusPage snap;
+  struct timespec ts = {0, 50 * 1000 * 1000};
+  uint32_t seen;
+  int watch = 0, opt;
+
+  while ((opt = getopt(argc, argv, "tw")) != -1) {
+    if (opt == 't')
+      return selftest();
+    if (opt == 'w')
+      watch = 1;
+    else
+      goto usage;
+  }
+  if (!(page = somewm_status_open(optind < argc ? argv[optind] : NULL))) {
+    fprintf(stderr, "somewm-status: no status page (is SOMEWM_STATUS set?)\n");
+    return 1;
+  }
+
+  seen = somewm_status_read(page, &snap);
+  print(&snap);
+  while (watch) {
+    /* Polling seq is a plain memory load; nothing reaches the compositor */
+    nanosleep(&ts, NULL);
+    if (somewm_status_seq(page) == seen)
+      continue;
+    seen = somewm_status_read(page, &snap);
+    print(&snap);
+  }
+  somewm_status_close(page);
+  return 0;
+
+usage:
+  fprintf(stderr, "usage: somewm-status [-w] [path] | -t\n");
+  return 1;
+}
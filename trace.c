@@ -0,0 +1,202 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "perfstat.h"
+#include "trace.h"
+
+typedef struct {
+  const char *name;
+  uint64_t start, dur; /* nanoseconds */
+} TraceSpan;
+
+typedef struct TraceBuf {
+  struct TraceBuf *next;
+  int tid;
+  unsigned int generation; /* of the tracing session the stack belongs to */
+  unsigned int recording;  /* of the trace the ring belongs to */
+  TraceSpan *spans;
+  size_t cap, head, count; /* head is the next slot to write */
+  atomic_uint depth;       /* may exceed TRACE_DEPTH; those are dropped */
+  const char *_Atomic open[TRACE_DEPTH];
+  uint64_t opened[TRACE_DEPTH];
+} TraceBuf;
+
+int tracing;
+static _Atomic(TraceBuf *) bufs; /* every thread's buffer, never freed */
+static atomic_int ntids;
+static _Thread_local TraceBuf *mine;
+static size_t capacity = TRACE_DEFAULT_SPANS;
+static unsigned int generation; /* bumped whenever tracing turns on */
+static unsigned int recording;  /* bumped by trace_start() */
+static uint64_t epoch;          /* perf_now() when the trace started */
+
+static void enable(int flag) {
+  if (!tracing)
+    generation++;
+  tracing |= flag;
+}
+
+/* This thread's buffer, its stack reset if tracing was off in between and
+ * its ring reset for the current trace */
+static TraceBuf *attach(void) {
+  TraceBuf *b = mine;
+  TraceSpan *spans;
+
+  if (!b) {
+    if (!(b = calloc(1, sizeof(*b))))
+      return NULL;
+    b->tid = atomic_fetch_add(&ntids, 1) + 1;
+    b->next = atomic_load(&bufs);
+    while (!atomic_compare_exchange_weak(&bufs, &b->next, b))
+      ;
+    mine = b;
+  }
+  if (b->generation != generation) {
+    atomic_store(&b->depth, 0);
+    b->generation = generation;
+  }
+  /* the ring is only allocated once something is recorded */
+  if ((tracing & TRACE_RECORD) && b->recording != recording) {
+    if (b->cap != capacity) {
+      if (!(spans = realloc(b->spans, capacity * sizeof(*spans))))
+        return NULL;
+      b->spans = spans;
+      b->cap = capacity;
+    }
+    b->head = b->count = 0;
+    b->recording = recording;
+  }
+  return b;
+}
+
+void trace_begin(const char *name) {
+  TraceBuf *b = mine;
+  unsigned int depth;
+
+  if ((!b || b->generation != generation ||
+       ((tracing & TRACE_RECORD) && b->recording != recording)) &&
+      !(b = attach()))
+    return;
+  depth = atomic_load_explicit(&b->depth, memory_order_relaxed);
+  if (depth < TRACE_DEPTH) {
+    atomic_store_explicit(&b->open[depth], name, memory_order_relaxed);
+    b->opened[depth] = perf_now();
+  }
+  /* release, so that trace_open() never sees a stale name */
+  atomic_store_explicit(&b->depth, depth + 1, memory_order_release);
+}
+
+void trace_end(void) {
+  TraceBuf *b = mine;
+  TraceSpan *s;
+  unsigned int depth;
+
+  /* spans opened before tracing was last turned on are not ended */
+  if (!b || b->generation != generation ||
+      !(depth = atomic_load_explicit(&b->depth, memory_order_relaxed)))
+    return;
+  atomic_store_explicit(&b->depth, --depth, memory_order_release);
+  /* nor recorded if they started before the trace */
+  if (depth >= TRACE_DEPTH || !(tracing & TRACE_RECORD) ||
+      b->recording != recording || b->opened[depth] < epoch)
+    return;
+  s = &b->spans[b->head];
+  s->name = b->open[depth];
+  s->start = b->opened[depth];
+  s->dur = perf_now() - s->start;
+  if (++b->head == b->cap)
+    b->head = 0;
+  if (b->count < b->cap)
+    b->count++;
+}
+
+void trace_start(size_t spans) {
+  capacity = spans ? spans : TRACE_DEFAULT_SPANS;
+  recording++;
+  epoch = perf_now();
+  enable(TRACE_RECORD);
+}
+
+void trace_stop(void) {
+  tracing &= ~TRACE_RECORD;
+}
+
+void trace_watch(int on) {
+  if (on)
+    enable(TRACE_WATCH);
+  else
+    tracing &= ~TRACE_WATCH;
+}
+
+TraceThread *trace_thread(void) {
+  return mine ? mine : attach();
+}
+
+int trace_open(TraceThread *b, const char **names, int max) {
+  unsigned int depth = atomic_load_explicit(&b->depth, memory_order_acquire);
+  int i;
+
+  if (depth > TRACE_DEPTH)
+    depth = TRACE_DEPTH;
+  for (i = 0; i < (int)depth && i < max; i++)
+    names[i] = atomic_load_explicit(&b->open[i], memory_order_relaxed);
+  return i;
+}
+
+static void jsonstring(FILE *f, const char *s) {
+  putc('"', f);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fprintf(f, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      fprintf(f, "\\u%04x", *s);
+    else
+      putc(*s, f);
+  }
+  putc('"', f);
+}
+
+int trace_dump(const char *path) {
+  FILE *f = fopen(path, "w");
+  const TraceSpan *s;
+  TraceBuf *b;
+  int pid = (int)getpid(), first = 1, err;
+  size_t i;
+
+  if (!f)
+    return -1;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", f);
+  for (b = atomic_load(&bufs); b; b = b->next) {
+    if (b->recording != recording || !b->spans)
+      continue;
+    /* oldest first */
+    for (i = 0; i < b->count; i++) {
+      s = &b->spans[(b->head + b->cap - b->count + i) % b->cap];
+      fputs(first ? "\n{\"name\":" : ",\n{\"name\":", f);
+      jsonstring(f, s->name);
+      fprintf(f,
+              ",\"cat\":\"dwl\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f"
+              ",\"pid\":%d,\"tid\":%d}",
+              (double)(s->start - epoch) / 1e3, (double)s->dur / 1e3, pid,
+              b->tid);
+      first = 0;
+    }
+  }
+  fputs("\n]}\n", f);
+  err = ferror(f);
+  return fclose(f) || err ? -1 : 0;
+}
+
+const char *trace_default_path(void) {
+  static char path[256];
+  static unsigned int n;
+  const char *dir = getenv("XDG_RUNTIME_DIR");
+
+  snprintf(path, sizeof(path), "%s/somewm-trace-%d-%u.json",
+           dir && *dir ? dir : "/tmp", (int)getpid(), ++n);
+  return path;
+}
@@ -0,0 +1,90 @@
+/*
+ * Span tracing of the compositor's event loop, written out in the Chrome
+ * trace-event format (chrome://tracing, https://ui.perfetto.dev) so that a
+ * single slow frame can be opened and read phase by phase.
+ *
+ * Every thread records completed spans into its own ring buffer; when it is
+ * full the oldest spans are overwritten.  Nothing is locked, and nothing is
+ * allocated after a thread's first span of a trace.  A span is named by a
+ * string that must outlive the trace: a literal or an interned signal name.
+ * While tracing is off, a trace point costs a load and a branch; while only
+ * watched (below), a clock read.
+ *
+ * TRACE_SCOPE(name), placed among the declarations of a function, opens a
+ * span that ends whenever the function returns; TRACE_BEGIN()/TRACE_END()
+ * bracket a part of one.  Spans nest up to TRACE_DEPTH deep.
+ *
+ * Tracing is controlled from the main thread only: from Lua
+ * (Some.trace_start, trace_stop, trace_dump) or with SIGUSR1, which starts
+ * a trace or stops it and writes it to trace_default_path().
+ *
+ * The same trace points also keep a stack of the spans open on each thread,
+ * which another thread can read with trace_open(): the stall watchdog
+ * (watchdog.h) turns that on with trace_watch() to see what the main loop
+ * is busy with, whether a trace is being recorded or not.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+#define TRACE_DEPTH 32
+#define TRACE_DEFAULT_SPANS (1 << 16) /* per thread */
+
+enum { TRACE_RECORD = 1, TRACE_WATCH = 2 };
+
+/* TRACE_RECORD between trace_start() and trace_stop(), TRACE_WATCH while
+ * trace_watch() is on */
+extern int tracing;
+
+typedef struct TraceBuf TraceThread;
+
+/* discard what was recorded and record up to spans (0 for the default)
+ * spans per thread from now on */
+void trace_start(size_t spans);
+void trace_stop(void);
+/* write the current trace, stopped or not; returns 0, or -1 with errno */
+int trace_dump(const char *path);
+/* a new file name in $XDG_RUNTIME_DIR (or /tmp) for each call */
+const char *trace_default_path(void);
+
+/* keep the stacks of open spans up to date even while not recording */
+void trace_watch(int on);
+/* the calling thread, for trace_open() from another one; NULL if out of
+ * memory */
+TraceThread *trace_thread(void);
+/* copy the names of up to max spans open on thread t, outermost first, and
+ * return how many were copied.  The names are read without locking: they
+ * are right as of some moment during the call. */
+int trace_open(TraceThread *t, const char **names, int max);
+
+void trace_begin(const char *name);
+void trace_end(void);
+
+static inline int trace_scope_begin(const char *name) {
+  if (!tracing)
+    return 0;
+  trace_begin(name);
+  return 1;
+}
+
+static inline void trace_scope_end(const int *open) {
+  if (*open)
+    trace_end();
+}
+
+#define TRACE_SCOPE(name)                                                      \
+  int tracescope __attribute__((cleanup(trace_scope_end), unused)) =          \
+      trace_scope_begin(name)
+#define TRACE_BEGIN(name)                                                      \
+  do {                                                                         \
+    if (tracing)                                                               \
+      trace_begin(name);                                                       \
+  } while (0)
+#define TRACE_END()                                                            \
+  do {                                                                         \
+    if (tracing)                                                               \
+      trace_end();                                                             \
+  } while (0)
+
+#endif
@@ -0,0 +1,151 @@
+/* See LICENSE.dwm file for copyright and license details. */
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+#include "watchdog.h"
+
+const unsigned int watchdog_bucket_ms[WATCHDOG_BUCKETS - 1] = {
+    50, 100, 250, 500, 1000, 2500, 5000};
+
+static pthread_t thread;
+static int running;
+static atomic_int stopping;
+static atomic_uint threshold;          /* ms, 0 disables */
+static _Atomic uint64_t heartbeat;     /* odd while the loop is busy */
+static _Atomic uint64_t busysince;     /* perf_now() of the last busy */
+static TraceThread *mainthread;
+
+/* the thread's view of the current stall, and the stats; under lock */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t caughtbeat;
+static char caught[WATCHDOG_CULPRIT];
+static WatchdogStats stats;
+
+/* "outer > inner" from the spans open on the main thread */
+static void culprit(char *buf, size_t size) {
+  const char *names[TRACE_DEPTH];
+  size_t len = 0;
+  int i, n = mainthread ? trace_open(mainthread, names, TRACE_DEPTH) : 0;
+
+  buf[0] = '\0';
+  for (i = 0; i < n && len < size; i++)
+    len += (size_t)snprintf(buf + len, size - len, "%s%s", i ? " > " : "",
+                            names[i] ? names[i] : "?");
+  if (!n)
+    snprintf(buf, size, "(no trace point)");
+}
+
+static void *watch(void *data) {
+  struct timespec tick;
+  uint64_t beat, since, reported = 0;
+  unsigned int ms;
+  char buf[WATCHDOG_CULPRIT];
+
+  while (!atomic_load(&stopping)) {
+    ms = atomic_load(&threshold);
+    /* check four times per threshold, so stalls are caught within 25% */
+    tick.tv_sec = 0;
+    tick.tv_nsec = (ms ? (ms + 3) / 4 : 100) * 1000000L;
+    if (tick.tv_nsec >= 1000000000L) {
+      tick.tv_sec = tick.tv_nsec / 1000000000L;
+      tick.tv_nsec %= 1000000000L;
+    }
+    nanosleep(&tick, NULL);
+
+    beat = atomic_load(&heartbeat);
+    since = atomic_load(&busysince);
+    if (!ms || !(beat & 1) || beat == reported ||
+        perf_now() - since < ms * 1000000ull)
+      continue;
+    culprit(buf, sizeof(buf));
+    /* the loop may have moved on while the stack was read */
+    if (atomic_load(&heartbeat) != beat)
+      continue;
+    reported = beat;
+    pthread_mutex_lock(&lock);
+    caughtbeat = beat;
+    memcpy(caught, buf, sizeof(caught));
+    pthread_mutex_unlock(&lock);
+    fprintf(stderr, "event loop stalled for %.0f ms so far in %s\n",
+            (double)(perf_now() - since) / 1e6, buf);
+  }
+  return NULL;
+}
+
+int watchdog_start(unsigned int threshold_ms) {
+  int err;
+
+  if (running)
+    return 0;
+  atomic_store(&threshold, threshold_ms);
+  atomic_store(&stopping, 0);
+  mainthread = trace_thread();
+  trace_watch(1);
+  if ((err = pthread_create(&thread, NULL, watch, NULL))) {
+    trace_watch(0);
+    errno = err;
+    return -1;
+  }
+  running = 1;
+  return 0;
+}
+
+void watchdog_stop(void) {
+  if (!running)
+    return;
+  atomic_store(&stopping, 1);
+  pthread_join(thread, NULL);
+  trace_watch(0);
+  running = 0;
+}
+
+void watchdog_set_threshold(unsigned int ms) {
+  atomic_store(&threshold, ms);
+}
+
+void watchdog_busy(void) {
+  atomic_store(&busysince, perf_now());
+  atomic_fetch_add(&heartbeat, 1);
+}
+
+void watchdog_idle(void) {
+  uint64_t beat = atomic_fetch_add(&heartbeat, 1), ns;
+  unsigned int ms = atomic_load(&threshold), i;
+  const char *who;
+
+  ns = perf_now() - atomic_load(&busysince);
+  if (!running || !ms || ns < ms * 1000000ull)
+    return;
+  for (i = 0; i < WATCHDOG_BUCKETS - 1; i++)
+    if (ns <= watchdog_bucket_ms[i] * 1000000ull)
+      break;
+  pthread_mutex_lock(&lock);
+  /* stalls just over the threshold can end before the thread looks */
+  who = caughtbeat == beat ? caught : "(not caught)";
+  perfstat_add(&stats.stat, ns);
+  stats.buckets[i]++;
+  stats.last_ns = ns;
+  snprintf(stats.last_culprit, sizeof(stats.last_culprit), "%s", who);
+  pthread_mutex_unlock(&lock);
+  fprintf(stderr, "event loop stalled for %.0f ms in %s\n", (double)ns / 1e6,
+          stats.last_culprit);
+}
+
+void watchdog_stats(WatchdogStats *out) {
+  pthread_mutex_lock(&lock);
+  *out = stats;
+  pthread_mutex_unlock(&lock);
+  out->threshold_ms = running ? atomic_load(&threshold) : 0;
+}
+
+void watchdog_reset(void) {
+  pthread_mutex_lock(&lock);
+  memset(&stats, 0, sizeof(stats));
+  perfstat_reset(&stats.stat);
+  pthread_mutex_unlock(&lock);
+}
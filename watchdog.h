@@ -0,0 +1,50 @@
+/*
+ * Stall detection for the compositor's event loop.
+ *
+ * run() calls watchdog_busy() before it handles a batch of events and
+ * watchdog_idle() before it waits for the next one, which bumps a heartbeat
+ * the watchdog thread polls a few times per threshold.  When the loop has
+ * been busy for longer than the threshold, the thread reads the trace spans
+ * open on the main thread (see trace.h) -- the listener, key binding,
+ * signal or Lua callback that is running -- and logs them at once, so that
+ * a hang is attributed even if it never ends.  Once the loop goes idle
+ * again the stall's length is logged and added to a histogram, which Lua
+ * reads with Some.stall_stats().
+ *
+ * Everything but the thread itself runs on the main thread.
+ */
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdint.h>
+
+#include "perfstat.h"
+
+#define WATCHDOG_DEFAULT_MS 250
+#define WATCHDOG_BUCKETS 8
+#define WATCHDOG_CULPRIT 256 /* bytes */
+
+typedef struct {
+  unsigned int threshold_ms; /* 0 while disabled */
+  PerfStat stat;
+  /* stalls of at most watchdog_bucket_ms[i], the last bucket unbounded */
+  uint64_t buckets[WATCHDOG_BUCKETS];
+  uint64_t last_ns;
+  char last_culprit[WATCHDOG_CULPRIT];
+} WatchdogStats;
+
+extern const unsigned int watchdog_bucket_ms[WATCHDOG_BUCKETS - 1];
+
+/* start the thread; returns 0, or -1 with errno */
+int watchdog_start(unsigned int threshold_ms);
+void watchdog_stop(void);
+/* 0 disables detection, without stopping the thread */
+void watchdog_set_threshold(unsigned int ms);
+
+void watchdog_busy(void);
+void watchdog_idle(void);
+
+void watchdog_stats(WatchdogStats *out);
+void watchdog_reset(void);
+
+#endif